@@ -0,0 +1,290 @@
+#include "AssetLoader.h"
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include "stb_image.h"
+#include "glHelper.h"
+#include "TextureCache.h"
+
+AssetLoader::AssetLoader(unsigned int threadCount)
+{
+	if (threadCount == 0) {
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	// the flip flag of stb_image is global, the workers never set it and flip in decodeImage instead
+	stbi_set_flip_vertically_on_load(false);
+
+	for (unsigned int i = 0; i < threadCount; i++) {
+		this->workers.emplace_back(&AssetLoader::workerLoop, this);
+	}
+}
+
+AssetLoader::~AssetLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->jobMutex);
+		this->stopping = true;
+	}
+	this->jobCondition.notify_all();
+	for (std::thread& worker : this->workers) {
+		worker.join();
+	}
+}
+
+void AssetLoader::workerLoop()
+{
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(this->jobMutex);
+			this->jobCondition.wait(lock, [this] { return this->stopping || !this->jobs.empty(); });
+			if (this->stopping)
+				return;
+			job = std::move(this->jobs.front());
+			this->jobs.pop_front();
+		}
+		job();
+	}
+}
+
+void AssetLoader::submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->jobMutex);
+		this->jobs.push_back(std::move(job));
+	}
+	this->jobCondition.notify_one();
+}
+
+void AssetLoader::enqueueUploads(std::vector<std::function<void()>> tasks)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->uploadMutex);
+		for (std::function<void()>& task : tasks) {
+			this->uploads.push_back(std::move(task));
+		}
+	}
+	this->uploadCondition.notify_all();
+}
+
+void AssetLoader::loadModel(const std::string& name, const std::string& path, unsigned int assimpFlags, std::function<void(Model*)> onLoaded)
+{
+	this->pending++;
+	this->submit([this, name, path, assimpFlags, onLoaded]() {
+		std::shared_ptr<ModelData> data = std::make_shared<ModelData>();
+		if (!Model::loadModelData(path, assimpFlags, *data)) {
+			fprintf(stderr, "Failed to load model %s\n", path.c_str());
+			this->enqueueUploads({ [this]() { this->pending--; } });
+			return;
+		}
+
+		// decode every texture the materials reference once, normal maps are compressed differently
+		std::string directory = Model::getDirectory(path);
+		std::map<std::string, TextureUsage> texturePaths;
+		for (const MaterialData& material : data->materials) {
+			for (const std::string& texturePath : material.textureDiffuse)
+				texturePaths.emplace(texturePath, TextureUsage::Color);
+			for (const std::string& texturePath : material.textureSpecular)
+				texturePaths.emplace(texturePath, TextureUsage::Color);
+			for (const std::string& texturePath : material.textureNormal)
+				texturePaths[texturePath] = TextureUsage::Normal;
+			for (const std::string& texturePath : material.textureHeight)
+				texturePaths.emplace(texturePath, TextureUsage::Color);
+		}
+
+		// each texture is uploaded by its own task so a single frame never has to upload a whole model
+		std::vector<std::function<void()>> tasks;
+		for (auto& texture_it : texturePaths) {
+			std::string filename = directory + "/" + texture_it.first;
+			TextureUsage usage = texture_it.second;
+			// textures shared with models that are already loaded are not decoded again
+			if (TextureCache::get().contains(filename, false, false, usage))
+				continue;
+			std::shared_ptr<CompressedImage> compressed = std::make_shared<CompressedImage>();
+			if (TextureCompressor::loadOrCompress(filename, usage, false, false, *compressed)) {
+				tasks.push_back([filename, usage, compressed]() {
+					if (TextureCache::get().contains(filename, false, false, usage))
+						return;
+					GLuint texture = TextureCompressor::upload(*compressed);
+					TextureCache::get().insert(filename, false, false, usage, texture, compressed->width, compressed->height, compressed->data.size());
+				});
+				continue;
+			}
+			std::shared_ptr<ImageData> image = std::make_shared<ImageData>();
+			if (!AssetLoader::decodeImage(filename, *image))
+				continue;
+			tasks.push_back([filename, usage, image]() {
+				if (TextureCache::get().contains(filename, false, false, usage))
+					return;
+				GLuint texture = AssetLoader::uploadImage(*image);
+				TextureCache::get().insert(filename, false, false, usage, texture, image->width, image->height, AssetLoader::getTextureSize(*image));
+			});
+		}
+		tasks.push_back([this, name, directory, data, onLoaded]() {
+			// the model takes its references to the textures uploaded above
+			Model* model = new Model(name, directory, *data);
+			if (onLoaded)
+				onLoaded(model);
+			this->pending--;
+		});
+		this->enqueueUploads(std::move(tasks));
+	});
+}
+
+void AssetLoader::processUploads(double budgetMs)
+{
+	auto start = std::chrono::steady_clock::now();
+	while (true) {
+		std::function<void()> task;
+		{
+			std::lock_guard<std::mutex> lock(this->uploadMutex);
+			if (this->uploads.empty())
+				return;
+			task = std::move(this->uploads.front());
+			this->uploads.pop_front();
+		}
+		task();
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		if (elapsed.count() >= budgetMs)
+			return;
+	}
+}
+
+void AssetLoader::waitIdle()
+{
+	while (this->pending > 0) {
+		{
+			std::unique_lock<std::mutex> lock(this->uploadMutex);
+			this->uploadCondition.wait(lock, [this] { return !this->uploads.empty(); });
+		}
+		this->processUploads(std::numeric_limits<double>::infinity());
+	}
+}
+
+// 2x2 box filter of one mip level into the next, edges are clamped for odd sizes
+static void downsample(const unsigned char* src, int srcWidth, int srcHeight, unsigned char* dst, int dstWidth, int dstHeight, int channels)
+{
+	for (int y = 0; y < dstHeight; y++) {
+		int y0 = std::min(y * 2, srcHeight - 1);
+		int y1 = std::min(y * 2 + 1, srcHeight - 1);
+		for (int x = 0; x < dstWidth; x++) {
+			int x0 = std::min(x * 2, srcWidth - 1);
+			int x1 = std::min(x * 2 + 1, srcWidth - 1);
+			for (int c = 0; c < channels; c++) {
+				int sum = src[(y0 * srcWidth + x0) * channels + c]
+					+ src[(y0 * srcWidth + x1) * channels + c]
+					+ src[(y1 * srcWidth + x0) * channels + c]
+					+ src[(y1 * srcWidth + x1) * channels + c];
+				dst[(y * dstWidth + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+bool AssetLoader::decodeImage(const std::string& path, ImageData& image, bool flip, bool mips)
+{
+	int width, height, channels;
+	unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
+	if (!data) {
+		fprintf(stderr, "%s %s\n", "Failed to load texture", path.c_str());
+		return false;
+	}
+
+	// size the whole mip chain up front
+	image.width = width;
+	image.height = height;
+	image.channels = channels;
+	image.levelOffsets.clear();
+	size_t size = 0;
+	for (int level = 0; ; level++) {
+		image.levelOffsets.push_back(size);
+		size += (size_t)image.getLevelWidth(level) * image.getLevelHeight(level) * channels;
+		if (!mips || (image.getLevelWidth(level) == 1 && image.getLevelHeight(level) == 1))
+			break;
+	}
+	image.pixels.resize(size);
+
+	size_t rowSize = (size_t)width * channels;
+	for (int y = 0; y < height; y++) {
+		int srcRow = flip ? height - 1 - y : y;
+		std::memcpy(&image.pixels[y * rowSize], data + srcRow * rowSize, rowSize);
+	}
+	stbi_image_free(data);
+
+	for (int level = 1; level < image.getLevelCount(); level++) {
+		downsample(
+			&image.pixels[image.levelOffsets[level - 1]], image.getLevelWidth(level - 1), image.getLevelHeight(level - 1),
+			&image.pixels[image.levelOffsets[level]], image.getLevelWidth(level), image.getLevelHeight(level),
+			channels
+		);
+	}
+	return true;
+}
+
+GLenum AssetLoader::getFormat(int channels)
+{
+	switch (channels)
+	{
+		case 1: return GL_RED;
+		case 2: return GL_RG;
+		case 3: return GL_RGB;
+		default: return GL_RGBA;
+	}
+}
+
+size_t AssetLoader::getTextureSize(const ImageData& image)
+{
+	int channels = image.channels == 3 ? 4 : image.channels;
+	return image.pixels.size() / image.channels * channels;
+}
+
+GLuint AssetLoader::uploadImage(const ImageData& image, bool srgb)
+{
+	GLenum format = AssetLoader::getFormat(image.channels);
+	GLenum internalFormat = format;
+	if (srgb && image.channels == 3)
+		internalFormat = GL_SRGB8;
+	else if (srgb && image.channels == 4)
+		internalFormat = GL_SRGB8_ALPHA8;
+
+	// copy the pixels into a pixel unpack buffer so the driver can transfer them without stalling on client memory
+	GLuint pbo;
+	glGenBuffers(1, &pbo);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, image.pixels.size(), nullptr, GL_STREAM_DRAW);
+	void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, image.pixels.size(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (mapped) {
+		std::memcpy(mapped, image.pixels.data(), image.pixels.size());
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	}
+	else {
+		glBufferSubData(GL_PIXEL_UNPACK_BUFFER, 0, image.pixels.size(), image.pixels.data());
+	}
+	checkGLError("AssetLoader::uploadImage -- fill pbo");
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.getLevelCount() - 1);
+
+	// rows are tightly packed
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (int level = 0; level < image.getLevelCount(); level++) {
+		glTexImage2D(GL_TEXTURE_2D, level, internalFormat, image.getLevelWidth(level), image.getLevelHeight(level), 0, format, GL_UNSIGNED_BYTE, (void*)image.levelOffsets[level]);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	// the buffer is released once the transfer has finished
+	glDeleteBuffers(1, &pbo);
+	checkGLError("AssetLoader::uploadImage -- upload");
+	return texture;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glad/glad.h>
+#include "model.h"
+#include "TextureCompressor.h"
+
+// time spent uploading finished assets each frame before the rest are left for the next frame
+#define ASSET_LOADER_UPLOAD_BUDGET_MS 2.0
+
+///<summary>Loads models and textures on worker threads.
+///<para>Importing, cache reads, image decoding and mip generation run on the workers. The OpenGL uploads are queued and run on the thread that owns the context in processUploads.</para>
+///</summary>
+class AssetLoader {
+public:
+	///<param name="threadCount">Number of worker threads. 0 uses one less than the number of hardware threads.</param>
+	AssetLoader(unsigned int threadCount = 0);
+	~AssetLoader();
+
+	///<summary>Load a model in the background. onLoaded is called from processUploads once the model is ready to be drawn.</summary>
+	///<param name="name">Name of the model.</param>
+	///<param name="path">Path of the model file.</param>
+	///<param name="assimpFlags">Extra flags passed to the importer.</param>
+	///<param name="onLoaded">Called with the new model, usually to add it to a scene.</param>
+	void loadModel(const std::string& name, const std::string& path, unsigned int assimpFlags, std::function<void(Model*)> onLoaded);
+
+	///<summary>Run queued uploads until the budget is used up. Must be called on the thread that owns the OpenGL context, typically once per frame.</summary>
+	///<param name="budgetMs">Time in milliseconds to spend on uploads. At least one upload runs per call.</param>
+	void processUploads(double budgetMs = ASSET_LOADER_UPLOAD_BUDGET_MS);
+
+	///<summary>Block until every requested asset has been loaded and uploaded. Must be called on the thread that owns the OpenGL context.</summary>
+	void waitIdle();
+
+	///<summary>Get the number of requested assets that have not finished loading.</summary>
+	unsigned int getPendingCount() const { return this->pending; }
+	bool isIdle() const { return this->pending == 0; }
+
+	///<summary>Decode an image file and generate its mip chain. Safe to call from any thread.</summary>
+	///<param name="flip">Flip the image vertically.</param>
+	///<param name="mips">Generate the mip chain. Otherwise only level 0 is stored.</param>
+	static bool decodeImage(const std::string& path, ImageData& image, bool flip = false, bool mips = true);
+
+	///<summary>Create a texture from a decoded image, streaming the pixels through a pixel unpack buffer.</summary>
+	///<param name="srgb">Store the texture in an sRGB format so it is linearized when sampled.</param>
+	static GLuint uploadImage(const ImageData& image, bool srgb = false);
+
+	///<summary>Get the pixel format matching a number of channels.</summary>
+	static GLenum getFormat(int channels);
+	///<summary>Estimate the GPU memory of a texture created from the image, assuming drivers pad 3 channel textures to 4.</summary>
+	static size_t getTextureSize(const ImageData& image);
+
+private:
+	AssetLoader(const AssetLoader&) = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::deque<std::function<void()>> uploads;
+	std::mutex jobMutex, uploadMutex;
+	std::condition_variable jobCondition, uploadCondition;
+	std::atomic<unsigned int> pending{ 0 };
+	bool stopping = false;
+
+	void workerLoop();
+	void submit(std::function<void()> job);
+	///<summary>Queue a batch of uploads. The batch is run in order.</summary>
+	void enqueueUploads(std::vector<std::function<void()>> tasks);
+};
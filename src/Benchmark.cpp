@@ -0,0 +1,220 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <cmath>
+#include <vector>
+#include "GeometryArena.h"
+
+#define BENCHMARK_ORBIT_RADIUS 12.0f
+#define BENCHMARK_ORBIT_HEIGHT 5.0f
+#define BENCHMARK_TARGET_HEIGHT 2.0f
+// the light sweep spreads its lights over a square of this size centered on the origin
+#define LIGHT_SWEEP_EXTENT 20.0f
+#define LIGHT_SWEEP_HEIGHT 1.0f
+
+void setBenchmarkCamera(Camera* camera, const glm::vec3& up, float t)
+{
+	float angle = t * 360.0f;
+	glm::vec3 target(0.0f, BENCHMARK_TARGET_HEIGHT, 0.0f);
+	glm::vec3 position(
+		BENCHMARK_ORBIT_RADIUS * glm::cos(glm::radians(angle)),
+		BENCHMARK_ORBIT_HEIGHT,
+		BENCHMARK_ORBIT_RADIUS * glm::sin(glm::radians(angle))
+	);
+	glm::vec3 direction = glm::normalize(target - position);
+
+	camera->setPosition(position);
+	camera->setYaw(glm::degrees(atan2(direction.z, direction.x)));
+	camera->setPitch(glm::degrees(asin(direction.y)));
+	camera->updateVectors(up);
+}
+
+///<summary>Render the warmup and timed frames of a run along the benchmark path. The profiler is reset after the warmup frames.</summary>
+///<param name="drawTotals">Receives the draw counters summed over the timed frames.</param>
+static void renderBenchmarkFrames(GLFWwindow* window, Renderer* renderer, Scene* scene, FrameProfiler& profiler, const BenchmarkOptions& options, DrawStats& drawTotals)
+{
+	unsigned int totalFrames = options.warmupFrames + options.frames;
+	for (unsigned int frame = 0; frame < totalFrames; frame++) {
+		if (frame == options.warmupFrames) {
+			profiler.reset();
+		}
+
+		// the warmup frames render the start of the path
+		unsigned int pathFrame = frame < options.warmupFrames ? 0 : frame - options.warmupFrames;
+		setBenchmarkCamera(scene->getActiveCamera(), scene->getUp(), (float)pathFrame / (float)std::max(options.frames, 1u));
+
+		profiler.beginFrame();
+
+		renderer->setTime(frame * options.timeStep);
+		renderer->preRender(scene);
+		renderer->render(scene);
+
+		if (frame >= options.warmupFrames) {
+			const DrawStats& drawStats = renderer->getDrawStats();
+			drawTotals.drawCalls += drawStats.drawCalls;
+			drawTotals.shaderBinds += drawStats.shaderBinds;
+			drawTotals.materialBinds += drawStats.materialBinds;
+			drawTotals.textureBinds += drawStats.textureBinds;
+			drawTotals.vertexArrayBinds += drawStats.vertexArrayBinds;
+			drawTotals.transformUploads += drawStats.transformUploads;
+			drawTotals.transformsRecomputed += drawStats.transformsRecomputed;
+			drawTotals.instancesDrawn += drawStats.instancesDrawn;
+			drawTotals.indirectCommands += drawStats.indirectCommands;
+			drawTotals.meshletsSubmitted += drawStats.meshletsSubmitted;
+		}
+
+		for (auto& updateFunction_it : scene->getUpdateFunctions()) {
+			updateFunction_it.second(scene);
+		}
+
+		glfwSwapBuffers(window);
+		glfwPollEvents();
+
+		profiler.endFrame();
+	}
+}
+
+int runBenchmark(GLFWwindow* window, Renderer* renderer, Scene* scene, const BenchmarkOptions& options)
+{
+	FrameProfiler profiler;
+	FrameProfiler* previousProfiler = renderer->getProfiler();
+	renderer->setProfiler(&profiler);
+
+	// do not let vsync limit the frame rate
+	glfwSwapInterval(0);
+
+	// draw counters summed over the timed frames
+	DrawStats drawTotals;
+	printf("running benchmark: %u warmup frames, %u timed frames\n", options.warmupFrames, options.frames);
+
+	renderBenchmarkFrames(window, renderer, scene, profiler, options, drawTotals);
+	profiler.flush();
+	renderer->setProfiler(previousProfiler);
+	checkGLError("runBenchmark -- frames");
+
+	std::ofstream file;
+	if (!options.outputPath.empty()) {
+		file.open(options.outputPath);
+		if (!file.is_open()) {
+			std::cerr << "ERROR::BENCHMARK:: could not open " << options.outputPath << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	std::ostream& out = file.is_open() ? file : std::cout;
+
+	out << "{\n";
+	out << "\t\"scene\": \"" << options.sceneName << "\",\n";
+	out << "\t\"width\": " << renderer->getWidth() << ",\n";
+	out << "\t\"height\": " << renderer->getHeight() << ",\n";
+	out << "\t\"warmup_frames\": " << options.warmupFrames << ",\n";
+	out << "\t\"time_step\": " << options.timeStep << ",\n";
+	out << "\t\"gl_renderer\": \"" << glGetString(GL_RENDERER) << "\",\n";
+	out << "\t\"gl_version\": \"" << glGetString(GL_VERSION) << "\",\n";
+	const GeometryArena& arena = GeometryArena::get();
+	out << "\t\"vertex_stride\": " << arena.getVertexStride() << ",\n";
+	out << "\t\"vertex_bytes\": " << arena.getVerticesUsed() * arena.getVertexStride() << ",\n";
+	out << "\t\"position_stream_bytes\": " << arena.getVerticesUsed() * arena.getPositionStride() << ",\n";
+	double frameCount = options.frames > 0 ? options.frames : 1;
+	out << "\t\"draw_stats\": {\n";
+	out << "\t\t\"draw_calls\": " << drawTotals.drawCalls / frameCount << ",\n";
+	out << "\t\t\"shader_binds\": " << drawTotals.shaderBinds / frameCount << ",\n";
+	out << "\t\t\"material_binds\": " << drawTotals.materialBinds / frameCount << ",\n";
+	out << "\t\t\"texture_binds\": " << drawTotals.textureBinds / frameCount << ",\n";
+	out << "\t\t\"vertex_array_binds\": " << drawTotals.vertexArrayBinds / frameCount << ",\n";
+	out << "\t\t\"transform_uploads\": " << drawTotals.transformUploads / frameCount << ",\n";
+	out << "\t\t\"transforms_recomputed\": " << drawTotals.transformsRecomputed / frameCount << ",\n";
+	out << "\t\t\"instances_drawn\": " << drawTotals.instancesDrawn / frameCount << ",\n";
+	out << "\t\t\"indirect_commands\": " << drawTotals.indirectCommands / frameCount << ",\n";
+	out << "\t\t\"meshlets_submitted\": " << drawTotals.meshletsSubmitted / frameCount << "\n";
+	out << "\t},\n";
+	out << "\t\"timings\": ";
+	profiler.writeJson(out);
+	out << "\n}\n";
+
+	if (file.is_open()) {
+		printf("benchmark results written to %s\n", options.outputPath.c_str());
+	}
+	return EXIT_SUCCESS;
+}
+
+int runLightSweep(GLFWwindow* window, Renderer* renderer, Scene* scene, const BenchmarkOptions& options)
+{
+	static const unsigned int lightCounts[] = { 16, 128, 1024 };
+
+	std::ofstream file;
+	if (!options.outputPath.empty()) {
+		file.open(options.outputPath);
+		if (!file.is_open()) {
+			std::cerr << "ERROR::BENCHMARK:: could not open " << options.outputPath << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	std::ostream& out = file.is_open() ? file : std::cout;
+
+	FrameProfiler* previousProfiler = renderer->getProfiler();
+	LightingMode previousMode = renderer->getLightingMode();
+	LightManager* lightManager = scene->getLightManager();
+	glfwSwapInterval(0);
+
+	out << "{\n";
+	out << "\t\"scene\": \"" << options.sceneName << "\",\n";
+	out << "\t\"width\": " << renderer->getWidth() << ",\n";
+	out << "\t\"height\": " << renderer->getHeight() << ",\n";
+	out << "\t\"gl_renderer\": \"" << glGetString(GL_RENDERER) << "\",\n";
+	out << "\t\"runs\": [";
+	bool first = true;
+	for (unsigned int lightCount : lightCounts) {
+		// small lights on a grid so the overlap per pixel stays similar as the count grows
+		std::vector<PointLight*> lights;
+		int side = (int)std::ceil(std::sqrt((float)lightCount));
+		float spacing = LIGHT_SWEEP_EXTENT / side;
+		for (unsigned int i = 0; i < lightCount; i++) {
+			PointLight* light = new PointLight(
+				glm::vec3((i % side + 0.5f) * spacing - LIGHT_SWEEP_EXTENT / 2, LIGHT_SWEEP_HEIGHT, (i / side + 0.5f) * spacing - LIGHT_SWEEP_EXTENT / 2),
+				glm::vec3(0.5f + 0.5f * std::cos(i * 2.4f), 0.5f + 0.5f * std::cos(i * 2.4f + 2.1f), 0.5f + 0.5f * std::cos(i * 2.4f + 4.2f)),
+				0.05f,
+				1.0f,
+				1.0f,
+				1.0f,
+				1.4f,
+				7.2f
+			);
+			lightManager->addPointLight(light);
+			lights.push_back(light);
+		}
+
+		for (int mode = 0; mode < (int)LightingMode::Count; mode++) {
+			const char* modeName = getLightingModeName((LightingMode)mode);
+			printf("light sweep: %u lights, %s\n", lightCount, modeName);
+			renderer->setLightingMode((LightingMode)mode);
+			FrameProfiler profiler;
+			renderer->setProfiler(&profiler);
+			DrawStats drawTotals;
+			renderBenchmarkFrames(window, renderer, scene, profiler, options, drawTotals);
+			profiler.flush();
+			renderer->setProfiler(previousProfiler);
+
+			PassStats cpu = profiler.getCpuStats("deferredLighting");
+			PassStats gpu = profiler.getGpuStats("deferredLighting");
+			out << (first ? "\n" : ",\n");
+			first = false;
+			out << "\t\t{ \"lights\": " << lightCount << ", \"mode\": \"" << modeName << "\""
+				<< ", \"lighting_cpu_ms\": " << cpu.mean << ", \"lighting_gpu_ms\": " << gpu.mean << ", \"lighting_gpu_p95_ms\": " << gpu.p95
+				<< ", \"frame_cpu_ms\": " << profiler.getFrameStats().mean << " }";
+		}
+
+		for (PointLight* light : lights) {
+			lightManager->removePointLight(light);
+			delete light;
+		}
+	}
+	out << "\n\t]\n}\n";
+	renderer->setLightingMode(previousMode);
+	checkGLError("runLightSweep");
+
+	if (file.is_open()) {
+		printf("light sweep results written to %s\n", options.outputPath.c_str());
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include "renderer.h"
+#include "scene.h"
+#include "FrameProfiler.h"
+
+///<summary>Settings for a fixed length benchmark run.</summary>
+struct BenchmarkOptions {
+	///<summary>Number of frames that are timed.</summary>
+	unsigned int frames = 300;
+	///<summary>Number of frames rendered before timing starts, so shader compilation and driver warmup do not skew the results.</summary>
+	unsigned int warmupFrames = 30;
+	///<summary>Simulated time between frames in seconds. The scene is advanced by a fixed step so every run renders the same images.</summary>
+	float timeStep = 1.0f / 60.0f;
+	///<summary>Name of the scene that was loaded, written to the report.</summary>
+	std::string sceneName = "basic";
+	///<summary>File the JSON report is written to. The report is written to stdout if empty.</summary>
+	std::string outputPath;
+};
+
+///<summary>Render a fixed number of frames along a scripted camera path and write per pass CPU/GPU timings as JSON.
+///<para>The camera orbits the origin once over the timed frames. Scene update functions are run every frame as in the interactive loop.</para>
+///</summary>
+///<param name="window">Window owning the current context. May be hidden.</param>
+///<param name="renderer">Renderer used to draw the scene.</param>
+///<param name="scene">Scene to render. Its active camera is moved along the benchmark path.</param>
+///<param name="options">Benchmark settings.</param>
+///<returns>EXIT_SUCCESS if the report was written.</returns>
+int runBenchmark(GLFWwindow* window, Renderer* renderer, Scene* scene, const BenchmarkOptions& options);
+
+///<summary>Compare the deferred lighting modes as the number of point lights grows.
+///<para>For every light count a grid of small point lights is added above the scene, then each lighting mode renders the warmup and timed frames of the options
+///along the benchmark path. The timings of the deferredLighting pass are written as JSON. The added lights are removed afterwards.</para>
+///</summary>
+///<returns>EXIT_SUCCESS if the report was written.</returns>
+int runLightSweep(GLFWwindow* window, Renderer* renderer, Scene* scene, const BenchmarkOptions& options);
+
+///<summary>Position the camera on the benchmark orbit and point it at the orbit center.</summary>
+///<param name="camera">Camera to move.</param>
+///<param name="up">World up vector of the scene.</param>
+///<param name="t">Progress along the path in the range [0, 1].</param>
+void setBenchmarkCamera(Camera* camera, const glm::vec3& up, float t);
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+///<summary>Axis aligned bounding box. A default constructed box is empty and grows as points are added.</summary>
+struct AABB {
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	AABB() {}
+	AABB(const glm::vec3& min, const glm::vec3& max) : min(min), max(max) {}
+
+	bool isEmpty() const { return this->min.x > this->max.x; }
+	glm::vec3 getCenter() const { return (this->min + this->max) * 0.5f; }
+	glm::vec3 getExtents() const { return (this->max - this->min) * 0.5f; }
+
+	void expand(const glm::vec3& point) {
+		this->min = glm::min(this->min, point);
+		this->max = glm::max(this->max, point);
+	}
+
+	void expand(const AABB& box) {
+		if (box.isEmpty())
+			return;
+		this->min = glm::min(this->min, box.min);
+		this->max = glm::max(this->max, box.max);
+	}
+
+	///<summary>Return the box that encloses this box after it has been transformed by the matrix.</summary>
+	AABB transform(const glm::mat4& matrix) const {
+		if (this->isEmpty())
+			return *this;
+		// transform the center and project the extents onto each axis of the transformed box
+		glm::vec3 center = glm::vec3(matrix * glm::vec4(this->getCenter(), 1.0f));
+		glm::vec3 extents = this->getExtents();
+		glm::vec3 newExtents(0.0f);
+		for (int i = 0; i < 3; i++) {
+			for (int j = 0; j < 3; j++) {
+				newExtents[i] += std::abs(matrix[j][i]) * extents[j];
+			}
+		}
+		return AABB(center - newExtents, center + newExtents);
+	}
+};
+
+///<summary>Bounding sphere. A negative radius marks an empty sphere.</summary>
+struct BoundingSphere {
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = -1.0f;
+
+	BoundingSphere() {}
+	BoundingSphere(const glm::vec3& center, float radius) : center(center), radius(radius) {}
+
+	bool isEmpty() const { return this->radius < 0.0f; }
+
+	///<summary>Return the sphere that encloses this sphere after it has been transformed by the matrix.
+	///<para>The radius is scaled by the largest axis scale so non uniform scales stay conservative.</para>
+	///</summary>
+	BoundingSphere transform(const glm::mat4& matrix) const {
+		if (this->isEmpty())
+			return *this;
+		float scale = std::max(std::max(
+			glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+			glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1]))),
+			glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2])));
+		return BoundingSphere(glm::vec3(matrix * glm::vec4(this->center, 1.0f)), this->radius * std::sqrt(scale));
+	}
+};
+
+///<summary>The box and sphere of a drawable, both in the same space.</summary>
+struct Bounds {
+	AABB box;
+	BoundingSphere sphere;
+
+	///<summary>Build bounds that enclose the points.
+	///<para>The sphere is centered on the box so it can be computed in a single extra pass over the points.</para>
+	///</summary>
+	///<param name="points">Pointer to the first point.</param>
+	///<param name="count">Number of points.</param>
+	///<param name="stride">Distance in bytes between two points. Allows reading positions straight out of interleaved vertex data.</param>
+	static Bounds fromPoints(const void* points, size_t count, size_t stride) {
+		Bounds bounds;
+		const char* data = (const char*)points;
+		for (size_t i = 0; i < count; i++) {
+			bounds.box.expand(*(const glm::vec3*)(data + i * stride));
+		}
+		if (bounds.box.isEmpty())
+			return bounds;
+
+		glm::vec3 center = bounds.box.getCenter();
+		float radiusSquared = 0.0f;
+		for (size_t i = 0; i < count; i++) {
+			glm::vec3 offset = *(const glm::vec3*)(data + i * stride) - center;
+			radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+		}
+		bounds.sphere = BoundingSphere(center, std::sqrt(radiusSquared));
+		return bounds;
+	}
+
+	///<summary>Build bounds that enclose both bounds.</summary>
+	void expand(const Bounds& other) {
+		if (other.box.isEmpty())
+			return;
+		this->box.expand(other.box);
+		// a sphere through the corners of the merged box encloses everything inside it
+		glm::vec3 center = this->box.getCenter();
+		this->sphere = BoundingSphere(center, glm::length(this->box.getExtents()));
+	}
+
+	Bounds transform(const glm::mat4& matrix) const {
+		Bounds bounds;
+		bounds.box = this->box.transform(matrix);
+		bounds.sphere = this->sphere.transform(matrix);
+		return bounds;
+	}
+};
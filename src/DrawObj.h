@@ -4,8 +4,17 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include "shader.h"
+#include "Bounds.h"
+#include "MaterialManager.h"
+#include "GeometryArena.h"
 
 struct Material {
+	///<summary>Stable id assigned by the MaterialManager. 0 until the material is registered.</summary>
+	unsigned int id = 0;
+	///<summary>Whether the constants changed since they were uploaded. Set through MaterialManager::markDirty.</summary>
+	bool dirty = false;
+	///<summary>References taken through the MaterialManager. 0 for materials that were never interned.</summary>
+	int references = 0;
 	std::string Name = "default material";
 	glm::vec4 AmbientColor = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
 	glm::vec4 DiffuseColor = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
@@ -22,21 +31,88 @@ struct Material {
 	std::vector<GLuint> textureReflect;
 };
 
+// number of textures of a single type that have their sampler uniforms interned up front
+#define MAX_MATERIAL_TEXTURES 8
+
+///<summary>Handles to the sampler uniforms of the material struct used by the shaders. The constants live in the MaterialConstants block.
+///<para>The texture samplers are named "material.texture_diffuse", "material.texture_diffuse2", "material.texture_diffuse3" and so on.</para>
+///</summary>
+struct MaterialUniforms {
+	Uniform textureAmbient[MAX_MATERIAL_TEXTURES];
+	Uniform textureDiffuse[MAX_MATERIAL_TEXTURES];
+	Uniform textureSpecular[MAX_MATERIAL_TEXTURES];
+	Uniform textureNormal[MAX_MATERIAL_TEXTURES];
+	Uniform textureReflect[MAX_MATERIAL_TEXTURES];
+
+	static const MaterialUniforms& get() {
+		static const MaterialUniforms uniforms;
+		return uniforms;
+	}
+
+private:
+	MaterialUniforms()
+	{
+		for (int i = 0; i < MAX_MATERIAL_TEXTURES; i++) {
+			std::string suffix = i > 0 ? std::to_string(i + 1) : "";
+			this->textureAmbient[i] = Uniform("material.texture_ambient" + suffix);
+			this->textureDiffuse[i] = Uniform("material.texture_diffuse" + suffix);
+			this->textureSpecular[i] = Uniform("material.texture_specular" + suffix);
+			this->textureNormal[i] = Uniform("material.texture_normal" + suffix);
+			this->textureReflect[i] = Uniform("material.texture_reflect" + suffix);
+		}
+	}
+};
+
 class IDrawObj {
 public:
-	IDrawObj(std::string name): name(name), material(new Material()) {}
+	IDrawObj(std::string name): name(name), material(MaterialManager::get().intern(Material())) {}
+	///<summary>Takes over a reference to the material, such as the one returned by MaterialManager::intern.</summary>
 	IDrawObj(std::string name, Material* material) : name(name), material(material) {}
+	virtual ~IDrawObj() { MaterialManager::get().release(this->material); }
+	IDrawObj(const IDrawObj&) = delete;
+	IDrawObj& operator=(const IDrawObj&) = delete;
 
 	/*  Mesh Data  */
-	// render the mesh
-	virtual void Draw(const Shader& shader, GLuint baseUnit = 0) = 0;
+	// render the mesh with its material. The renderer binds materials and vertex arrays itself and only calls drawGeometry.
+	virtual void Draw(const Shader& shader, GLuint baseUnit = 0) {
+		MaterialManager::get().bind(shader, this->material, baseUnit);
+		glBindVertexArray(this->getVertexArray());
+		this->drawGeometry();
+	}
+	///<summary>Get the vertex array the object is drawn with.</summary>
+	virtual GLuint getVertexArray() = 0;
+	///<summary>Get a vertex array with only the positions, for depth only passes. Defaults to the full one.</summary>
+	virtual GLuint getDepthVertexArray() { return this->getVertexArray(); }
+	///<summary>Draw only the positions, without binding a material.</summary>
+	virtual void DrawDepth() {
+		glBindVertexArray(this->getDepthVertexArray());
+		this->drawGeometry();
+	}
+	///<summary>Issue the draw call. The vertex array and material must already be bound.</summary>
+	///<param name="instanceCount">Number of instances to draw. More than 1 draws with glDrawElementsInstanced.</param>
+	///<param name="lod">Level of detail to draw, clamped to the levels the object has.</param>
+	virtual void drawGeometry(GLsizei instanceCount = 1, size_t lod = 0) = 0;
+	///<summary>Get where the object is stored in the GeometryArena, or nullptr if it has buffers of its own. Only arena objects can be drawn indirectly.</summary>
+	///<param name="lod">Level of detail, clamped to the levels the object has.</param>
+	virtual const GeometryRange* getGeometry(size_t lod = 0) { return nullptr; }
+	///<summary>Get the number of levels of detail, 1 being only the full object. Each level has about half the triangles of the one before.</summary>
+	virtual size_t getLodCount() { return 1; }
 
 	virtual Material* getMaterial() { return this->material; };
-	virtual void setMaterial(Material* material) { this->material = material; };
+	///<summary>Takes over a reference to the material and releases the current one.</summary>
+	virtual void setMaterial(Material* material) { MaterialManager::get().release(this->material); this->material = material; };
 	virtual std::string getName() { return this->name; };
 	virtual void setName(std::string name) { this->name = name; };
+	///<summary>Get the bounds of the vertices in object space.</summary>
+	const Bounds& getBounds() const { return this->bounds; }
+	///<summary>Incremented every time the geometry is rebuilt with new bounds, so the owners of copies know to refresh them.</summary>
+	uint32_t getBoundsVersion() const { return this->boundsVersion; }
 
 protected:
 	std::string name;
 	Material* material;
+	Bounds bounds;
+	uint32_t boundsVersion = 0;
+
+	void setBounds(const Bounds& bounds) { this->bounds = bounds; this->boundsVersion++; }
 };
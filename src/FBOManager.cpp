@@ -279,24 +279,23 @@ GBuffer::GBuffer(int width, int height): width(width), height(height), pLightSph
 }
 
 void GBuffer::initialize(int width, int height) {
+	// a resize recreates everything at the new size
+	if (this->gBuffer != 0) {
+		glDeleteFramebuffers(1, &this->gBuffer);
+		GLuint textures[] = { this->gNormal, this->gAlbedoSpec, this->depthBuffer, this->depthCopy, this->gFinal };
+		glDeleteTextures(5, textures);
+	}
+
 	glGenFramebuffers(1, &this->gBuffer);
 	glBindFramebuffer(GL_FRAMEBUFFER, this->gBuffer);
 
-	// position color buffer
-	glGenTextures(1, &this->gPosition);
-	glBindTexture(GL_TEXTURE_2D, gPosition);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
-
-	// normal color buffer
+	// normal color buffer. world space normals are octahedral encoded into two channels, position is reconstructed from depth
 	glGenTextures(1, &this->gNormal);
 	glBindTexture(GL_TEXTURE_2D, gNormal);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, NULL);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, width, height, 0, GL_RG, GL_FLOAT, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gNormal, 0);
 
 	// albedo + spec intensity color buffer
 	glGenTextures(1, &this->gAlbedoSpec);
@@ -304,15 +303,27 @@ void GBuffer::initialize(int width, int height) {
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gAlbedoSpec, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gAlbedoSpec, 0);
 
-	GLuint attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-	glDrawBuffers(3, attachments);
+	GLuint attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, attachments);
 
-	glGenRenderbuffers(1, &this->depthBuffer);
-	glBindRenderbuffer(GL_RENDERBUFFER, this->depthBuffer);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_STENCIL, width, height);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, this->depthBuffer);
+	// depth is a texture so the Hi-Z pyramid can be built from it
+	glGenTextures(1, &this->depthBuffer);
+	glBindTexture(GL_TEXTURE_2D, this->depthBuffer);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_DEPTH_STENCIL_TEXTURE_MODE, GL_DEPTH_COMPONENT);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, this->depthBuffer, 0);
+
+	// copy of the depth that the lighting passes sample. the attachment stays bound for the stencil and depth tests, sampling it would be a feedback loop
+	glGenTextures(1, &this->depthCopy);
+	glBindTexture(GL_TEXTURE_2D, this->depthCopy);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_DEPTH_STENCIL_TEXTURE_MODE, GL_DEPTH_COMPONENT);
 
 	// final color texture.
 	glGenTextures(1, &this->gFinal);
@@ -320,7 +331,7 @@ void GBuffer::initialize(int width, int height) {
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGB, GL_FLOAT, NULL);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, this->gFinal, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, this->gFinal, 0);
 
 	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 		std::cout << "Framebuffer not complete!" << std::endl;
@@ -337,16 +348,17 @@ void GBuffer::BindForWriting()
 {
 	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->gBuffer);
 
-	std::vector<GLenum> drawBuffers = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-	glDrawBuffers(3, drawBuffers.data());
+	std::vector<GLenum> drawBuffers = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, drawBuffers.data());
 
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
 void GBuffer::DSLightingPass(const Shader& directionShader, const Shader& pointShader, const Shader& depthShader, std::vector<PointLight*> plights) {
+	this->copyDepthForSampling();
 	glBindFramebuffer(GL_FRAMEBUFFER, this->gBuffer);
-	glDrawBuffer(GL_COLOR_ATTACHMENT3);
+	glDrawBuffer(GL_COLOR_ATTACHMENT2);
 	glClear(GL_COLOR_BUFFER_BIT);
 
 	// dont want to write to any color buffers.
@@ -357,6 +369,10 @@ void GBuffer::DSLightingPass(const Shader& directionShader, const Shader& pointS
 
 
 	for (PointLight* plight : plights) {
+		// the sphere is scaled to the radius of the light and moved to it. built here since the cached world matrix of the sphere is only refreshed once a frame
+		glm::mat4 lightModel = glm::scale(glm::translate(glm::mat4(1.0f), plight->getPosition()), glm::vec3(plight->getRadius()));
+		glm::mat3 lightNormal = glm::transpose(glm::inverse(glm::mat3(lightModel)));
+
 		///////////////////////////////////////////////////////////////////////////////////////////
 		// stencil pass
 		///////////////////////////////////////////////////////////////////////////////////////////
@@ -375,10 +391,8 @@ void GBuffer::DSLightingPass(const Shader& directionShader, const Shader& pointS
 		glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
 		glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
 
-		this->pLightSphere->setScale(glm::vec3(plight->getRadius()));
-		this->pLightSphere->setPosition(plight->getPosition());
-		pLightSphere->uploadUniforms(depthShader);
-		this->pLightSphere->Draw(depthShader);
+		Model::uploadUniforms(depthShader, lightModel, lightNormal);
+		this->pLightSphere->DrawDepth();
 
 		//disable depth testing and depth mask so the lighting pass cannot write to the depth buffer
 		glEnable(GL_CULL_FACE);
@@ -387,7 +401,7 @@ void GBuffer::DSLightingPass(const Shader& directionShader, const Shader& pointS
 		///////////////////////////////////////////////////////////////////////////////////////////
 		// point lighting pass
 		///////////////////////////////////////////////////////////////////////////////////////////
-		glDrawBuffer(GL_COLOR_ATTACHMENT3);
+		glDrawBuffer(GL_COLOR_ATTACHMENT2);
 
 		// dont need depth
 		glDisable(GL_DEPTH_TEST);
@@ -403,20 +417,14 @@ void GBuffer::DSLightingPass(const Shader& directionShader, const Shader& pointS
 
 		pointShader.Use();
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, this->gPosition);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, this->gNormal);
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, this->gAlbedoSpec);
+		// the light volume draws bind their own textures, rebind the gBuffer every light
+		this->bindTextures();
 
 		//glClear(GL_COLOR_BUFFER_BIT);
 
 		// for each light move the sphere to it's location and set radius its max attenuation distance. then draw the sphere.
 		plight->uploadUniforms(pointShader);
-		this->pLightSphere->setScale(glm::vec3(plight->getRadius()));
-		this->pLightSphere->setPosition(plight->getPosition());
-		pLightSphere->uploadUniforms(pointShader);
+		Model::uploadUniforms(pointShader, lightModel, lightNormal);
 
 		this->pLightSphere->Draw(pointShader);
 
@@ -427,10 +435,47 @@ void GBuffer::DSLightingPass(const Shader& directionShader, const Shader& pointS
 
 	glDisable(GL_STENCIL_TEST);
 
+	this->directionLightingPass(directionShader);
+}
+
+void GBuffer::instancedLightingPass(const Shader& directionShader, const Shader& volumeShader, GLsizei lightCount) {
+	this->copyDepthForSampling();
+	glBindFramebuffer(GL_FRAMEBUFFER, this->gBuffer);
+	glDrawBuffer(GL_COLOR_ATTACHMENT2);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	if (lightCount > 0) {
+		// only the back faces of each volume are drawn, and only where they are behind the surface.
+		// this lights every surface in front of the back of the volume, the shader rejects the ones in front of the volume by distance
+		glDepthMask(GL_FALSE);
+		glEnable(GL_DEPTH_TEST);
+		glDepthFunc(GL_GREATER);
+		glCullFace(GL_FRONT);
+		glEnable(GL_BLEND);
+		glBlendEquation(GL_FUNC_ADD);
+		glBlendFunc(GL_ONE, GL_ONE);
+
+		volumeShader.Use();
+		this->bindTextures();
+		IDrawObj* volume = this->pLightSphere->getMeshes()[0];
+		glBindVertexArray(volume->getVertexArray());
+		volume->drawGeometry(lightCount);
+		glBindVertexArray(0);
+
+		glDepthFunc(GL_LESS);
+		glCullFace(GL_BACK);
+		glDisable(GL_BLEND);
+	}
+
+	this->directionLightingPass(directionShader);
+	checkGLError("GBuffer::instancedLightingPass");
+}
+
+void GBuffer::directionLightingPass(const Shader& directionShader) {
 	///////////////////////////////////////////////////////////////////////////////////////////
 	// direction lighting pass
 	///////////////////////////////////////////////////////////////////////////////////////////
-	glDrawBuffer(GL_COLOR_ATTACHMENT3);
+	glDrawBuffer(GL_COLOR_ATTACHMENT2);
 
 	glDisable(GL_DEPTH_TEST);
 	glEnable(GL_BLEND);
@@ -438,6 +483,7 @@ void GBuffer::DSLightingPass(const Shader& directionShader, const Shader& pointS
 	glBlendFunc(GL_ONE, GL_ONE);
 
 	directionShader.Use();
+	this->bindTextures();
 
 	this->drawQuad();
 
@@ -447,15 +493,47 @@ void GBuffer::DSLightingPass(const Shader& directionShader, const Shader& pointS
 	glDepthMask(GL_TRUE);
 }
 
+void GBuffer::clusteredLightingPass(const Shader& clusteredShader) {
+	this->copyDepthForSampling();
+	glBindFramebuffer(GL_FRAMEBUFFER, this->gBuffer);
+	glDrawBuffer(GL_COLOR_ATTACHMENT2);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	// every light is added in the shader, no blending or depth needed
+	glDisable(GL_DEPTH_TEST);
+	glDepthMask(GL_FALSE);
+	clusteredShader.Use();
+	this->bindTextures();
+	this->drawQuad();
+
+	glEnable(GL_DEPTH_TEST);
+	glDepthMask(GL_TRUE);
+	checkGLError("GBuffer::clusteredLightingPass");
+}
+
 void GBuffer::copyDepth(GLuint fbo, GLsizei targetWidth, GLsizei targetHeight) {
 	glBindFramebuffer(GL_READ_FRAMEBUFFER, this->gBuffer);
-	glReadBuffer(GL_COLOR_ATTACHMENT3);
+	glReadBuffer(GL_COLOR_ATTACHMENT2);
 	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
 	glBlitFramebuffer(0, 0, this->width, this->height, 0, 0, targetWidth, targetHeight, GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT, GL_NEAREST);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	checkGLError("GBuffer::copyDepth");
 }
 
+void GBuffer::copyDepthForSampling() {
+	glCopyImageSubData(this->depthBuffer, GL_TEXTURE_2D, 0, 0, 0, 0, this->depthCopy, GL_TEXTURE_2D, 0, 0, 0, 0, this->width, this->height, 1);
+	checkGLError("GBuffer::copyDepthForSampling");
+}
+
+void GBuffer::bindTextures() {
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, this->depthCopy);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, this->gNormal);
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, this->gAlbedoSpec);
+}
+
 void GBuffer::drawQuad() {
 	if (quadVAO == 0)
     {
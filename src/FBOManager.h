@@ -87,9 +87,10 @@ public:
 	int getHeight() { return this->height; }
 	void setDimensions(int width, int height);
 
-	GLuint getPositionTexture() { return this->gPosition; }
 	GLuint getNormalTexture() { return this->gNormal; }
 	GLuint getAlbedoSpecTexture() { return this->gAlbedoSpec; }
+	///<summary>The depth/stencil texture. Only the depth can be sampled.</summary>
+	GLuint getDepthTexture() { return this->depthBuffer; }
 
 	///<summary>set the gBuffer active so that everything drawn will be drawn into it</summary>
 	void BindForWriting();
@@ -98,12 +99,27 @@ public:
 	///<para>Point lighting: renders a sphere for each point light with radius set to the effective lighting range of the light. This will prevent unecessary lighting calculations from being applied to geometry in the scene. </para>
 	///<para>Direction lighting: renders a quad filling the entire screen. This is appropriate since directional lighting applies to all objects in the scene.</para>
 	///</summary>
-	///<param name="directionShader">The directional light shader. should have at least three inputs: gPosition, gNormal, gAlbedoSpec</param>
-	///<param name="pointShader">The point light shader. should have at least three inputs: gPosition, gNormal, gAlbedoSpec</param>
+	///<param name="directionShader">The directional light shader. should have at least three inputs: gDepth, gNormal, gAlbedoSpec and the inverseViewProjection to reconstruct positions with</param>
+	///<param name="pointShader">The point light shader. should have at least three inputs: gDepth, gNormal, gAlbedoSpec and the inverseViewProjection to reconstruct positions with</param>
 	///<param name="depthShader">The depth shader. this is only used for object depth in relation to camera.</param>
 	///<param name="plights">a vector containing all point lights in the scene that will have impact on the shading</param>
 	void DSLightingPass(const Shader& directionShader, const Shader& pointShader, const Shader& depthShader, std::vector<PointLight*> plights);
 
+	///<summary>renders the scene to the final color texture like DSLightingPass, but draws all point light volumes with a single instanced draw.
+	///<para>Instead of a stencil pass per light only the back faces of the volumes are drawn, depth tested with GL_GREATER against the gBuffer depth attachment while the shader reads positions from a copy of it.
+	///The light parameters are read by instance index from the light storage buffer of the LightManager, which must be bound.</para>
+	///</summary>
+	///<param name="directionShader">The directional light shader.</param>
+	///<param name="volumeShader">The instanced point light shader.</param>
+	///<param name="lightCount">Number of point lights, which are the first lights of the light buffer.</param>
+	void instancedLightingPass(const Shader& directionShader, const Shader& volumeShader, GLsizei lightCount);
+
+	///<summary>renders the scene to the final color texture with a single full screen pass that shades every light.
+	///<para>The lights of the LightManager and the cluster lists of LightClusters must already be bound, and the shader needs the same inputs as the directional light shader.</para>
+	///</summary>
+	///<param name="clusteredShader">The clustered lighting shader.</param>
+	void clusteredLightingPass(const Shader& clusteredShader);
+
 	///<summary>copies the gBuffer depth data into the specified frame buffer object.
 	///<para>This is useful for combining forward rendering with deferred rendering, as you can get proper visual occlusion on objects that are forward rendered.</para>
 	///</summary>
@@ -113,10 +129,12 @@ public:
 	void copyDepth(GLuint fbo, int width, int height);
 
 private:
-	// textures used by gBuffer. gPosition: world space position, gNormal: world space surface normal, gAlbedoSpec: albedo color with specular intensity alpha channel
-	GLuint gPosition, gNormal, gAlbedoSpec, gFinal;
-	GLuint gBuffer; // fbo
-	GLuint depthBuffer; // rbo
+	// textures used by gBuffer. gNormal: octahedral encoded world space surface normal, gAlbedoSpec: albedo color with specular intensity alpha channel
+	// world space position is reconstructed from the depth texture
+	GLuint gNormal = 0, gAlbedoSpec = 0, gFinal = 0;
+	GLuint gBuffer = 0; // fbo
+	GLuint depthBuffer = 0; // depth/stencil texture
+	GLuint depthCopy = 0; // copy of depthBuffer sampled by the lighting passes
 	GLuint quadVBO = 0, quadVAO = 0; // vao for drawing 2d scene
 	int width, height;
 
@@ -128,4 +146,10 @@ private:
 	draw the quad.
 	*/
 	void drawQuad();
+	///<summary>add the directional lights to the final color texture with a full screen quad. Ends with depth writes enabled.</summary>
+	void directionLightingPass(const Shader& directionShader);
+	///<summary>copy the depth of the geometry pass into the texture the lighting passes sample, so the attachment can still be used for stencil and depth tests</summary>
+	void copyDepthForSampling();
+	///<summary>bind the depth copy, normal and albedo textures to units 0, 1 and 2 for the lighting shaders</summary>
+	void bindTextures();
 };
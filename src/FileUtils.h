@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+///<summary>File helpers shared by the on disk caches.</summary>
+class FileUtils {
+public:
+	///<summary>Last write time of a file as a raw tick count, or 0 if it cannot be read. Only meaningful when compared with another value from this function.</summary>
+	static int64_t getModifiedTime(const std::string& path)
+	{
+		std::error_code error;
+		std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+		return error ? 0 : (int64_t)time.time_since_epoch().count();
+	}
+
+	///<summary>Absolute path with every existing part resolved and forward slashes, so different spellings of the same file compare equal. Returns the path unchanged on failure.</summary>
+	static std::string getCanonicalPath(const std::string& path)
+	{
+		std::error_code error;
+		std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+		return error ? path : canonical.generic_string();
+	}
+
+	///<summary>64 bit FNV-1a hash of a string, used to name cache entries.</summary>
+	static uint64_t hashString(const std::string& text)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : text) {
+			hash ^= (uint8_t)c;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+};
@@ -0,0 +1,171 @@
+#include "FrameProfiler.h"
+#include <algorithm>
+
+FrameProfiler::FrameProfiler() {}
+
+FrameProfiler::~FrameProfiler()
+{
+	for (auto& pending_slot : this->pending) {
+		for (auto& query : pending_slot) {
+			glDeleteQueries(1, &query.query);
+		}
+	}
+	for (auto& pass : this->passes) {
+		if (!pass.freeQueries.empty())
+			glDeleteQueries((GLsizei)pass.freeQueries.size(), pass.freeQueries.data());
+	}
+}
+
+void FrameProfiler::beginFrame()
+{
+	if (!this->enabled)
+		return;
+
+	this->frameSlot = this->frameCount % PROFILER_QUERY_LATENCY;
+	// the queries in this slot were issued PROFILER_QUERY_LATENCY frames ago and should be available by now
+	this->resolve(this->frameSlot);
+	this->frameStart = Clock::now();
+}
+
+void FrameProfiler::endFrame()
+{
+	if (!this->enabled)
+		return;
+
+	std::chrono::duration<double, std::milli> elapsed = Clock::now() - this->frameStart;
+	this->frameSamples.push_back(elapsed.count());
+	this->frameCount++;
+}
+
+void FrameProfiler::beginPass(const std::string& name)
+{
+	if (!this->enabled)
+		return;
+
+	auto it = this->passIndex.find(name);
+	if (it == this->passIndex.end()) {
+		it = this->passIndex.emplace(name, this->passes.size()).first;
+		this->passNames.push_back(name);
+		this->passes.emplace_back();
+	}
+	this->activePass = it->second;
+
+	Pass& pass = this->passes[this->activePass];
+	GLuint query;
+	if (pass.freeQueries.empty()) {
+		glGenQueries(1, &query);
+	}
+	else {
+		query = pass.freeQueries.back();
+		pass.freeQueries.pop_back();
+	}
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	this->pending[this->frameSlot].push_back({ this->activePass, query });
+	checkGLError("FrameProfiler::beginPass");
+
+	this->passStart = Clock::now();
+}
+
+void FrameProfiler::endPass()
+{
+	if (!this->enabled || this->activePass == SIZE_MAX)
+		return;
+
+	std::chrono::duration<double, std::milli> elapsed = Clock::now() - this->passStart;
+	this->passes[this->activePass].cpuSamples.push_back(elapsed.count());
+	glEndQuery(GL_TIME_ELAPSED);
+	checkGLError("FrameProfiler::endPass");
+
+	this->activePass = SIZE_MAX;
+}
+
+void FrameProfiler::flush()
+{
+	for (unsigned int i = 0; i < PROFILER_QUERY_LATENCY; i++) {
+		this->resolve(i);
+	}
+}
+
+void FrameProfiler::reset()
+{
+	this->flush();
+	for (auto& pass : this->passes) {
+		pass.cpuSamples.clear();
+		pass.gpuSamples.clear();
+	}
+	this->frameSamples.clear();
+}
+
+void FrameProfiler::resolve(unsigned int slot)
+{
+	for (auto& query : this->pending[slot]) {
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(query.query, GL_QUERY_RESULT, &elapsed);
+		this->passes[query.pass].gpuSamples.push_back(elapsed / 1.0e6);
+		this->passes[query.pass].freeQueries.push_back(query.query);
+	}
+	this->pending[slot].clear();
+	checkGLError("FrameProfiler::resolve");
+}
+
+PassStats FrameProfiler::getCpuStats(const std::string& name) const
+{
+	auto it = this->passIndex.find(name);
+	return it == this->passIndex.end() ? PassStats() : summarize(this->passes[it->second].cpuSamples);
+}
+
+PassStats FrameProfiler::getGpuStats(const std::string& name) const
+{
+	auto it = this->passIndex.find(name);
+	return it == this->passIndex.end() ? PassStats() : summarize(this->passes[it->second].gpuSamples);
+}
+
+PassStats FrameProfiler::summarize(std::vector<double> samples)
+{
+	PassStats stats;
+	if (samples.empty())
+		return stats;
+
+	std::sort(samples.begin(), samples.end());
+	double sum = 0.0;
+	for (double sample : samples)
+		sum += sample;
+
+	stats.mean = sum / samples.size();
+	stats.min = samples.front();
+	stats.max = samples.back();
+	stats.p50 = samples[(samples.size() - 1) / 2];
+	stats.p95 = samples[(size_t)((samples.size() - 1) * 0.95)];
+	return stats;
+}
+
+void FrameProfiler::writeStats(std::ostream& out, const PassStats& stats)
+{
+	out << "{ \"mean\": " << stats.mean
+		<< ", \"min\": " << stats.min
+		<< ", \"max\": " << stats.max
+		<< ", \"p50\": " << stats.p50
+		<< ", \"p95\": " << stats.p95 << " }";
+}
+
+void FrameProfiler::writeJson(std::ostream& out) const
+{
+	out << "{\n";
+	out << "\t\t\"frames\": " << this->frameSamples.size() << ",\n";
+	out << "\t\t\"frame_cpu_ms\": ";
+	writeStats(out, summarize(this->frameSamples));
+	out << ",\n";
+	out << "\t\t\"passes\": {";
+	for (size_t i = 0; i < this->passNames.size(); i++) {
+		const Pass& pass = this->passes[i];
+		out << (i == 0 ? "\n" : ",\n");
+		out << "\t\t\t\"" << this->passNames[i] << "\": {\n";
+		out << "\t\t\t\t\"cpu_ms\": ";
+		writeStats(out, summarize(pass.cpuSamples));
+		out << ",\n\t\t\t\t\"gpu_ms\": ";
+		writeStats(out, summarize(pass.gpuSamples));
+		out << "\n\t\t\t}";
+	}
+	out << "\n\t\t}\n";
+	out << "\t}";
+}
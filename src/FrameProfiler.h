@@ -0,0 +1,109 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <ostream>
+#include <glad/glad.h>
+#include "glHelper.h"
+
+// number of frames a GPU timer query is kept in flight before its result is read back
+#define PROFILER_QUERY_LATENCY 3
+
+///<summary>Summary of the samples recorded for a single pass, in milliseconds.</summary>
+struct PassStats {
+	double mean = 0.0;
+	double min = 0.0;
+	double max = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+};
+
+///<summary>Collects CPU and GPU timings for named render passes.
+///<para>CPU time is measured with a steady clock around each pass. GPU time is measured with GL_TIME_ELAPSED queries which are read back
+///PROFILER_QUERY_LATENCY frames later so the pipeline is never stalled. Passes must not be nested since only one GL_TIME_ELAPSED query can be active.</para>
+///</summary>
+class FrameProfiler {
+public:
+	FrameProfiler();
+	~FrameProfiler();
+
+	///<summary>Start a new frame. Resolves GPU queries issued PROFILER_QUERY_LATENCY frames ago.</summary>
+	void beginFrame();
+	///<summary>Finish the current frame and record its total CPU time.</summary>
+	void endFrame();
+
+	///<summary>Start timing the pass with the given name.</summary>
+	void beginPass(const std::string& name);
+	///<summary>Stop timing the pass that was started last.</summary>
+	void endPass();
+
+	///<summary>Block until every outstanding GPU query has been resolved.
+	///<para>Should be called once after the last frame before the results are read.</para>
+	///</summary>
+	void flush();
+
+	///<summary>Discard all samples that have been recorded so far (used to drop warmup frames).</summary>
+	void reset();
+
+	///<summary>Write the recorded statistics as a JSON object.</summary>
+	void writeJson(std::ostream& out) const;
+
+	const std::vector<std::string>& getPassNames() const { return this->passNames; }
+	PassStats getCpuStats(const std::string& name) const;
+	PassStats getGpuStats(const std::string& name) const;
+	PassStats getFrameStats() const { return summarize(this->frameSamples); }
+	unsigned int getFrameCount() const { return this->frameCount; }
+	bool getEnabled() const { return this->enabled; }
+
+	void setEnabled(bool enabled) { this->enabled = enabled; }
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct Pass {
+		std::vector<double> cpuSamples;
+		std::vector<double> gpuSamples;
+		// query objects of this pass that are not currently in flight
+		std::vector<GLuint> freeQueries;
+	};
+
+	struct PendingQuery {
+		size_t pass;
+		GLuint query;
+	};
+
+	std::vector<std::string> passNames;
+	std::unordered_map<std::string, size_t> passIndex;
+	std::vector<Pass> passes;
+	std::vector<PendingQuery> pending[PROFILER_QUERY_LATENCY];
+	std::vector<double> frameSamples;
+
+	unsigned int frameCount = 0;
+	unsigned int frameSlot = 0;
+	size_t activePass = SIZE_MAX;
+	Clock::time_point frameStart, passStart;
+	bool enabled = true;
+
+	void resolve(unsigned int slot);
+	static PassStats summarize(std::vector<double> samples);
+	static void writeStats(std::ostream& out, const PassStats& stats);
+};
+
+///<summary>Times the enclosing scope as a pass of the given profiler. Does nothing if the profiler is null.</summary>
+class ProfileScope {
+public:
+	ProfileScope(FrameProfiler* profiler, const char* name) : profiler(profiler) {
+		if (this->profiler)
+			this->profiler->beginPass(name);
+	}
+	~ProfileScope() {
+		if (this->profiler)
+			this->profiler->endPass();
+	}
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+private:
+	FrameProfiler* profiler;
+};
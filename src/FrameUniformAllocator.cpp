@@ -0,0 +1,65 @@
+#include "FrameUniformAllocator.h"
+#include <cstring>
+#include <iostream>
+#include "glHelper.h"
+
+FrameUniformAllocator& FrameUniformAllocator::get()
+{
+	static FrameUniformAllocator allocator;
+	return allocator;
+}
+
+void FrameUniformAllocator::initialize()
+{
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &this->alignment);
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &this->ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, this->ubo);
+	glBufferStorage(GL_UNIFORM_BUFFER, FRAME_UNIFORM_RING_FRAMES * FRAME_UNIFORM_FRAME_SIZE, NULL, flags);
+	this->mapping = (char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, FRAME_UNIFORM_RING_FRAMES * FRAME_UNIFORM_FRAME_SIZE, flags);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	checkGLError("FrameUniformAllocator::initialize");
+}
+
+void FrameUniformAllocator::beginFrame()
+{
+	if (this->ubo == 0)
+		this->initialize();
+
+	// every command reading the region of the last frame has been issued
+	if (this->fences[this->frame] == 0)
+		this->fences[this->frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	this->frame = (this->frame + 1) % FRAME_UNIFORM_RING_FRAMES;
+	this->frameOffset = 0;
+
+	GLsync fence = this->fences[this->frame];
+	if (fence != 0) {
+		GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+		if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED)
+			std::cerr << "ERROR::FRAME_UNIFORM_ALLOCATOR:: waiting for frame " << this->frame << " failed" << std::endl;
+		glDeleteSync(fence);
+		this->fences[this->frame] = 0;
+	}
+	checkGLError("FrameUniformAllocator::beginFrame");
+}
+
+bool FrameUniformAllocator::upload(GLuint bindingPoint, const void* data, GLsizeiptr size)
+{
+	if (this->ubo == 0)
+		this->initialize();
+	if (this->mapping == nullptr)
+		return false;
+
+	GLsizeiptr offset = (this->frameOffset + this->alignment - 1) / this->alignment * this->alignment;
+	if (offset + size > FRAME_UNIFORM_FRAME_SIZE) {
+		std::cerr << "ERROR::FRAME_UNIFORM_ALLOCATOR:: frame is out of uniform memory, " << size << " bytes requested" << std::endl;
+		return false;
+	}
+	this->frameOffset = offset + size;
+
+	GLintptr start = this->frame * FRAME_UNIFORM_FRAME_SIZE + offset;
+	std::memcpy(this->mapping + start, data, size);
+	glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, this->ubo, start, size);
+	checkGLError("FrameUniformAllocator::upload");
+	return true;
+}
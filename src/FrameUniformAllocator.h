@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// frames whose uniforms can be in flight at once
+#define FRAME_UNIFORM_RING_FRAMES 3
+// bytes of uniforms a single frame can allocate
+#define FRAME_UNIFORM_FRAME_SIZE (64 * 1024)
+
+///<summary>Process wide ring of uniform buffer memory for constants that change every frame.
+///<para>One buffer is persistently and coherently mapped and split into a region per frame. Uploads are copied straight into the region of the current frame
+///and bound with glBindBufferRange, so no glBufferSubData is issued and the driver never has to wait for a frame in flight to finish with a buffer.
+///beginFrame fences the region of the previous frame and waits for the region it moves to, which is only blocked if the GPU is more than FRAME_UNIFORM_RING_FRAMES frames behind.</para>
+///</summary>
+class FrameUniformAllocator {
+public:
+	static FrameUniformAllocator& get();
+
+	///<summary>Move to the region of the next frame. Call once per frame before any upload.</summary>
+	void beginFrame();
+	///<summary>Copy data into the current frame and bind it to a uniform block binding point.</summary>
+	///<returns>False if the frame ran out of room, in which case the binding is left as it was.</returns>
+	bool upload(GLuint bindingPoint, const void* data, GLsizeiptr size);
+
+	///<summary>Bytes allocated by the current frame, alignment included.</summary>
+	GLsizeiptr getFrameUsage() const { return this->frameOffset; }
+
+private:
+	FrameUniformAllocator() {}
+	FrameUniformAllocator(const FrameUniformAllocator&) = delete;
+	FrameUniformAllocator& operator=(const FrameUniformAllocator&) = delete;
+
+	GLuint ubo = 0;
+	char* mapping = nullptr;
+	GLint alignment = 0;
+	GLsync fences[FRAME_UNIFORM_RING_FRAMES] = {};
+	int frame = 0;
+	// next free byte of the region of the current frame
+	GLsizeiptr frameOffset = 0;
+
+	///<summary>Create and map the ring buffer.</summary>
+	void initialize();
+};
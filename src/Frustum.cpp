@@ -0,0 +1,95 @@
+#include "Frustum.h"
+
+#ifdef FRUSTUM_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+	// Gribb/Hartmann plane extraction. glm matrices are column major so row i is (m[0][i], m[1][i], m[2][i], m[3][i]).
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++) {
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+	this->planes[PLANE_LEFT] = rows[3] + rows[0];
+	this->planes[PLANE_RIGHT] = rows[3] - rows[0];
+	this->planes[PLANE_BOTTOM] = rows[3] + rows[1];
+	this->planes[PLANE_TOP] = rows[3] - rows[1];
+	this->planes[PLANE_NEAR] = rows[3] + rows[2];
+	this->planes[PLANE_FAR] = rows[3] - rows[2];
+
+	// normalize so the plane equation gives the signed distance
+	for (glm::vec4& plane : this->planes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+}
+
+bool Frustum::intersects(const BoundingSphere& sphere) const
+{
+	if (sphere.isEmpty())
+		return false;
+	for (const glm::vec4& plane : this->planes) {
+		if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+			return false;
+	}
+	return true;
+}
+
+bool Frustum::intersects(const AABB& box) const
+{
+	if (box.isEmpty())
+		return false;
+	glm::vec3 center = box.getCenter();
+	glm::vec3 extents = box.getExtents();
+	for (const glm::vec4& plane : this->planes) {
+		// the projected radius of the box onto the plane normal
+		float radius = extents.x * std::abs(plane.x) + extents.y * std::abs(plane.y) + extents.z * std::abs(plane.z);
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+	}
+	return true;
+}
+
+void Frustum::intersects(const glm::vec4* spheres, size_t count, uint8_t* visible) const
+{
+	size_t i = 0;
+#ifdef FRUSTUM_USE_SSE
+	__m128 planeX[PLANE_COUNT], planeY[PLANE_COUNT], planeZ[PLANE_COUNT], planeW[PLANE_COUNT];
+	for (int p = 0; p < PLANE_COUNT; p++) {
+		planeX[p] = _mm_set1_ps(this->planes[p].x);
+		planeY[p] = _mm_set1_ps(this->planes[p].y);
+		planeZ[p] = _mm_set1_ps(this->planes[p].z);
+		planeW[p] = _mm_set1_ps(this->planes[p].w);
+	}
+	const __m128 zero = _mm_setzero_ps();
+
+	for (; i + 4 <= count; i += 4) {
+		// load four spheres and transpose them so each register holds one component of all four
+		__m128 x = _mm_loadu_ps(&spheres[i + 0].x);
+		__m128 y = _mm_loadu_ps(&spheres[i + 1].x);
+		__m128 z = _mm_loadu_ps(&spheres[i + 2].x);
+		__m128 r = _mm_loadu_ps(&spheres[i + 3].x);
+		_MM_TRANSPOSE4_PS(x, y, z, r);
+		__m128 negRadius = _mm_sub_ps(zero, r);
+
+		__m128 outside = _mm_cmplt_ps(r, zero);
+		for (int p = 0; p < PLANE_COUNT; p++) {
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p])
+			);
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negRadius));
+		}
+
+		int mask = _mm_movemask_ps(outside);
+		visible[i + 0] = (mask & 1) == 0;
+		visible[i + 1] = (mask & 2) == 0;
+		visible[i + 2] = (mask & 4) == 0;
+		visible[i + 3] = (mask & 8) == 0;
+	}
+#endif
+	// remaining spheres, or all of them without SSE
+	for (; i < count; i++) {
+		visible[i] = this->intersects(BoundingSphere(glm::vec3(spheres[i]), spheres[i].w));
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Bounds.h"
+
+// use 4 wide SSE for the batched sphere tests when the target supports it
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_USE_SSE
+#endif
+
+///<summary>The six planes of a view frustum, extracted from a view projection matrix.</summary>
+class Frustum {
+public:
+	enum Plane { PLANE_LEFT = 0, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR, PLANE_COUNT };
+
+	Frustum() {}
+	///<summary>Extract the planes from a view projection matrix. The plane normals point into the frustum.</summary>
+	explicit Frustum(const glm::mat4& viewProjection);
+
+	///<summary>Returns false if the sphere is fully outside of the frustum.</summary>
+	bool intersects(const BoundingSphere& sphere) const;
+	///<summary>Returns false if the box is fully outside of the frustum.</summary>
+	bool intersects(const AABB& box) const;
+	///<summary>Returns false if the bounds are fully outside of the frustum. Tests the sphere first and then the tighter box.</summary>
+	bool intersects(const Bounds& bounds) const { return this->intersects(bounds.sphere) && this->intersects(bounds.box); }
+
+	///<summary>Test many spheres at once, four at a time when SSE is available.</summary>
+	///<param name="spheres">Spheres packed as (center.x, center.y, center.z, radius).</param>
+	///<param name="count">Number of spheres.</param>
+	///<param name="visible">Receives 1 for every sphere that intersects the frustum and 0 otherwise. Must hold count entries.</param>
+	void intersects(const glm::vec4* spheres, size_t count, uint8_t* visible) const;
+
+	const glm::vec4& getPlane(Plane plane) const { return this->planes[plane]; }
+
+private:
+	glm::vec4 planes[PLANE_COUNT];
+};
+
+///<summary>Counters for the culling done in a single frame.</summary>
+struct CullingStats {
+	unsigned int modelsVisible = 0;
+	unsigned int modelsCulled = 0;
+	unsigned int meshesVisible = 0;
+	unsigned int meshesCulled = 0;
+	///<summary>Models and meshes inside the frustum that the Hi-Z test found hidden. Not counted as visible.</summary>
+	unsigned int modelsOccluded = 0;
+	unsigned int meshesOccluded = 0;
+	///<summary>Models drawn into and culled from shadow maps, counted once per shadow map.</summary>
+	unsigned int shadowCastersVisible = 0;
+	unsigned int shadowCastersCulled = 0;
+	///<summary>Cube map faces models were routed to and skipped, counted once per model per shadow cube map.</summary>
+	unsigned int shadowFacesRendered = 0;
+	unsigned int shadowFacesCulled = 0;
+	///<summary>Instanced models, each tested as a whole.</summary>
+	unsigned int instancedModelsVisible = 0;
+	unsigned int instancedModelsCulled = 0;
+	///<summary>Visible meshes the camera draws at a simplified level of detail, and meshes the shadow maps draw at one.</summary>
+	unsigned int meshesReducedLod = 0;
+	unsigned int shadowMeshesReducedLod = 0;
+
+	void reset() { *this = CullingStats(); }
+};
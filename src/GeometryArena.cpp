@@ -0,0 +1,364 @@
+#include "GeometryArena.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+#include "glHelper.h"
+#include "vertexData.h"
+#include "MeshletBuilder.h"
+
+static void vertexDataFormat()
+{
+	glEnableVertexAttribArray(0); // vertex positions
+	glEnableVertexAttribArray(1); // vertex normals
+	glEnableVertexAttribArray(2); // vertex UVs (texture coords)
+	glEnableVertexAttribArray(3); // vertex tangent
+	glEnableVertexAttribArray(4); // vertex biTangent
+	glVertexAttribFormat(0, 3, GL_FLOAT, GL_FALSE, offsetof(VertexData, Position));
+	glVertexAttribFormat(1, 3, GL_FLOAT, GL_FALSE, offsetof(VertexData, Normal));
+	glVertexAttribFormat(2, 2, GL_FLOAT, GL_FALSE, offsetof(VertexData, uv));
+	glVertexAttribFormat(3, 3, GL_FLOAT, GL_FALSE, offsetof(VertexData, Tangent));
+	glVertexAttribFormat(4, 3, GL_FLOAT, GL_FALSE, offsetof(VertexData, Bitangent));
+	for (GLuint attribute = 0; attribute < 5; attribute++) {
+		glVertexAttribBinding(attribute, 0);
+	}
+}
+
+static void packedVertexDataFormat()
+{
+	glEnableVertexAttribArray(0); // vertex positions
+	glEnableVertexAttribArray(1); // vertex normals
+	glEnableVertexAttribArray(2); // vertex UVs (texture coords)
+	glEnableVertexAttribArray(3); // vertex tangent, w is the bitangent sign
+	// no bitangent, the attribute reads as zero and shaders rebuild it from the tangent
+	glDisableVertexAttribArray(4);
+	glVertexAttribFormat(0, 3, GL_SHORT, GL_TRUE, offsetof(PackedVertexData, Position));
+	glVertexAttribFormat(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(PackedVertexData, Normal));
+	glVertexAttribFormat(2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedVertexData, uv));
+	glVertexAttribFormat(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, offsetof(PackedVertexData, Tangent));
+	for (GLuint attribute = 0; attribute < 4; attribute++) {
+		glVertexAttribBinding(attribute, 0);
+	}
+}
+
+// positions are the first member of both formats, the position streams copy them from there
+static void vertexDataPositionFormat()
+{
+	glEnableVertexAttribArray(0); // vertex positions
+	glVertexAttribFormat(0, 3, GL_FLOAT, GL_FALSE, 0);
+	glVertexAttribBinding(0, 0);
+}
+
+static void packedVertexDataPositionFormat()
+{
+	glEnableVertexAttribArray(0); // vertex positions
+	glVertexAttribFormat(0, 3, GL_SHORT, GL_TRUE, 0);
+	glVertexAttribBinding(0, 0);
+}
+
+static PackedVertexData packVertex(const VertexData& vertex, const glm::vec3& offset, const glm::vec3& inverseScale)
+{
+	PackedVertexData packed;
+	glm::vec3 position = glm::clamp((vertex.Position - offset) * inverseScale, glm::vec3(-1.0f), glm::vec3(1.0f));
+	for (int i = 0; i < 3; i++)
+		packed.Position[i] = (GLshort)std::lround(position[i] * 32767.0f);
+	packed.Position[3] = 0;
+
+	packed.Normal = glm::packSnorm3x10_1x2(glm::vec4(vertex.Normal, 0.0f));
+	// a mesh without tangents packs them as zero, and the bitangent rebuilt from them stays zero as well
+	float handedness = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f ? -1.0f : 1.0f;
+	packed.Tangent = glm::packSnorm3x10_1x2(glm::vec4(vertex.Tangent, handedness));
+
+	GLuint uv = glm::packHalf2x16(vertex.uv);
+	packed.uv[0] = (GLushort)(uv & 0xFFFF);
+	packed.uv[1] = (GLushort)(uv >> 16);
+	return packed;
+}
+
+bool GeometryArena::packedVertices = false;
+bool GeometryArena::positionStreams = true;
+
+GeometryArena& GeometryArena::get()
+{
+	static GeometryArena arena(sizeof(VertexData), vertexDataFormat, sizeof(glm::vec3), vertexDataPositionFormat);
+	static GeometryArena packedArena(sizeof(PackedVertexData), packedVertexDataFormat, sizeof(PackedVertexData::Position), packedVertexDataPositionFormat, true);
+	return GeometryArena::packedVertices ? packedArena : arena;
+}
+
+glm::mat4 GeometryRange::decodeModel(const glm::mat4& model) const
+{
+	if (!this->isQuantized())
+		return model;
+	return glm::scale(glm::translate(model, this->positionOffset), this->positionScale);
+}
+
+GeometryArena::GeometryArena(GLsizei vertexStride, FormatFunction format, GLsizei positionStride, FormatFunction positionFormat, bool packed) :
+	vertexStride(vertexStride),
+	format(format),
+	positionStride(positionStride),
+	positionFormat(positionFormat),
+	packed(packed)
+{
+}
+
+void GeometryArena::initialize()
+{
+	glGenVertexArrays(1, &this->vertexArray);
+	if (this->positionFormat != nullptr && GeometryArena::positionStreams)
+		glGenVertexArrays(1, &this->depthVertexArray);
+	this->grow(this->vertices, GEOMETRY_ARENA_INITIAL_VERTICES);
+	this->grow(this->indices, GEOMETRY_ARENA_INITIAL_INDICES);
+	checkGLError("GeometryArena::initialize");
+}
+
+GeometryRange GeometryArena::allocate(const void* vertices, size_t vertexCount, const GLuint* indices, size_t indexCount)
+{
+	GeometryRange range;
+	if (vertexCount == 0 || indexCount == 0)
+		return range;
+	if (this->vertexArray == 0)
+		this->initialize();
+
+	size_t vertexOffset = this->vertices.allocate(vertexCount);
+	if (vertexOffset == SIZE_MAX) {
+		this->grow(this->vertices, this->vertices.capacity + vertexCount);
+		vertexOffset = this->vertices.allocate(vertexCount);
+	}
+	size_t indexOffset = this->indices.allocate(indexCount);
+	if (indexOffset == SIZE_MAX) {
+		this->grow(this->indices, this->indices.capacity + indexCount);
+		indexOffset = this->indices.allocate(indexCount);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, this->vertexBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, vertexOffset * this->vertexStride, vertexCount * this->vertexStride, vertices);
+	if (this->positionBuffer != 0) {
+		std::vector<uint8_t> positions(vertexCount * this->positionStride);
+		for (size_t i = 0; i < vertexCount; i++)
+			std::memcpy(&positions[i * this->positionStride], (const uint8_t*)vertices + i * this->vertexStride, this->positionStride);
+		glBindBuffer(GL_ARRAY_BUFFER, this->positionBuffer);
+		glBufferSubData(GL_ARRAY_BUFFER, vertexOffset * this->positionStride, positions.size(), positions.data());
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	// the element buffer binding is vertex array state, go through the copy target so no vertex array is changed
+	glBindBuffer(GL_COPY_WRITE_BUFFER, this->indexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, indexOffset * sizeof(GLuint), indexCount * sizeof(GLuint), indices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	checkGLError("GeometryArena::allocate");
+
+	range.baseVertex = (GLint)vertexOffset;
+	range.firstIndex = (GLuint)indexOffset;
+	range.vertexCount = (GLsizei)vertexCount;
+	range.indexCount = (GLsizei)indexCount;
+	return range;
+}
+
+GeometryRange GeometryArena::allocateMesh(const VertexData* vertices, size_t vertexCount, const GLuint* indices, size_t indexCount)
+{
+	if (!this->packed)
+		return this->allocate(vertices, vertexCount, indices, indexCount);
+
+	// quantize against the bounds of the mesh, a flat axis keeps a scale of one so nothing divides by zero
+	glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+	for (size_t i = 0; i < vertexCount; i++) {
+		min = glm::min(min, vertices[i].Position);
+		max = glm::max(max, vertices[i].Position);
+	}
+	glm::vec3 offset = vertexCount > 0 ? (min + max) * 0.5f : glm::vec3(0.0f);
+	glm::vec3 scale = vertexCount > 0 ? (max - min) * 0.5f : glm::vec3(1.0f);
+	for (int i = 0; i < 3; i++) {
+		if (scale[i] <= 0.0f)
+			scale[i] = 1.0f;
+	}
+
+	std::vector<PackedVertexData> packedVertices(vertexCount);
+	glm::vec3 inverseScale = 1.0f / scale;
+	for (size_t i = 0; i < vertexCount; i++)
+		packedVertices[i] = packVertex(vertices[i], offset, inverseScale);
+
+	GeometryRange range = this->allocate(packedVertices.data(), vertexCount, indices, indexCount);
+	range.positionScale = scale;
+	range.positionOffset = offset;
+	return range;
+}
+
+GeometryRange GeometryArena::allocateIndices(const GeometryRange& base, const GLuint* indices, size_t indexCount)
+{
+	GeometryRange range = base;
+	range.firstIndex = 0;
+	range.indexCount = 0;
+	range.firstMeshlet = 0;
+	range.meshletCount = 0;
+	if (base.isEmpty() || indexCount == 0)
+		return range;
+
+	size_t indexOffset = this->indices.allocate(indexCount);
+	if (indexOffset == SIZE_MAX) {
+		this->grow(this->indices, this->indices.capacity + indexCount);
+		indexOffset = this->indices.allocate(indexCount);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, this->indexBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, indexOffset * sizeof(GLuint), indexCount * sizeof(GLuint), indices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	checkGLError("GeometryArena::allocateIndices");
+
+	range.firstIndex = (GLuint)indexOffset;
+	range.indexCount = (GLsizei)indexCount;
+	return range;
+}
+
+void GeometryArena::freeIndices(const GeometryRange& range)
+{
+	if (range.isEmpty())
+		return;
+	this->indices.release(range.firstIndex, range.indexCount);
+}
+
+void GeometryArena::free(const GeometryRange& range)
+{
+	if (range.isEmpty())
+		return;
+	this->vertices.release(range.baseVertex, range.vertexCount);
+	this->indices.release(range.firstIndex, range.indexCount);
+	if (range.hasMeshlets())
+		this->meshlets.release(range.firstMeshlet, range.meshletCount);
+}
+
+void GeometryArena::allocateMeshlets(GeometryRange& range, const Meshlet* meshlets, size_t meshletCount)
+{
+	if (range.isEmpty() || range.hasMeshlets() || meshletCount == 0)
+		return;
+	size_t meshletOffset = this->meshlets.allocate(meshletCount);
+	if (meshletOffset == SIZE_MAX) {
+		this->grow(this->meshlets, std::max(this->meshlets.capacity + meshletCount, (size_t)GEOMETRY_ARENA_INITIAL_MESHLETS));
+		meshletOffset = this->meshlets.allocate(meshletCount);
+	}
+
+	// the culling shader writes the index ranges straight into draw commands
+	std::vector<Meshlet> arenaMeshlets(meshlets, meshlets + meshletCount);
+	for (Meshlet& meshlet : arenaMeshlets)
+		meshlet.firstIndex += range.firstIndex;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, this->meshletBuffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, meshletOffset * sizeof(Meshlet), meshletCount * sizeof(Meshlet), arenaMeshlets.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	checkGLError("GeometryArena::allocateMeshlets");
+
+	range.firstMeshlet = (GLuint)meshletOffset;
+	range.meshletCount = (GLsizei)meshletCount;
+}
+
+void GeometryArena::setupVertexArray(GLuint vertexArray) const
+{
+	glBindVertexArray(vertexArray);
+	this->format();
+	glBindVertexBuffer(0, this->vertexBuffer, 0, this->vertexStride);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->indexBuffer);
+	glBindVertexArray(0);
+	checkGLError("GeometryArena::setupVertexArray");
+}
+
+void GeometryArena::setupDepthVertexArray() const
+{
+	glBindVertexArray(this->depthVertexArray);
+	this->positionFormat();
+	glBindVertexBuffer(0, this->positionBuffer, 0, this->positionStride);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->indexBuffer);
+	glBindVertexArray(0);
+	checkGLError("GeometryArena::setupDepthVertexArray");
+}
+
+void GeometryArena::grow(FreeList& list, size_t minimumCapacity)
+{
+	size_t capacity = std::max(list.capacity, (size_t)1);
+	// the new slots are appended to the free range at the end, old capacity + count always fits regardless of fragmentation
+	while (capacity < minimumCapacity)
+		capacity *= 2;
+
+	if (&list == &this->vertices) {
+		GeometryArena::reallocate(this->vertexBuffer, list.capacity * this->vertexStride, capacity * this->vertexStride);
+		if (this->depthVertexArray != 0)
+			GeometryArena::reallocate(this->positionBuffer, list.capacity * this->positionStride, capacity * this->positionStride);
+	}
+	else if (&list == &this->indices) {
+		GeometryArena::reallocate(this->indexBuffer, list.capacity * sizeof(GLuint), capacity * sizeof(GLuint));
+	}
+	else {
+		// meshlets are only read by compute shaders, no vertex array refers to them
+		GeometryArena::reallocate(this->meshletBuffer, list.capacity * sizeof(Meshlet), capacity * sizeof(Meshlet));
+		list.grow(capacity);
+		checkGLError("GeometryArena::grow");
+		return;
+	}
+	list.grow(capacity);
+
+	this->setupVertexArray(this->vertexArray);
+	if (this->depthVertexArray != 0)
+		this->setupDepthVertexArray();
+	this->generation++;
+	checkGLError("GeometryArena::grow");
+}
+
+void GeometryArena::reallocate(GLuint& buffer, size_t oldSize, size_t newSize)
+{
+	GLuint newBuffer;
+	glGenBuffers(1, &newBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, newSize, NULL, GL_STATIC_DRAW);
+	if (buffer != 0) {
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glDeleteBuffers(1, &buffer);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	buffer = newBuffer;
+}
+
+size_t GeometryArena::FreeList::allocate(size_t count)
+{
+	for (size_t i = 0; i < this->ranges.size(); i++) {
+		std::pair<size_t, size_t>& range = this->ranges[i];
+		if (range.second < count)
+			continue;
+		size_t offset = range.first;
+		range.first += count;
+		range.second -= count;
+		if (range.second == 0)
+			this->ranges.erase(this->ranges.begin() + i);
+		this->used += count;
+		return offset;
+	}
+	return SIZE_MAX;
+}
+
+void GeometryArena::FreeList::release(size_t offset, size_t count)
+{
+	this->used -= count;
+	auto next = std::lower_bound(this->ranges.begin(), this->ranges.end(), std::make_pair(offset, (size_t)0));
+	// merge with the free range after and the free range before
+	if (next != this->ranges.end() && offset + count == next->first) {
+		next->first = offset;
+		next->second += count;
+	}
+	else {
+		next = this->ranges.insert(next, std::make_pair(offset, count));
+	}
+	if (next != this->ranges.begin()) {
+		auto previous = next - 1;
+		if (previous->first + previous->second == next->first) {
+			previous->second += next->second;
+			this->ranges.erase(next);
+		}
+	}
+}
+
+void GeometryArena::FreeList::grow(size_t newCapacity)
+{
+	size_t oldCapacity = this->capacity;
+	this->capacity = newCapacity;
+	this->used += newCapacity - oldCapacity;
+	this->release(oldCapacity, newCapacity - oldCapacity);
+}
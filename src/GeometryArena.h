@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+struct VertexData;
+struct Meshlet;
+
+// vertex and index slots the buffers of an arena start with, they double when they run out
+#define GEOMETRY_ARENA_INITIAL_VERTICES (1 << 16)
+#define GEOMETRY_ARENA_INITIAL_INDICES (1 << 18)
+#define GEOMETRY_ARENA_INITIAL_MESHLETS (1 << 12)
+
+///<summary>Location of a mesh inside a GeometryArena, in the units the draw calls take.</summary>
+struct GeometryRange {
+	///<summary>First vertex of the mesh, added to every index when drawing.</summary>
+	GLint baseVertex = 0;
+	GLuint firstIndex = 0;
+	GLsizei vertexCount = 0;
+	GLsizei indexCount = 0;
+	///<summary>Maps the stored positions back to object space, position = stored * scale + offset. Identity unless the arena quantizes positions.</summary>
+	glm::vec3 positionScale = glm::vec3(1.0f);
+	glm::vec3 positionOffset = glm::vec3(0.0f);
+	///<summary>The meshlets of the mesh in the meshlet buffer of the arena. Only the full mesh has them, levels of detail are culled as a whole.</summary>
+	GLuint firstMeshlet = 0;
+	GLsizei meshletCount = 0;
+
+	bool isEmpty() const { return this->indexCount == 0; }
+	bool hasMeshlets() const { return this->meshletCount > 0; }
+	bool isQuantized() const { return this->positionScale != glm::vec3(1.0f) || this->positionOffset != glm::vec3(0.0f); }
+	///<summary>The model matrix with the position decode folded in, so shaders that read positions as they are stored need no decode of their own.</summary>
+	glm::mat4 decodeModel(const glm::mat4& model) const;
+	///<summary>Byte offset of the first index, as glDrawElements takes it.</summary>
+	const void* getIndexOffset() const { return (const void*)(this->firstIndex * sizeof(GLuint)); }
+};
+
+///<summary>Shared vertex and index buffers that the static meshes of one vertex format are suballocated from.
+///<para>All meshes of the arena are drawn through its single vertex array with glDrawElementsBaseVertex, so switching meshes needs no vertex array bind and many meshes can be drawn by one glMultiDrawElementsIndirect.
+///The buffers grow by copying into larger ones, after which the generation changes and vertex arrays made with setupVertexArray must be set up again.</para>
+///<para>Formats with a position format also keep a copy of just the positions in a buffer of their own, read by the depth vertex array, so depth and shadow passes do not fetch the rest of the vertex.
+///The stream holds the first position stride bytes of every vertex, the formats keep their position there.</para>
+///</summary>
+class GeometryArena {
+public:
+	///<summary>Function that declares the vertex attributes of the format on the bound vertex array, reading from vertex buffer binding 0.</summary>
+	typedef void (*FormatFunction)();
+
+	///<summary>Get the arena meshes are stored in, holding VertexData or PackedVertexData if packed vertices are enabled.</summary>
+	static GeometryArena& get();
+	///<summary>Store meshes as PackedVertexData. Must be set before the first mesh is loaded, meshes stay in the arena they were allocated from.</summary>
+	static void setPackedVertices(bool packed) { GeometryArena::packedVertices = packed; }
+	static bool isPackedVertices() { return GeometryArena::packedVertices; }
+	///<summary>Keep the position streams. Must be set before the first mesh is loaded.</summary>
+	static void setPositionStreams(bool enabled) { GeometryArena::positionStreams = enabled; }
+
+	///<param name="positionStride">Size of the position at the start of every vertex, copied into the position stream.</param>
+	///<param name="positionFormat">Declares attribute 0 for the position stream, nullptr for no stream.</param>
+	GeometryArena(GLsizei vertexStride, FormatFunction format, GLsizei positionStride = 0, FormatFunction positionFormat = nullptr, bool packed = false);
+
+	///<summary>Copy a mesh of VertexData into the arena, packing it first if the arena holds PackedVertexData. Must be called on the thread that owns the OpenGL context.</summary>
+	GeometryRange allocateMesh(const VertexData* vertices, size_t vertexCount, const GLuint* indices, size_t indexCount);
+	///<summary>Copy a mesh into the arena. Must be called on the thread that owns the OpenGL context.</summary>
+	GeometryRange allocate(const void* vertices, size_t vertexCount, const GLuint* indices, size_t indexCount);
+	///<summary>Copy another index list for the vertices of an allocated range, such as a level of detail. The returned range shares the vertices and position decode of the base.</summary>
+	GeometryRange allocateIndices(const GeometryRange& base, const GLuint* indices, size_t indexCount);
+	///<summary>Return the space of a mesh to the arena. The range must not be drawn afterwards.</summary>
+	void free(const GeometryRange& range);
+	///<summary>Return only the indices of a range made by allocateIndices, the vertices stay with the base range.</summary>
+	void freeIndices(const GeometryRange& range);
+	///<summary>Copy the meshlets of an allocated range into the meshlet buffer, turning their first index into an index of the arena. They are returned by free.</summary>
+	void allocateMeshlets(GeometryRange& range, const Meshlet* meshlets, size_t meshletCount);
+
+	///<summary>Point another vertex array at the arena buffers, for example one that adds per instance attributes.</summary>
+	void setupVertexArray(GLuint vertexArray) const;
+
+	GLuint getVertexArray() const { return this->vertexArray; }
+	///<summary>Vertex array with only the positions, for passes that read nothing else. The full vertex array if the arena has no position stream.</summary>
+	GLuint getDepthVertexArray() const { return this->depthVertexArray != 0 ? this->depthVertexArray : this->vertexArray; }
+	bool hasPositionStream() const { return this->depthVertexArray != 0; }
+	GLuint getVertexBuffer() const { return this->vertexBuffer; }
+	GLuint getIndexBuffer() const { return this->indexBuffer; }
+	///<summary>Shader storage buffer holding the Meshlet records of every mesh, 0 until the first meshlets are allocated.</summary>
+	GLuint getMeshletBuffer() const { return this->meshletBuffer; }
+	GLsizei getVertexStride() const { return this->vertexStride; }
+	GLsizei getPositionStride() const { return this->hasPositionStream() ? this->positionStride : 0; }
+	bool isPacked() const { return this->packed; }
+	///<summary>Incremented every time the buffers are reallocated.</summary>
+	unsigned int getGeneration() const { return this->generation; }
+	size_t getVertexCapacity() const { return this->vertices.capacity; }
+	size_t getIndexCapacity() const { return this->indices.capacity; }
+	size_t getVerticesUsed() const { return this->vertices.used; }
+	size_t getIndicesUsed() const { return this->indices.used; }
+	size_t getMeshletsUsed() const { return this->meshlets.used; }
+
+private:
+	GeometryArena(const GeometryArena&) = delete;
+	GeometryArena& operator=(const GeometryArena&) = delete;
+
+	///<summary>First fit allocator over the slots of one buffer, merging neighbouring free ranges.</summary>
+	struct FreeList {
+		///<summary>first: offset, second: count. Sorted by offset.</summary>
+		std::vector<std::pair<size_t, size_t>> ranges;
+		size_t capacity = 0;
+		size_t used = 0;
+
+		///<summary>Returns the offset of the allocation or SIZE_MAX if no free range is large enough.</summary>
+		size_t allocate(size_t count);
+		void release(size_t offset, size_t count);
+		///<summary>Add the slots between the old and the new capacity.</summary>
+		void grow(size_t newCapacity);
+	};
+
+	static bool packedVertices;
+	static bool positionStreams;
+
+	GLsizei vertexStride;
+	FormatFunction format;
+	GLsizei positionStride;
+	FormatFunction positionFormat;
+	bool packed;
+	GLuint vertexArray = 0;
+	GLuint vertexBuffer = 0;
+	GLuint indexBuffer = 0;
+	GLuint depthVertexArray = 0;
+	GLuint positionBuffer = 0;
+	GLuint meshletBuffer = 0;
+	FreeList vertices;
+	FreeList indices;
+	FreeList meshlets;
+	unsigned int generation = 0;
+
+	///<summary>Create the buffers and the vertex array the first time something is allocated.</summary>
+	void initialize();
+	///<summary>Reallocate the buffers of a list with room for at least the given number of elements and copy the old contents over.</summary>
+	void grow(FreeList& list, size_t minimumCapacity);
+	///<summary>Replace a buffer by a larger one holding the same contents.</summary>
+	static void reallocate(GLuint& buffer, size_t oldSize, size_t newSize);
+	///<summary>Point the depth vertex array at the position stream.</summary>
+	void setupDepthVertexArray() const;
+};
@@ -0,0 +1,206 @@
+#include "HiZBuffer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "glHelper.h"
+#include "shader.h"
+
+void HiZBuffer::allocate(int width, int height)
+{
+	this->invalidate();
+	if (this->texture != 0)
+		glDeleteTextures(1, &this->texture);
+
+	this->width = width;
+	this->height = height;
+	this->levels = 1;
+	while ((std::max(width, height) >> this->levels) > 0)
+		this->levels++;
+
+	glGenTextures(1, &this->texture);
+	glBindTexture(GL_TEXTURE_2D, this->texture);
+	glTexStorage2D(GL_TEXTURE_2D, this->levels, GL_R32F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	this->readBackLevel = 0;
+	while (this->readBackLevel < this->levels - 1 && std::max(width >> this->readBackLevel, height >> this->readBackLevel) > HIZ_READBACK_MAX_SIZE)
+		this->readBackLevel++;
+	checkGLError("HiZBuffer::allocate");
+}
+
+void HiZBuffer::invalidate()
+{
+	for (int i = 0; i < 2; i++) {
+		if (this->readBackFences[i] != 0) {
+			glDeleteSync(this->readBackFences[i]);
+			this->readBackFences[i] = 0;
+		}
+	}
+	this->cpuValid = false;
+	this->built = false;
+}
+
+void HiZBuffer::bindForCulling(const Shader& cullShader, const HiZBuffer* hiZ)
+{
+	static const Uniform occlusionCullingUniform("occlusionCulling");
+	static const Uniform hiZUniform("hiZ");
+	static const Uniform hiZViewProjectionUniform("hiZViewProjection");
+	static const Uniform hiZSizeUniform("hiZSize");
+	static const Uniform hiZLevelsUniform("hiZLevels");
+	bool occlusionCulling = hiZ != nullptr && hiZ->isValid();
+	cullShader.setBool(occlusionCullingUniform, occlusionCulling);
+	if (!occlusionCulling)
+		return;
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, hiZ->getTexture());
+	cullShader.setInt(hiZUniform, 0);
+	cullShader.setMat4(hiZViewProjectionUniform, hiZ->getViewProjection());
+	cullShader.setVec2(hiZSizeUniform, glm::vec2(hiZ->getWidth(), hiZ->getHeight()));
+	cullShader.setInt(hiZLevelsUniform, hiZ->getLevelCount());
+}
+
+void HiZBuffer::build(const Shader& buildShader, GLuint depthTexture, int width, int height, const glm::mat4& viewProjection)
+{
+	static const Uniform sourceUniform("source");
+	static const Uniform sourceLevelUniform("sourceLevel");
+	static const Uniform sourceSizeUniform("sourceSize");
+
+	if (width != this->width || height != this->height || this->texture == 0)
+		this->allocate(width, height);
+	this->viewProjection = viewProjection;
+	this->built = true;
+
+	buildShader.Use();
+	buildShader.setInt(sourceUniform, 0);
+	glActiveTexture(GL_TEXTURE0);
+	for (int level = 0; level < this->levels; level++) {
+		int levelWidth = std::max(width >> level, 1);
+		int levelHeight = std::max(height >> level, 1);
+		// level 0 copies the depth, every other level reduces the one above it
+		if (level == 0) {
+			glBindTexture(GL_TEXTURE_2D, depthTexture);
+			buildShader.setInt(sourceLevelUniform, -1);
+			buildShader.setVec2(sourceSizeUniform, glm::vec2(width, height));
+		}
+		else {
+			glBindTexture(GL_TEXTURE_2D, this->texture);
+			buildShader.setInt(sourceLevelUniform, level - 1);
+			buildShader.setVec2(sourceSizeUniform, glm::vec2(std::max(width >> (level - 1), 1), std::max(height >> (level - 1), 1)));
+		}
+		glBindImageTexture(0, this->texture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glDispatchCompute((levelWidth + HIZ_BUILD_GROUP_SIZE - 1) / HIZ_BUILD_GROUP_SIZE, (levelHeight + HIZ_BUILD_GROUP_SIZE - 1) / HIZ_BUILD_GROUP_SIZE, 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	checkGLError("HiZBuffer::build");
+}
+
+void HiZBuffer::readBack()
+{
+	if (this->texture == 0)
+		return;
+	int slot = this->readBackIndex;
+	if (this->readBackFences[slot] != 0)
+		return;
+
+	int levelWidth = std::max(this->width >> this->readBackLevel, 1);
+	int levelHeight = std::max(this->height >> this->readBackLevel, 1);
+	if (this->readBackBuffers[slot] == 0) {
+		glGenBuffers(1, &this->readBackBuffers[slot]);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, this->readBackBuffers[slot]);
+	glBufferData(GL_PIXEL_PACK_BUFFER, levelWidth * levelHeight * sizeof(float), NULL, GL_STREAM_READ);
+	// the pyramid was written with image stores, the texture read back has to see them
+	glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+	glBindTexture(GL_TEXTURE_2D, this->texture);
+	glGetTexImage(GL_TEXTURE_2D, this->readBackLevel, GL_RED, GL_FLOAT, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	this->readBackFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	this->readBackViewProjections[slot] = this->viewProjection;
+	this->readBackIndex = (slot + 1) % 2;
+	checkGLError("HiZBuffer::readBack");
+}
+
+void HiZBuffer::fetchReadBack()
+{
+	int levelWidth = std::max(this->width >> this->readBackLevel, 1);
+	int levelHeight = std::max(this->height >> this->readBackLevel, 1);
+	// the slot about to be written holds the older copy, check it first so the newer one wins
+	for (int i = 0; i < 2; i++) {
+		int slot = (this->readBackIndex + i) % 2;
+		GLsync fence = this->readBackFences[slot];
+		if (fence == 0)
+			continue;
+		GLenum status = glClientWaitSync(fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			continue;
+		glDeleteSync(fence);
+		this->readBackFences[slot] = 0;
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, this->readBackBuffers[slot]);
+		const float* depth = (const float*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, levelWidth * levelHeight * sizeof(float), GL_MAP_READ_BIT);
+		if (depth != nullptr) {
+			this->cpuDepth.resize(levelWidth * levelHeight);
+			std::memcpy(this->cpuDepth.data(), depth, this->cpuDepth.size() * sizeof(float));
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			this->cpuWidth = levelWidth;
+			this->cpuHeight = levelHeight;
+			this->cpuViewProjection = this->readBackViewProjections[slot];
+			this->cpuValid = true;
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+	checkGLError("HiZBuffer::fetchReadBack");
+}
+
+bool HiZBuffer::isOccluded(const AABB& box) const
+{
+	if (!this->cpuValid || box.isEmpty())
+		return false;
+
+	// screen rectangle and nearest depth of the box as seen when the pyramid was built
+	glm::vec2 minUV(1.0f), maxUV(0.0f);
+	float nearest = 1.0f;
+	for (int corner = 0; corner < 8; corner++) {
+		glm::vec3 point(
+			(corner & 1) ? box.max.x : box.min.x,
+			(corner & 2) ? box.max.y : box.min.y,
+			(corner & 4) ? box.max.z : box.min.z
+		);
+		glm::vec4 clip = this->cpuViewProjection * glm::vec4(point, 1.0f);
+		if (clip.w <= 0.0f)
+			return false;
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		glm::vec2 uv = glm::vec2(ndc.x, ndc.y) * 0.5f + 0.5f;
+		minUV = glm::min(minUV, uv);
+		maxUV = glm::max(maxUV, uv);
+		nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+	}
+	if (maxUV.x < 0.0f || maxUV.y < 0.0f || minUV.x > 1.0f || minUV.y > 1.0f)
+		return false;
+
+	// map through the full resolution so the folded odd rows and columns are found
+	int shift = 0;
+	while ((std::max(this->width, this->height) >> shift) > std::max(this->cpuWidth, this->cpuHeight))
+		shift++;
+	int minX = std::min(std::max((int)(minUV.x * this->width), 0) >> shift, this->cpuWidth - 1);
+	int minY = std::min(std::max((int)(minUV.y * this->height), 0) >> shift, this->cpuHeight - 1);
+	int maxX = std::min(std::max((int)(maxUV.x * this->width), 0) >> shift, this->cpuWidth - 1);
+	int maxY = std::min(std::max((int)(maxUV.y * this->height), 0) >> shift, this->cpuHeight - 1);
+	if ((maxX - minX + 1) * (maxY - minY + 1) > HIZ_MAX_TEST_TEXELS)
+		return false;
+
+	for (int y = minY; y <= maxY; y++) {
+		for (int x = minX; x <= maxX; x++) {
+			if (this->cpuDepth[y * this->cpuWidth + x] >= nearest)
+				return false;
+		}
+	}
+	return true;
+}
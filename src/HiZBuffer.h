@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "Bounds.h"
+
+class Shader;
+
+// largest side of the pyramid level that is read back for the CPU occlusion test
+#define HIZ_READBACK_MAX_SIZE 128
+// boxes covering more texels of the read back level are treated as visible instead of scanning them
+#define HIZ_MAX_TEST_TEXELS 256
+// local size of hiZBuild.comp in both dimensions
+#define HIZ_BUILD_GROUP_SIZE 8
+
+///<summary>Hierarchical depth pyramid built from the gBuffer depth.
+///<para>Each level stores the farthest depth of the texels it covers, so a box whose nearest depth is farther than the pyramid over its screen rectangle is hidden.
+///The pyramid is built after the gBuffer pass and tested against during the next frame, together with the view projection it was built with.
+///A coarse level is copied back to the CPU through pixel buffers and fences without stalling, which adds a frame or two of latency to the CPU test.</para>
+///</summary>
+class HiZBuffer {
+public:
+	///<summary>Build the pyramid from a depth texture. Reallocates the pyramid if the size changed.</summary>
+	///<param name="buildShader">hiZBuild.comp</param>
+	///<param name="viewProjection">The view projection the depth was rendered with.</param>
+	void build(const Shader& buildShader, GLuint depthTexture, int width, int height, const glm::mat4& viewProjection);
+	///<summary>Start copying the read back level to the CPU. Skipped while the previous copy to the same buffer is still in flight.</summary>
+	void readBack();
+	///<summary>Take the newest finished copy for isOccluded. Never waits for the GPU.</summary>
+	void fetchReadBack();
+
+	///<summary>Test a world space box against the read back level. False if no copy has arrived yet or the box crosses the near plane.</summary>
+	bool isOccluded(const AABB& box) const;
+
+	///<summary>Whether a pyramid has been built since it was last invalidated.</summary>
+	bool isValid() const { return this->texture != 0 && this->built; }
+	///<summary>Whether isOccluded has a read back level to test against.</summary>
+	bool hasReadBack() const { return this->cpuValid; }
+	GLuint getTexture() const { return this->texture; }
+	int getWidth() const { return this->width; }
+	int getHeight() const { return this->height; }
+	int getLevelCount() const { return this->levels; }
+	const glm::mat4& getViewProjection() const { return this->viewProjection; }
+	///<summary>Forget the pyramid and the read back level, for example after the camera or the projection changed. Nothing is occlusion culled until the next build.</summary>
+	void invalidate();
+
+	///<summary>Set the occlusion uniforms of a culling compute shader, binding the pyramid to texture unit 0. The shader must be in use.</summary>
+	///<param name="hiZ">The pyramid to test against. nullptr or a pyramid that was never built turns the occlusion test of the shader off.</param>
+	static void bindForCulling(const Shader& cullShader, const HiZBuffer* hiZ);
+
+private:
+	GLuint texture = 0;
+	int width = 0, height = 0, levels = 0;
+	glm::mat4 viewProjection = glm::mat4(1.0f);
+	bool built = false;
+
+	// double buffered copies of the read back level
+	int readBackLevel = 0;
+	GLuint readBackBuffers[2] = { 0, 0 };
+	GLsync readBackFences[2] = { 0, 0 };
+	glm::mat4 readBackViewProjections[2];
+	int readBackIndex = 0;
+
+	// the newest read back level that arrived
+	std::vector<float> cpuDepth;
+	int cpuWidth = 0, cpuHeight = 0;
+	glm::mat4 cpuViewProjection = glm::mat4(1.0f);
+	bool cpuValid = false;
+
+	///<summary>Create the pyramid texture and pick the read back level.</summary>
+	void allocate(int width, int height);
+};
@@ -1,4 +1,8 @@
 #include "Icosphere.h"
+#include <algorithm>
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "glHelper.h"
 
 Icosphere::Icosphere(std::string name, float radius, int subdivisions, bool smooth) : IDrawObj(name) {
 	this->buildIcosphere(radius, subdivisions, smooth);
@@ -15,6 +19,7 @@ void Icosphere::buildIcosphere(float radius, int subdivisions, bool smooth) {
 	else {
 		this->buildVerticesFlat();
 	}
+	this->setBounds(Bounds::fromPoints(this->vertices.data(), this->vertices.size(), sizeof(glm::vec3)));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -32,6 +37,9 @@ void Icosphere::setRadius(float radius) {
 		this->vertices[i] *= scale;
 		this->interleavedVertices[i].Position *= scale;
 	}
+	// the arena holds the old positions, upload the scaled ones on the next draw
+	this->freeGeometry();
+	this->setBounds(Bounds::fromPoints(this->vertices.data(), this->vertices.size(), sizeof(glm::vec3)));
 }
 
 void Icosphere::setSubdivisions(int subdivisions) {
@@ -428,6 +436,8 @@ void Icosphere::buildIndices() {
 		this->indices.push_back(triangle.i2);
 		this->indices.push_back(triangle.i3);
 	}
+	// subdivision emits triangles far apart from their neighbours, the line indices are left as they are
+	MeshOptimizer::optimizeVertexCache(this->indices, this->vertices.size());
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -471,60 +481,94 @@ void Icosphere::clearData() {
 	std::vector<glm::vec3>().swap(this->vertices);
 	std::vector<glm::vec2>().swap(this->texCoords);
 	std::vector<glm::vec3>().swap(this->normals);
-	if (this->VAO != 0)
-		glDeleteBuffers(1, &this->VAO);
+	this->freeGeometry();
+}
+
+void Icosphere::freeGeometry() {
+	for (const GeometryRange& lod : this->lods)
+		GeometryArena::get().freeIndices(lod);
+	this->lods.clear();
+	GeometryArena::get().free(this->geometry);
+	this->geometry = GeometryRange();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 // drawers
 ////////////////////////////////////////////////////////////////////////////////////////////
 
-void Icosphere::genVAO() {
-	glGenVertexArrays(1, &VAO);
-	glBindVertexArray(VAO);
+///<summary>Convert to the vertex format of Mesh, which the arena takes, leaving the tangents empty.</summary>
+static void appendArenaVertices(const std::vector<Icosphere::VertexData>& vertices, std::vector<::VertexData>& arenaVertices) {
+	for (const Icosphere::VertexData& vertex : vertices) {
+		::VertexData arenaVertex;
+		arenaVertex.Position = vertex.Position;
+		arenaVertex.Normal = vertex.Normal;
+		arenaVertex.uv = vertex.TexCoord;
+		arenaVertex.Tangent = glm::vec3(0.0f);
+		arenaVertex.Bitangent = glm::vec3(0.0f);
+		arenaVertices.push_back(arenaVertex);
+	}
+}
 
-	// load data into vertex buffers
-	// copy vertex buffer data
-	glGenBuffers(1, &VBO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, this->getInterleavedVertexSize(), this->getInterleavedVertices(), GL_STATIC_DRAW);
+void Icosphere::genVAO() {
+	std::vector<::VertexData> arenaVertices;
+	appendArenaVertices(this->interleavedVertices, arenaVertices);
+
+	// the levels of detail are spheres with fewer subdivisions, each with a quarter of the triangles of the one before.
+	// Their vertices are stored after the full sphere so every level has the same position decode.
+	// setRadius scales the vertices without rebuilding, so take the radius from the surface
+	float surfaceRadius = this->vertices.empty() ? this->radius : glm::length(this->vertices[0]);
+	std::vector<std::vector<GLuint>> lodIndices;
+	for (int level = 1; level < MESH_LOD_MAX_LEVELS && this->subdivisions - level >= ICOSPHERE_LOD_MIN_SUBDIVISIONS; level++) {
+		Icosphere coarser(this->name, surfaceRadius, this->subdivisions - level, this->smooth);
+		GLuint baseVertex = (GLuint)arenaVertices.size();
+		appendArenaVertices(coarser.interleavedVertices, arenaVertices);
+		lodIndices.push_back(std::vector<GLuint>(coarser.indices.begin(), coarser.indices.end()));
+		for (GLuint& index : lodIndices.back())
+			index += baseVertex;
+	}
 
-	// copy index buffer data
-	glGenBuffers(1, &EBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->getIndexSize(), this->getIndices(), GL_STATIC_DRAW);
-	//checkGLError("setupMesh buffers");
+	this->geometry = GeometryArena::get().allocateMesh(arenaVertices.data(), arenaVertices.size(), this->indices.data(), this->indices.size());
+	for (const std::vector<GLuint>& levelIndices : lodIndices)
+		this->lods.push_back(GeometryArena::get().allocateIndices(this->geometry, levelIndices.data(), levelIndices.size()));
+	checkGLError("Icosphere::genVAO");
+}
 
-	// set the vertex attribute pointers for shader
-	glEnableVertexAttribArray(0); // vertex positions
-	glEnableVertexAttribArray(1); // vertex normals	
-	glEnableVertexAttribArray(2); // vertex texCoords
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)offsetof(VertexData, Normal));
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)offsetof(VertexData, TexCoord));
+GLuint Icosphere::getVertexArray() {
+	if (this->geometry.isEmpty()) {
+		this->genVAO();
+	}
+	return GeometryArena::get().getVertexArray();
+}
 
-	//checkGLError("setupMesh attribs");
-	// cleanup
-	glBindVertexArray(0);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
+GLuint Icosphere::getDepthVertexArray() {
+	if (this->geometry.isEmpty()) {
+		this->genVAO();
+	}
+	return GeometryArena::get().getDepthVertexArray();
 }
 
-void Icosphere::Draw(const Shader& shader, GLuint baseUnit) {
-	if (this->VAO == 0) {
+const GeometryRange* Icosphere::getGeometry(size_t lod) {
+	if (this->geometry.isEmpty()) {
 		this->genVAO();
 	}
+	if (lod == 0 || this->lods.empty())
+		return &this->geometry;
+	return &this->lods[std::min(lod, this->lods.size()) - 1];
+}
 
-	shader.setVec4("material.ambient", this->material->AmbientColor);
-	shader.setVec4("material.diffuse", this->material->DiffuseColor);
-	shader.setVec4("material.specular", this->material->SpecularColor);
-	shader.setFloat("material.shininess", this->material->Shininess);
-	shader.setFloat("material.opacity", this->material->Opacity);
-	shader.setFloat("material.reflectivity", this->material->Reflectivity);
-	shader.setFloat("material.refractionIndex", this->material->RefractionIndex);
+size_t Icosphere::getLodCount() {
+	if (this->geometry.isEmpty()) {
+		this->genVAO();
+	}
+	return this->lods.size() + 1;
+}
 
-	glBindVertexArray(VAO);
-	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+void Icosphere::drawGeometry(GLsizei instanceCount, size_t lod) {
+	const GeometryRange& geometry = *this->getGeometry(lod);
+	if (instanceCount == 1)
+		glDrawElementsBaseVertex(GL_TRIANGLES, geometry.indexCount, GL_UNSIGNED_INT, geometry.getIndexOffset(), geometry.baseVertex);
+	else
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, geometry.indexCount, GL_UNSIGNED_INT, geometry.getIndexOffset(), instanceCount, geometry.baseVertex);
 }
 
 void Icosphere::genLineVAO() {
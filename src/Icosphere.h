@@ -14,6 +14,10 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include "DrawObj.h"
 #include "shader.h"
+#include "vertexData.h"
+
+// fewest subdivisions a level of detail of a sphere may have
+#define ICOSPHERE_LOD_MIN_SUBDIVISIONS 1
 
 class Icosphere : public IDrawObj {
 public:
@@ -35,7 +39,7 @@ public:
 	};
 
 	Icosphere(std::string name, float radius = 1.0f, int subdivisions = 1, bool smooth = true);
-	~Icosphere() {}
+	~Icosphere() { this->freeGeometry(); }
 
 	// attributes
 	float getRadius() const { return this->radius; }
@@ -72,7 +76,11 @@ public:
 	const VertexData* getInterleavedVertices() const	{ return this->interleavedVertices.data(); }
 
 	// drawers
-	void Draw(const Shader& shader, GLuint baseUnit = 0);
+	GLuint getVertexArray();
+	GLuint getDepthVertexArray();
+	const GeometryRange* getGeometry(size_t lod = 0);
+	size_t getLodCount();
+	void drawGeometry(GLsizei instanceCount = 1, size_t lod = 0);
 	void drawLines();
 
 private:
@@ -93,6 +101,8 @@ private:
 
 	void genVAO();
 	void genLineVAO();
+	///<summary>Return the sphere and its levels of detail to the GeometryArena.</summary>
+	void freeGeometry();
 
 	float radius;
 	int subdivisions;
@@ -105,6 +115,8 @@ private:
 	std::vector<glm::vec2> texCoords;
 	std::vector<glm::vec3> normals;
 	std::vector<VertexData> interleavedVertices;
-	GLuint VAO = 0, VBO, EBO;
+	GeometryRange geometry;
+	// spheres with fewer subdivisions, sharing the vertex allocation of geometry
+	std::vector<GeometryRange> lods;
 	GLuint lineVAO = 0, lineVBO, lineEBO;
 };
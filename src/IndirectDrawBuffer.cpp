@@ -0,0 +1,74 @@
+#include "IndirectDrawBuffer.h"
+#include <algorithm>
+#include "glHelper.h"
+#include "shader.h"
+#include "Frustum.h"
+#include "HiZBuffer.h"
+
+void IndirectDrawBuffer::clear()
+{
+	this->commands.clear();
+	this->batches.clear();
+}
+
+void IndirectDrawBuffer::add(const GeometryRange& geometry, GLuint drawIndex, Material* material, GLuint flags)
+{
+	if (this->batches.empty() || this->batches.back().material != material)
+		this->batches.push_back({ material, (GLuint)this->commands.size(), 0 });
+	this->batches.back().count++;
+
+	DrawElementsIndirectCommand command;
+	command.count = (GLuint)geometry.indexCount;
+	command.instanceCount = 1;
+	command.firstIndex = geometry.firstIndex;
+	command.baseVertex = geometry.baseVertex;
+	command.baseInstance = (drawIndex & INDIRECT_DRAW_INDEX_MASK) | (flags << INDIRECT_DRAW_INDEX_BITS);
+	this->commands.push_back(command);
+}
+
+void IndirectDrawBuffer::upload()
+{
+	if (this->commands.empty())
+		return;
+	if (this->buffer == 0)
+		glGenBuffers(1, &this->buffer);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->buffer);
+	if (this->commands.size() > this->capacity) {
+		this->capacity = std::max(this->commands.size(), this->capacity * 2);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, this->capacity * sizeof(DrawElementsIndirectCommand), NULL, GL_DYNAMIC_DRAW);
+	}
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, this->commands.size() * sizeof(DrawElementsIndirectCommand), this->commands.data());
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	checkGLError("IndirectDrawBuffer::upload");
+}
+
+void IndirectDrawBuffer::cull(const Shader& cullShader, const Frustum& frustum, const HiZBuffer* hiZ)
+{
+	if (this->commands.empty())
+		return;
+	static const Uniform planesUniform("planes");
+	static const Uniform commandCountUniform("commandCount");
+	cullShader.Use();
+	// the planes are stored consecutively
+	glUniform4fv(cullShader.getUniformLocation(planesUniform), Frustum::PLANE_COUNT, &frustum.getPlane(Frustum::PLANE_LEFT)[0]);
+	cullShader.setInt(commandCountUniform, (int)this->commands.size());
+	HiZBuffer::bindForCulling(cullShader, hiZ);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING_POINT, this->buffer);
+	glDispatchCompute((GLuint)((this->commands.size() + INDIRECT_CULL_GROUP_SIZE - 1) / INDIRECT_CULL_GROUP_SIZE), 1, 1);
+	// the draws read the instance counts written by the compute shader
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+	checkGLError("IndirectDrawBuffer::cull");
+}
+
+void IndirectDrawBuffer::bind(GLuint vertexArray) const
+{
+	glBindVertexArray(vertexArray);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->buffer);
+}
+
+void IndirectDrawBuffer::draw(const IndirectBatch& batch) const
+{
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)(batch.first * sizeof(DrawElementsIndirectCommand)), batch.count, 0);
+	checkGLError("IndirectDrawBuffer::draw");
+}
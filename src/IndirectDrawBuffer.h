@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "GeometryArena.h"
+
+struct Material;
+class Shader;
+class Frustum;
+class HiZBuffer;
+
+// low bits of the base instance of an indirect draw that hold the index of its DrawData, the high bits are free for per draw flags
+#define INDIRECT_DRAW_INDEX_BITS 26
+#define INDIRECT_DRAW_INDEX_MASK ((1u << INDIRECT_DRAW_INDEX_BITS) - 1)
+// local size of indirectCull.comp
+#define INDIRECT_CULL_GROUP_SIZE 64
+
+///<summary>Per draw data read by the indirect shaders, indexed by the base instance of the draw. Laid out for std430.</summary>
+struct DrawData {
+	glm::mat4 model;
+	///<summary>The normal matrix in the upper 3x3.</summary>
+	glm::mat4 normal;
+	///<summary>World space bounding sphere as (center, radius), used by the culling compute shader.</summary>
+	glm::vec4 sphere;
+};
+
+///<summary>Layout of the commands read by glMultiDrawElementsIndirect.</summary>
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+///<summary>Consecutive commands that share a material and are issued by a single glMultiDrawElementsIndirect.</summary>
+struct IndirectBatch {
+	Material* material;
+	GLuint first;
+	GLsizei count;
+};
+
+///<summary>The draw commands of one pass over meshes stored in the GeometryArena.
+///<para>Meshes are added in draw order and grouped into a batch for every run of the same material, so a sorted pass issues one multi draw per material instead of one draw per mesh.
+///Buffers are created on the first upload and reused every frame, growing when needed.</para>
+///</summary>
+class IndirectDrawBuffer {
+public:
+	///<summary>Shader storage binding of the DrawData array.</summary>
+	static const GLuint DRAW_DATA_BINDING_POINT = 0;
+	///<summary>Shader storage binding of the commands while they are culled.</summary>
+	static const GLuint COMMAND_BINDING_POINT = 1;
+
+	void clear();
+	///<summary>Append a draw of a mesh.</summary>
+	///<param name="drawIndex">Index of the DrawData of the mesh.</param>
+	///<param name="material">Material of the mesh, or nullptr for passes that do not bind materials. A new batch starts whenever it changes.</param>
+	///<param name="flags">Up to 6 bits the shader can read from the top of gl_BaseInstance.</param>
+	void add(const GeometryRange& geometry, GLuint drawIndex, Material* material = nullptr, GLuint flags = 0);
+	///<summary>Upload the commands. Must be called before cull and draw.</summary>
+	void upload();
+	///<summary>Run the culling compute shader, zeroing the instance count of every command whose bounding sphere is outside of the frustum. The DrawData must be bound.</summary>
+	///<param name="hiZ">Optional depth pyramid of the last frame. Commands whose sphere is behind it are culled as well.</param>
+	void cull(const Shader& cullShader, const Frustum& frustum, const HiZBuffer* hiZ = nullptr);
+	///<summary>Bind a vertex array of the arena and the command buffer for the draws.</summary>
+	///<param name="vertexArray">The full or the position only vertex array of the GeometryArena.</param>
+	void bind(GLuint vertexArray) const;
+	///<summary>Issue the commands of a batch. The buffer must be bound and the shader in use.</summary>
+	void draw(const IndirectBatch& batch) const;
+
+	bool isEmpty() const { return this->commands.empty(); }
+	size_t getCommandCount() const { return this->commands.size(); }
+	const std::vector<IndirectBatch>& getBatches() const { return this->batches; }
+
+private:
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<IndirectBatch> batches;
+	GLuint buffer = 0;
+	size_t capacity = 0;
+};
@@ -0,0 +1,151 @@
+#include "InstancedModel.h"
+#include <algorithm>
+#include <cstddef>
+#include <glm/gtc/matrix_inverse.hpp>
+#include "glHelper.h"
+
+InstancedModel::InstancedModel(const std::string& name, Model* model) :
+	name(name),
+	model(model)
+{
+	glGenBuffers(1, &this->instanceVBO);
+	this->setupAttributes();
+}
+
+InstancedModel::~InstancedModel()
+{
+	glDeleteBuffers(1, &this->instanceVBO);
+	if (this->arenaVertexArray != 0)
+		glDeleteVertexArrays(1, &this->arenaVertexArray);
+	delete this->model;
+}
+
+void InstancedModel::setupAttributes()
+{
+	// meshes in the geometry arena share its vertex array, give them one of their own that also has the instance attributes
+	GeometryArena& arena = GeometryArena::get();
+	this->vertexArrays.clear();
+	for (IDrawObj* mesh : this->model->getMeshes()) {
+		if (mesh->getGeometry() == nullptr) {
+			this->vertexArrays.push_back(mesh->getVertexArray());
+			continue;
+		}
+		if (this->arenaVertexArray == 0)
+			glGenVertexArrays(1, &this->arenaVertexArray);
+		this->vertexArrays.push_back(this->arenaVertexArray);
+	}
+	if (this->arenaVertexArray != 0) {
+		arena.setupVertexArray(this->arenaVertexArray);
+		this->arenaGeneration = arena.getGeneration();
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+	for (size_t i = 0; i < this->vertexArrays.size(); i++) {
+		// the arena vertex array is shared by all arena meshes, set it up once
+		if (std::find(this->vertexArrays.begin(), this->vertexArrays.begin() + i, this->vertexArrays[i]) != this->vertexArrays.begin() + i)
+			continue;
+		glBindVertexArray(this->vertexArrays[i]);
+		// a mat4 attribute takes four locations and a mat3 three, one per column
+		for (GLuint column = 0; column < 4; column++) {
+			GLuint location = INSTANCE_ATTRIBUTE_LOCATION + column;
+			glEnableVertexAttribArray(location);
+			glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, model) + column * sizeof(glm::vec4)));
+			glVertexAttribDivisor(location, 1);
+		}
+		for (GLuint column = 0; column < 3; column++) {
+			GLuint location = INSTANCE_ATTRIBUTE_LOCATION + 4 + column;
+			glEnableVertexAttribArray(location);
+			glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, normal) + column * sizeof(glm::vec3)));
+			glVertexAttribDivisor(location, 1);
+		}
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	checkGLError("InstancedModel::setupAttributes");
+}
+
+size_t InstancedModel::addInstance(const glm::mat4& transform)
+{
+	this->transforms.push_back(transform);
+	this->dirty = true;
+	return this->transforms.size() - 1;
+}
+
+void InstancedModel::setInstance(size_t index, const glm::mat4& transform)
+{
+	this->transforms[index] = transform;
+	this->dirty = true;
+}
+
+void InstancedModel::removeInstance(size_t index)
+{
+	this->transforms[index] = this->transforms.back();
+	this->transforms.pop_back();
+	this->dirty = true;
+}
+
+void InstancedModel::clearInstances()
+{
+	this->transforms.clear();
+	this->dirty = true;
+}
+
+void InstancedModel::updateBuffer()
+{
+	// the arena moved its buffers to grow
+	if (this->arenaVertexArray != 0 && this->arenaGeneration != GeometryArena::get().getGeneration()) {
+		GeometryArena::get().setupVertexArray(this->arenaVertexArray);
+		this->arenaGeneration = GeometryArena::get().getGeneration();
+	}
+	this->model->refreshBounds();
+	if (this->model->getBoundsVersion() != this->modelBoundsVersion) {
+		this->modelBoundsVersion = this->model->getBoundsVersion();
+		this->dirty = true;
+	}
+	if (!this->dirty)
+		return;
+
+	this->bounds = Bounds();
+	this->instanceData.resize(this->transforms.size());
+	for (size_t i = 0; i < this->transforms.size(); i++) {
+		this->instanceData[i].model = this->transforms[i];
+		this->instanceData[i].normal = glm::inverseTranspose(glm::mat3(this->transforms[i]));
+		this->bounds.expand(this->model->getBounds().transform(this->transforms[i]));
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, this->instanceVBO);
+	if (this->instanceData.size() > this->capacity) {
+		// grow geometrically so adding instances one at a time does not reallocate every frame
+		this->capacity = std::max(this->instanceData.size(), this->capacity * 2);
+		glBufferData(GL_ARRAY_BUFFER, this->capacity * sizeof(InstanceData), NULL, GL_DYNAMIC_DRAW);
+	}
+	if (!this->instanceData.empty())
+		glBufferSubData(GL_ARRAY_BUFFER, 0, this->instanceData.size() * sizeof(InstanceData), this->instanceData.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	checkGLError("InstancedModel::updateBuffer");
+	this->dirty = false;
+}
+
+void InstancedModel::Draw(const Shader& shader, GLuint baseUnit)
+{
+	static const Uniform positionScaleUniform("positionScale");
+	static const Uniform positionOffsetUniform("positionOffset");
+
+	if (this->transforms.empty())
+		return;
+	shader.Use();
+	std::vector<IDrawObj*> meshes = this->model->getMeshes();
+	for (size_t i = 0; i < meshes.size(); i++) {
+		MaterialManager::get().bind(shader, meshes[i]->getMaterial(), baseUnit);
+		// meshes outside the arena reset the decode, the uniforms keep the one of the last packed mesh otherwise
+		static const GeometryRange unpacked;
+		const GeometryRange* geometry = meshes[i]->getGeometry();
+		if (geometry == nullptr)
+			geometry = &unpacked;
+		shader.setVec3(positionScaleUniform, geometry->positionScale);
+		shader.setVec3(positionOffsetUniform, geometry->positionOffset);
+		glBindVertexArray(this->vertexArrays[i]);
+		meshes[i]->drawGeometry((GLsizei)this->transforms.size());
+	}
+	checkGLError("InstancedModel::Draw");
+}
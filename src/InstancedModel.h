@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "model.h"
+#include "Bounds.h"
+
+// first vertex attribute of the per instance data. The model matrix uses 5-8 and the normal matrix 9-11.
+#define INSTANCE_ATTRIBUTE_LOCATION 5
+
+///<summary>The per instance vertex attributes, as laid out in the instance buffer.</summary>
+struct InstanceData {
+	glm::mat4 model;
+	glm::mat3 normal;
+};
+
+///<summary>Many copies of one model drawn with a single glDrawElementsInstanced per mesh.
+///<para>The meshes of the model get per instance model and normal matrix attributes sourced from an instance buffer, so the model must not be shared with another InstancedModel.
+///Meshes stored in the GeometryArena are drawn through a vertex array of the instanced model instead of the shared one of the arena.
+///Instances are culled as a group against the bounds of all of them. Shaders drawing instanced models read the matrices from the attributes instead of the Model and Normal uniforms.</para>
+///</summary>
+class InstancedModel {
+public:
+	///<param name="name">Name of the instanced model in the scene.</param>
+	///<param name="model">The model that is instanced. The instanced model takes ownership. Its own transform is ignored.</param>
+	InstancedModel(const std::string& name, Model* model);
+	~InstancedModel();
+
+	///<summary>Add an instance with a world transform.</summary>
+	///<returns>The index of the instance. Indices change when instances are removed.</returns>
+	size_t addInstance(const glm::mat4& transform);
+	void setInstance(size_t index, const glm::mat4& transform);
+	///<summary>Remove an instance. The last instance takes its index.</summary>
+	void removeInstance(size_t index);
+	void clearInstances();
+
+	///<summary>Upload the instance buffer and recompute the bounds if instances changed. Must be called on the thread that owns the OpenGL context.</summary>
+	void updateBuffer();
+
+	///<summary>Draw every instance of the model's meshes, binding the material of each mesh.</summary>
+	void Draw(const Shader& shader, GLuint baseUnit = 0);
+
+	const std::string& getName() const { return this->name; }
+	Model* getModel() const { return this->model; }
+	const std::vector<IDrawObj*> getMeshes() const { return this->model->getMeshes(); }
+	///<summary>Get the vertex array the mesh at the index is drawn with, which has the instance attributes.</summary>
+	GLuint getVertexArray(size_t meshIndex) const { return this->vertexArrays[meshIndex]; }
+	size_t getInstanceCount() const { return this->transforms.size(); }
+	const glm::mat4& getTransform(size_t index) const { return this->transforms[index]; }
+	///<summary>Get the bounds of all instances in world space. Refreshed by updateBuffer.</summary>
+	const Bounds& getBounds() const { return this->bounds; }
+	///<summary>Name of the shader the instances are forward rendered with. Empty if they are drawn in the gBuffer pass.
+	///<para>The renderer draws them with the variant of that shader named with an "Instanced" suffix.</para>
+	///</summary>
+	const std::string& getShader() const { return this->shader; }
+	void setShader(const std::string& shader) { this->shader = shader; }
+
+private:
+	InstancedModel(const InstancedModel&) = delete;
+	InstancedModel& operator=(const InstancedModel&) = delete;
+
+	std::string name;
+	Model* model;
+	std::string shader;
+	std::vector<glm::mat4> transforms;
+	std::vector<InstanceData> instanceData;
+	Bounds bounds;
+	///<summary>Bounds version of the model the bounds were computed from.</summary>
+	uint32_t modelBoundsVersion = 0;
+	GLuint instanceVBO = 0;
+	///<summary>Vertex array of each mesh of the model.</summary>
+	std::vector<GLuint> vertexArrays;
+	GLuint arenaVertexArray = 0;
+	unsigned int arenaGeneration = 0;
+	///<summary>Number of instances the buffer has room for.</summary>
+	size_t capacity = 0;
+	bool dirty = true;
+
+	///<summary>Point the instance attributes of every mesh's vertex array at the instance buffer.</summary>
+	void setupAttributes();
+};
@@ -11,7 +11,11 @@ Light::Light(
 	ambient(ambient),
 	diffuse(diffuse),
 	specular(specular),
-	prefix(prefix)
+	prefix(prefix),
+	ambientUniform(prefix + "light.ambient"),
+	diffuseUniform(prefix + "light.diffuse"),
+	specularUniform(prefix + "light.specular"),
+	colorUniform(prefix + "light.color")
 {
 }
 
@@ -27,7 +31,11 @@ PointLight::PointLight(
 	const std::string prefix
 ) :
 	Light(color, ambient, diffuse, specular, prefix),
-	constant(constant), linear(linear), quadratic(quadratic), position(position)
+	constant(constant), linear(linear), quadratic(quadratic), position(position),
+	constantUniform(prefix + "light.constant"),
+	linearUniform(prefix + "light.linear"),
+	quadraticUniform(prefix + "light.quadratic"),
+	positionUniform(prefix + "light.position")
 { 
 	this->color = color;
 }
@@ -40,39 +48,26 @@ const float PointLight::getRadius() {
 
 void PointLight::uploadUniforms(const Shader& shader) const
 {
-	shader.setFloat(this->prefix + "light.ambient", this->ambient);
-	shader.setFloat(this->prefix + "light.diffuse", this->diffuse);
-	shader.setFloat(this->prefix + "light.specular", this->specular);
-	shader.setFloat(this->prefix + "light.constant", this->constant);
-	shader.setFloat(this->prefix + "light.linear", this->linear);
-	shader.setFloat(this->prefix + "light.quadratic", this->quadratic);
-	shader.setVec3(this->prefix + "light.color", this->color);
-	shader.setVec3(this->prefix + "light.position", this->position);
+	shader.setFloat(this->ambientUniform, this->ambient);
+	shader.setFloat(this->diffuseUniform, this->diffuse);
+	shader.setFloat(this->specularUniform, this->specular);
+	shader.setFloat(this->constantUniform, this->constant);
+	shader.setFloat(this->linearUniform, this->linear);
+	shader.setFloat(this->quadraticUniform, this->quadratic);
+	shader.setVec3(this->colorUniform, this->color);
+	shader.setVec3(this->positionUniform, this->position);
 }
 
-GLuint PointLight::updateUniformBlock(GLuint ubo, GLuint start)
+void PointLight::packBlock(PointLightBlock& block) const
 {
-	GLuint size = start;
-	glBindBuffer(GL_UNIFORM_BUFFER, ubo);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(float), &this->ambient);
-	size += sizeof(float);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(float), &this->diffuse);
-	size += sizeof(float);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(float), &this->specular);
-	size += sizeof(float);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(float), &this->constant);
-	size += sizeof(float);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(float), &this->linear);
-	size += sizeof(float);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(float), &this->quadratic);
-	size += sizeof(float) + 8;
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(glm::vec4), glm::value_ptr(this->color));
-	size += sizeof(glm::vec4);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(glm::vec4), glm::value_ptr(this->position));
-	size += sizeof(glm::vec4);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
-	checkGLError("PointLight::updateUniformBlock");
-	return size;
+	block.ambient = this->ambient;
+	block.diffuse = this->diffuse;
+	block.specular = this->specular;
+	block.constant = this->constant;
+	block.linear = this->linear;
+	block.quadratic = this->quadratic;
+	block.color = glm::vec4(this->color, 0.0f);
+	block.position = glm::vec4(this->position, 1.0f);
 }
 
 DirectionLight::DirectionLight(
@@ -84,36 +79,27 @@ DirectionLight::DirectionLight(
 	const std::string prefix
 ) :
 	Light(color, ambient, diffuse, specular, prefix),
-	direction(direction)
+	direction(direction),
+	directionUniform(prefix + "light.direction")
 {
 }
 
 void DirectionLight::uploadUniforms(const Shader& shader) const
 {
-	shader.setVec3((this->prefix + "light.color"), this->color);
-	shader.setFloat((this->prefix + "light.ambient"), this->ambient);
-	shader.setFloat((this->prefix + "light.diffuse"), this->diffuse);
-	shader.setFloat((this->prefix + "light.specular"), this->specular);
-	shader.setVec3((this->prefix + "light.direction"), this->direction);
+	shader.setVec3(this->colorUniform, this->color);
+	shader.setFloat(this->ambientUniform, this->ambient);
+	shader.setFloat(this->diffuseUniform, this->diffuse);
+	shader.setFloat(this->specularUniform, this->specular);
+	shader.setVec3(this->directionUniform, this->direction);
 }
 
-GLuint DirectionLight::updateUniformBlock(GLuint ubo, GLuint start)
+void DirectionLight::packBlock(DirectionLightBlock& block) const
 {
-	GLuint size = start;
-	glBindBuffer(GL_UNIFORM_BUFFER, ubo);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(float), &this->ambient);
-	size += sizeof(float);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(float), &this->diffuse);
-	size += sizeof(float);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(float), &this->specular);
-	size += sizeof(float) + 4;
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(glm::vec4), glm::value_ptr(this->color));
-	size += sizeof(glm::vec4);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(glm::vec4), glm::value_ptr(this->direction));
-	size += sizeof(glm::vec4);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
-	checkGLError("DirectionLight::updateUniformBlock");
-	return size;
+	block.ambient = this->ambient;
+	block.diffuse = this->diffuse;
+	block.specular = this->specular;
+	block.color = glm::vec4(this->color, 0.0f);
+	block.direction = glm::vec4(this->direction, 0.0f);
 }
 
 SpotLight::SpotLight(
@@ -131,45 +117,32 @@ SpotLight::SpotLight(
 	const std::string prefix
 ) :
 	PointLight(position, color, ambient, diffuse, specular, constant, linear, quadratic, prefix),
-	direction(direction), cutOff(cutOff), outerCutOff(outerCutOff)
+	direction(direction), cutOff(cutOff), outerCutOff(outerCutOff),
+	directionUniform(prefix + "light.direction"),
+	cutOffUniform(prefix + "light.cutOff"),
+	outerCutOffUniform(prefix + "light.outerCutOff")
 {
 }
 
 void SpotLight::uploadUniforms(const Shader& shader) const
 {
 	PointLight::uploadUniforms(shader);
-	shader.setVec3((this->prefix + "light.direction").c_str(), this->direction);
-	shader.setFloat((this->prefix + "light.cutOff").c_str(), this->cutOff);
-	shader.setFloat((this->prefix + "light.outerCutOff").c_str(), this->outerCutOff);
+	shader.setVec3(this->directionUniform, this->direction);
+	shader.setFloat(this->cutOffUniform, this->cutOff);
+	shader.setFloat(this->outerCutOffUniform, this->outerCutOff);
 }
 
-GLuint SpotLight::updateUniformBlock(GLuint ubo, GLuint start)
+void SpotLight::packBlock(SpotLightBlock& block) const
 {
-	GLuint size = start;
-	glBindBuffer(GL_UNIFORM_BUFFER, ubo);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(glm::vec4), glm::value_ptr(this->color));
-	size += sizeof(glm::vec4);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(glm::vec4), glm::value_ptr(this->position));
-	size += sizeof(glm::vec4);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(glm::vec4), glm::value_ptr(this->direction));
-	size += sizeof(glm::vec4);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(float), &this->ambient);
-	size += sizeof(float);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(float), &this->diffuse);
-	size += sizeof(float);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(float), &this->specular);
-	size += sizeof(float);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(float), &this->constant);
-	size += sizeof(float);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(float), &this->linear);
-	size += sizeof(float);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(float), &this->quadratic);
-	size += sizeof(float);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(float), &this->cutOff);
-	size += sizeof(float);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(float), &this->outerCutOff);
-	size += sizeof(float);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
-	checkGLError("SpotLight::updateUniformBlock");
-	return size;
+	block.color = glm::vec4(this->color, 0.0f);
+	block.position = glm::vec4(this->position, 1.0f);
+	block.direction = glm::vec4(this->direction, 0.0f);
+	block.ambient = this->ambient;
+	block.diffuse = this->diffuse;
+	block.specular = this->specular;
+	block.constant = this->constant;
+	block.linear = this->linear;
+	block.quadratic = this->quadratic;
+	block.cutOff = this->cutOff;
+	block.outerCutOff = this->outerCutOff;
 }
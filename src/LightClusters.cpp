@@ -0,0 +1,43 @@
+#include "LightClusters.h"
+#include "glHelper.h"
+#include "shader.h"
+
+void LightClusters::initialize()
+{
+	glGenBuffers(1, &this->gridBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->gridBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, CLUSTER_COUNT * sizeof(glm::uvec2), NULL, GL_DYNAMIC_COPY);
+	glGenBuffers(1, &this->indexBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->indexBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, CLUSTER_COUNT * CLUSTER_MAX_LIGHTS * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	checkGLError("LightClusters::initialize");
+}
+
+void LightClusters::cull(const Shader& cullShader, const glm::mat4& view, const glm::mat4& projection, float nearBound, float farBound)
+{
+	static const Uniform viewUniform("view");
+	static const Uniform inverseProjectionUniform("inverseProjection");
+	static const Uniform nearBoundUniform("nearBound");
+	static const Uniform farBoundUniform("farBound");
+
+	if (this->gridBuffer == 0)
+		this->initialize();
+
+	cullShader.Use();
+	cullShader.setMat4(viewUniform, view);
+	cullShader.setMat4(inverseProjectionUniform, glm::inverse(projection));
+	cullShader.setFloat(nearBoundUniform, nearBound);
+	cullShader.setFloat(farBoundUniform, farBound);
+	this->bind();
+	// one work group per depth slice, one invocation per cluster of the slice
+	glDispatchCompute(1, 1, CLUSTER_GRID_Z);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	checkGLError("LightClusters::cull");
+}
+
+void LightClusters::bind() const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GRID_BINDING_POINT, this->gridBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDEX_BINDING_POINT, this->indexBuffer);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+class Shader;
+
+// clusters the view frustum is split into. x and y are screen tiles, z are depth slices that grow exponentially with distance
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+#define CLUSTER_COUNT (CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z)
+// lights a single cluster can hold, the rest are dropped
+#define CLUSTER_MAX_LIGHTS 128
+
+///<summary>Bins point and spot lights into a grid of view space clusters so a single full screen pass can shade every light.
+///<para>The lights are read from the light storage buffer of the LightManager, which has to be bound when culling. The cull compute shader builds the bounds of each cluster
+///and writes the lights whose sphere touches it into a fixed size slot per cluster, so no atomics or prefix sums are needed. Buffers are created on the first cull.</para>
+///</summary>
+class LightClusters {
+public:
+	///<summary>Shader storage bindings, following the lights of the LightManager.</summary>
+	static const GLuint GRID_BINDING_POINT = 3;
+	static const GLuint INDEX_BINDING_POINT = 4;
+
+	///<summary>Assign the bound lights to the clusters of a camera.</summary>
+	///<param name="cullShader">clusterCull.comp</param>
+	void cull(const Shader& cullShader, const glm::mat4& view, const glm::mat4& projection, float nearBound, float farBound);
+	///<summary>Bind the cluster lists for the shading pass.</summary>
+	void bind() const;
+
+private:
+	// per cluster offset and count into the index buffer
+	GLuint gridBuffer = 0;
+	GLuint indexBuffer = 0;
+
+	///<summary>Create the grid and index buffers, their size only depends on the grid.</summary>
+	void initialize();
+};
@@ -1,7 +1,39 @@
 #include "LightManager.h"
+#include <algorithm>
+#include <cstring>
 
 LightManager::LightManager() {}
 
+void LightManager::removePointLight(PointLight* plight) {
+	this->pointLights.erase(std::remove(this->pointLights.begin(), this->pointLights.end(), plight), this->pointLights.end());
+	this->lightsChanged();
+}
+
+void LightManager::removeDirectionLight(DirectionLight* dlight) {
+	this->directionLights.erase(std::remove(this->directionLights.begin(), this->directionLights.end(), dlight), this->directionLights.end());
+	this->lightsChanged();
+}
+
+void LightManager::removeSpotLight(SpotLight* slight) {
+	this->spotLights.erase(std::remove(this->spotLights.begin(), this->spotLights.end(), slight), this->spotLights.end());
+	this->lightsChanged();
+}
+
+void LightManager::collectDirtyLights() {
+	auto collect = [this](Light* light) {
+		if (light->isDirty()) {
+			this->lightsChanged();
+			light->clearDirty();
+		}
+	};
+	for (PointLight* plight : this->pointLights)
+		collect(plight);
+	for (SpotLight* slight : this->spotLights)
+		collect(slight);
+	for (DirectionLight* dlight : this->directionLights)
+		collect(dlight);
+}
+
 void LightManager::drawLights(const Shader& shader) {
 	if (this->VAO == 0)
     {
@@ -50,35 +82,80 @@ void LightManager::drawLights(const Shader& shader) {
 
 void LightManager::createUniformBlock()
 {
-	GLuint pointLightSize = 64;
-	GLuint spotLightSize = 80;
-	GLuint directionLightSize = 48;
-
-	GLuint uboSize = this->pointLights.size() * pointLightSize +
-		this->spotLights.size() * spotLightSize +
-		this->directionLights.size() * directionLightSize;
-
-	glGenBuffers(1, &this->ubo);
-	glBindBuffer(GL_UNIFORM_BUFFER, this->ubo);
-	glBufferData(GL_UNIFORM_BUFFER, uboSize, NULL, GL_DYNAMIC_DRAW);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
-	glBindBufferRange(GL_UNIFORM_BUFFER, this->LIGHTS_UNIFORM_BLOCK_BINDING_POINT, this->ubo, 0, uboSize);
+	// the block has a fixed number of lights, extra lights are only read by the clustered and instanced passes
+	std::memset(&this->block, 0, sizeof(LightsBlock));
 
 	//set initial value
-	checkGLError("LightManager::createUniformBlock");
+	this->blockDirty = true;
 	updateUniformBlock();
 }
 
 void LightManager::updateUniformBlock()
 {
-	GLuint size = 0;
-	for (int i = 0; i < this->pointLights.size(); i++) {
-		size = this->pointLights.at(i)->updateUniformBlock(this->ubo, size);
+	this->collectDirtyLights();
+	if (this->blockDirty) {
+		// missing lights leave their slot as it is so the following types stay at their offsets
+		for (int i = 0; i < std::min((int)this->pointLights.size(), LIGHTS_BLOCK_POINT_LIGHTS); i++) {
+			this->pointLights.at(i)->packBlock(this->block.plight[i]);
+		}
+		for (int i = 0; i < std::min((int)this->spotLights.size(), LIGHTS_BLOCK_SPOT_LIGHTS); i++) {
+			this->spotLights.at(i)->packBlock(this->block.slight[i]);
+		}
+		for (int i = 0; i < std::min((int)this->directionLights.size(), LIGHTS_BLOCK_DIRECTION_LIGHTS); i++) {
+			this->directionLights.at(i)->packBlock(this->block.dlight[i]);
+		}
+		this->blockDirty = false;
+	}
+	FrameUniformAllocator::get().upload(LIGHTS_UNIFORM_BLOCK_BINDING_POINT, &this->block, sizeof(LightsBlock));
+	checkGLError("LightManager::updateUniformBlock");
+}
+
+void LightManager::updateLightBuffer()
+{
+	this->collectDirtyLights();
+	if (!this->bufferDirty && this->lightBuffer != 0)
+		return;
+	this->bufferDirty = false;
+
+	this->packedLights.clear();
+	for (PointLight* pointLight : this->pointLights) {
+		PackedLight light;
+		light.position = glm::vec4(pointLight->getPosition(), pointLight->getRadius());
+		light.color = glm::vec4(pointLight->getColor(), pointLight->getAmbient());
+		// a cut off below -1 lights every direction
+		light.direction = glm::vec4(0.0f, 0.0f, -1.0f, -2.0f);
+		light.attenuation = glm::vec4(pointLight->getConstant(), pointLight->getLinear(), pointLight->getQuadratic(), -3.0f);
+		light.factors = glm::vec4(pointLight->getDiffuse(), pointLight->getSpecular(), 0.0f, 0.0f);
+		this->packedLights.push_back(light);
 	}
-	for (int i = 0; i < this->spotLights.size(); i++) {
-		size = this->spotLights.at(i)->updateUniformBlock(this->ubo, size);
+	for (SpotLight* spotLight : this->spotLights) {
+		PackedLight light;
+		light.position = glm::vec4(spotLight->getPosition(), spotLight->getRadius());
+		light.color = glm::vec4(spotLight->getColor(), spotLight->getAmbient());
+		light.direction = glm::vec4(spotLight->getDirection(), spotLight->getCutOff());
+		light.attenuation = glm::vec4(spotLight->getConstant(), spotLight->getLinear(), spotLight->getQuadratic(), spotLight->getOuterCutOff());
+		light.factors = glm::vec4(spotLight->getDiffuse(), spotLight->getSpecular(), 0.0f, 0.0f);
+		this->packedLights.push_back(light);
 	}
-	for (int i = 0; i < this->directionLights.size(); i++) {
-		size = this->directionLights.at(i)->updateUniformBlock(this->ubo, size);
+
+	if (this->lightBuffer == 0)
+		glGenBuffers(1, &this->lightBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->lightBuffer);
+	// keep room for at least one light so the buffer can always be bound
+	if (this->packedLights.size() > this->lightCapacity || this->lightCapacity == 0) {
+		this->lightCapacity = std::max(std::max(this->packedLights.size(), this->lightCapacity * 2), (size_t)1);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(glm::uvec4) + this->lightCapacity * sizeof(PackedLight), NULL, GL_DYNAMIC_DRAW);
 	}
+	// point, spot and total light counts ahead of the lights
+	glm::uvec4 counts((GLuint)this->pointLights.size(), (GLuint)this->spotLights.size(), (GLuint)this->packedLights.size(), 0);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(glm::uvec4), &counts);
+	if (!this->packedLights.empty())
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(glm::uvec4), this->packedLights.size() * sizeof(PackedLight), this->packedLights.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	checkGLError("LightManager::updateLightBuffer");
+}
+
+void LightManager::bindLightBuffer() const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHTS_STORAGE_BINDING_POINT, this->lightBuffer);
 }
@@ -18,20 +18,62 @@
 #include "glHelper.h"
 #include "ShadowMap.h"
 #include "ShadowCubeMap.h"
+#include "FrameUniformAllocator.h"
 
+// lights of each type declared by the Lights uniform block of the shaders. Lights past these are not uploaded to the block
+#define LIGHTS_BLOCK_POINT_LIGHTS 1
+#define LIGHTS_BLOCK_SPOT_LIGHTS 1
+#define LIGHTS_BLOCK_DIRECTION_LIGHTS 1
+
+///<summary>CPU mirror of the std140 Lights uniform block.</summary>
+struct LightsBlock {
+	PointLightBlock plight[LIGHTS_BLOCK_POINT_LIGHTS];
+	SpotLightBlock slight[LIGHTS_BLOCK_SPOT_LIGHTS];
+	DirectionLightBlock dlight[LIGHTS_BLOCK_DIRECTION_LIGHTS];
+};
+
+///<summary>A point or spot light as read from the light storage buffer by the deferred passes. Laid out for std430.</summary>
+struct PackedLight {
+	///<summary>World space position and the radius the light reaches.</summary>
+	glm::vec4 position;
+	///<summary>Color and ambient strength.</summary>
+	glm::vec4 color;
+	///<summary>Spot direction and the cosine of the inner cut off. Point lights use a cut off that lights every direction.</summary>
+	glm::vec4 direction;
+	///<summary>Constant, linear and quadratic attenuation and the cosine of the outer cut off.</summary>
+	glm::vec4 attenuation;
+	///<summary>Diffuse and specular strength.</summary>
+	glm::vec4 factors;
+};
+
+///<summary>Owns the lights of a scene and their GPU copies.
+///<para>The Lights uniform block holds the few lights the forward shaders declare. Every point and spot light is also packed into a shader storage buffer,
+///point lights first, behind a header with the light counts. The buffer doubles its capacity when the lights outgrow it, so lights can be added and removed at any time.</para>
+///<para>Both are only repacked when a light was changed through its setters or the lights were added or removed. The uniform block is packed into a CPU mirror
+///that is copied into the FrameUniformAllocator with a single memcpy every frame.</para>
+///</summary>
 class LightManager
 {
 static const GLuint LIGHTS_UNIFORM_BLOCK_BINDING_POINT = 2;
 public:
+	///<summary>Shader storage binding of the packed lights. 0 and 1 are taken by the indirect draws.</summary>
+	static const GLuint LIGHTS_STORAGE_BINDING_POINT = 2;
+
 	LightManager();
 
 	std::vector<PointLight*> getPointLights() { return this->pointLights; }
-	void addPointLight(PointLight* plight) { this->pointLights.push_back(plight); }
+	void addPointLight(PointLight* plight) { this->pointLights.push_back(plight); this->lightsChanged(); }
+	///<summary>Remove a point light without deleting it.</summary>
+	void removePointLight(PointLight* plight);
 
-	void addDirectionLight(DirectionLight* dlight) { this->directionLights.push_back(dlight); }
+	void addDirectionLight(DirectionLight* dlight) { this->directionLights.push_back(dlight); this->lightsChanged(); }
+	///<summary>Remove a direction light without deleting it.</summary>
+	void removeDirectionLight(DirectionLight* dlight);
 	std::vector<DirectionLight*> getDirectionLights() { return this->directionLights; }
 
-	void addSpotLight(SpotLight* slight) { this->spotLights.push_back(slight); }
+	void addSpotLight(SpotLight* slight) { this->spotLights.push_back(slight); this->lightsChanged(); }
+	///<summary>Remove a spot light without deleting it.</summary>
+	void removeSpotLight(SpotLight* slight);
 	std::vector<SpotLight*> getSpotLights() { return this->spotLights; }
 
 	void addShadowMap(ShadowMap* shadowMap) { this->shadowMaps.push_back(shadowMap); }
@@ -45,14 +87,33 @@ public:
 
 	void createUniformBlock();
 
+	///<summary>Repack the uniform block mirror if any light changed and upload it for the current frame.</summary>
 	void updateUniformBlock();
 
+	///<summary>Pack the point and spot lights and upload them to the light storage buffer, growing it if needed.</summary>
+	void updateLightBuffer();
+	///<summary>Bind the light storage buffer for the deferred lighting passes.</summary>
+	void bindLightBuffer() const;
+	///<summary>Point and spot lights in the light storage buffer as of the last update.</summary>
+	size_t getPackedLightCount() const { return this->packedLights.size(); }
+
 private:
-	GLuint ubo;
+	LightsBlock block;
+	// set from the light dirty flags, consumed by the uniform block and the storage buffer separately
+	bool blockDirty = true;
+	bool bufferDirty = true;
+	std::vector<PackedLight> packedLights;
+	GLuint lightBuffer = 0;
+	// lights the storage buffer has room for
+	size_t lightCapacity = 0;
 	GLuint VAO = 0, VBO;
 	std::vector<PointLight*> pointLights;
 	std::vector<DirectionLight*> directionLights;
 	std::vector<SpotLight*> spotLights;
 	std::vector<ShadowMap*> shadowMaps;
 	std::vector<ShadowCubeMap*> shadowCubeMaps;
+
+	void lightsChanged() { this->blockDirty = true; this->bufferDirty = true; }
+	///<summary>Move the dirty flags of the lights to the manager.</summary>
+	void collectDirtyLights();
 };
@@ -0,0 +1,212 @@
+#include "MaterialManager.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include "DrawObj.h"
+#include "glHelper.h"
+
+MaterialManager& MaterialManager::get()
+{
+	static MaterialManager manager;
+	return manager;
+}
+
+size_t MaterialManager::hash(const Material& material)
+{
+	size_t seed = 0;
+	auto combine = [&seed](size_t value) { seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2); };
+	for (int i = 0; i < 4; i++) {
+		combine(std::hash<float>()(material.AmbientColor[i]));
+		combine(std::hash<float>()(material.DiffuseColor[i]));
+		combine(std::hash<float>()(material.SpecularColor[i]));
+	}
+	combine(std::hash<float>()(material.Shininess));
+	combine(std::hash<float>()(material.Opacity));
+	combine(std::hash<float>()(material.Reflectivity));
+	combine(std::hash<float>()(material.RefractionIndex));
+	for (const std::vector<GLuint>* textures : { &material.textureAmbient, &material.textureDiffuse, &material.textureSpecular, &material.textureNormal, &material.textureHeight, &material.textureReflect }) {
+		combine(textures->size());
+		for (GLuint texture : *textures)
+			combine(texture);
+	}
+	return seed;
+}
+
+bool MaterialManager::equal(const Material& a, const Material& b)
+{
+	return a.AmbientColor == b.AmbientColor
+		&& a.DiffuseColor == b.DiffuseColor
+		&& a.SpecularColor == b.SpecularColor
+		&& a.Shininess == b.Shininess
+		&& a.Opacity == b.Opacity
+		&& a.Reflectivity == b.Reflectivity
+		&& a.RefractionIndex == b.RefractionIndex
+		&& a.textureAmbient == b.textureAmbient
+		&& a.textureDiffuse == b.textureDiffuse
+		&& a.textureSpecular == b.textureSpecular
+		&& a.textureNormal == b.textureNormal
+		&& a.textureHeight == b.textureHeight
+		&& a.textureReflect == b.textureReflect;
+}
+
+Material* MaterialManager::intern(const Material& material)
+{
+	size_t key = MaterialManager::hash(material);
+	auto range = this->lookup.equal_range(key);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (MaterialManager::equal(*it->second, material))
+			return this->acquire(it->second);
+	}
+
+	Material* registered = new Material(material);
+	registered->id = 0;
+	registered->references = 1;
+	this->add(registered);
+	this->lookup.emplace(key, registered);
+	return registered;
+}
+
+Material* MaterialManager::acquire(Material* material)
+{
+	if (material->references > 0)
+		material->references++;
+	return material;
+}
+
+void MaterialManager::release(Material* material)
+{
+	// materials that were added instead of interned are kept
+	if (material == nullptr || material->references <= 0 || --material->references > 0)
+		return;
+
+	auto range = this->lookup.equal_range(MaterialManager::hash(*material));
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second == material) {
+			this->lookup.erase(it);
+			break;
+		}
+	}
+	if (material->dirty)
+		this->dirtyMaterials.erase(std::remove(this->dirtyMaterials.begin(), this->dirtyMaterials.end(), material), this->dirtyMaterials.end());
+	this->materials[material->id - 1] = nullptr;
+	this->freeIds.push_back(material->id);
+	delete material;
+}
+
+Material* MaterialManager::add(Material* material)
+{
+	if (material->id != 0)
+		return material;
+	if (!this->freeIds.empty()) {
+		material->id = this->freeIds.back();
+		this->freeIds.pop_back();
+		this->materials[material->id - 1] = material;
+	}
+	else {
+		this->materials.push_back(material);
+		material->id = (unsigned int)this->materials.size();
+	}
+	material->dirty = false;
+	this->markDirty(material);
+	return material;
+}
+
+void MaterialManager::markDirty(Material* material)
+{
+	if (material->dirty)
+		return;
+	material->dirty = true;
+	this->dirtyMaterials.push_back(material);
+}
+
+void MaterialManager::reserve()
+{
+	if (this->materials.size() <= this->uboCapacity)
+		return;
+
+	if (this->uboStride == 0) {
+		GLint alignment;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		this->uboStride = ((MATERIAL_UNIFORM_BLOCK_SIZE + alignment - 1) / alignment) * alignment;
+	}
+	GLuint capacity = std::max(this->uboCapacity, (GLuint)MATERIAL_UNIFORM_BLOCK_INITIAL_CAPACITY);
+	while (capacity < this->materials.size())
+		capacity *= 2;
+
+	if (this->ubo != 0)
+		glDeleteBuffers(1, &this->ubo);
+	glGenBuffers(1, &this->ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, this->ubo);
+	glBufferData(GL_UNIFORM_BUFFER, capacity * this->uboStride, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	this->uboCapacity = capacity;
+	checkGLError("MaterialManager::reserve");
+
+	// the new buffer is empty, every material has to be uploaded again
+	for (Material* material : this->materials) {
+		if (material != nullptr)
+			this->markDirty(material);
+	}
+}
+
+void MaterialManager::upload(const Material* material)
+{
+	float constants[MATERIAL_UNIFORM_BLOCK_SIZE / sizeof(float)];
+	std::memcpy(&constants[0], &material->AmbientColor[0], sizeof(glm::vec4));
+	std::memcpy(&constants[4], &material->DiffuseColor[0], sizeof(glm::vec4));
+	std::memcpy(&constants[8], &material->SpecularColor[0], sizeof(glm::vec4));
+	constants[12] = material->Shininess;
+	constants[13] = material->Opacity;
+	constants[14] = material->Reflectivity;
+	constants[15] = material->RefractionIndex;
+	glBufferSubData(GL_UNIFORM_BUFFER, (material->id - 1) * this->uboStride, sizeof(constants), constants);
+}
+
+void MaterialManager::updateUniformBlock()
+{
+	this->reserve();
+	if (this->dirtyMaterials.empty())
+		return;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, this->ubo);
+	for (Material* material : this->dirtyMaterials) {
+		this->upload(material);
+		material->dirty = false;
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	this->dirtyMaterials.clear();
+	checkGLError("MaterialManager::updateUniformBlock");
+}
+
+unsigned int MaterialManager::bind(const Shader& shader, Material* material, GLuint baseUnit)
+{
+	// materials created outside of intern are registered the first time they are drawn
+	if (material->id == 0)
+		this->add(material);
+	// edits made since the frame started
+	if (material->dirty)
+		this->updateUniformBlock();
+
+	const MaterialUniforms& uniforms = MaterialUniforms::get();
+	GLuint unit = baseUnit;
+	auto bindTextures = [&](const std::vector<GLuint>& textures, const Uniform* samplers) {
+		GLuint number = 0;
+		for (GLuint texture : textures) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+			glBindTexture(GL_TEXTURE_2D, texture);
+			if (number < MAX_MATERIAL_TEXTURES)
+				shader.setInt(samplers[number++], unit);
+			unit++;
+		}
+	};
+	bindTextures(material->textureAmbient, uniforms.textureAmbient);
+	bindTextures(material->textureDiffuse, uniforms.textureDiffuse);
+	bindTextures(material->textureSpecular, uniforms.textureSpecular);
+	bindTextures(material->textureNormal, uniforms.textureNormal);
+	bindTextures(material->textureReflect, uniforms.textureReflect);
+	checkGLError("MaterialManager::bind textures");
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, MATERIAL_UNIFORM_BLOCK_BINDING_POINT, this->ubo, (material->id - 1) * this->uboStride, MATERIAL_UNIFORM_BLOCK_SIZE);
+	checkGLError("MaterialManager::bind constants");
+	return unit - baseUnit;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+
+struct Material;
+class Shader;
+
+// std140 size of the MaterialConstants block, see material.frag
+#define MATERIAL_UNIFORM_BLOCK_SIZE 64
+// number of material slots the uniform buffer starts with, it doubles when it runs out
+#define MATERIAL_UNIFORM_BLOCK_INITIAL_CAPACITY 64
+
+///<summary>Process wide registry of deduplicated materials.
+///<para>Every registered material has a stable id and a slot in one uniform buffer holding the constants of all materials. Binding a material binds its textures and points the MaterialConstants block at its slot, so nothing is uploaded per draw.
+///Interned materials are shared and reference counted: every intern and acquire must be paired with a release, and the material is deleted and its slot reused when the last reference is released.
+///Interned materials must not be edited in place since other meshes may use them and their lookup hash would go stale. Edit a copy and intern it instead.</para>
+///</summary>
+class MaterialManager {
+	static const GLuint MATERIAL_UNIFORM_BLOCK_BINDING_POINT = 3;
+public:
+	static MaterialManager& get();
+
+	///<summary>Get the registered material equal to the given one, comparing constants and textures but not the name, or register a copy of it. Takes a reference for the caller.</summary>
+	Material* intern(const Material& material);
+	///<summary>Take another reference to an interned material.</summary>
+	Material* acquire(Material* material);
+	///<summary>Release a reference taken by intern or acquire. Deletes the material when no references are left.</summary>
+	void release(Material* material);
+	///<summary>Register a material without looking for duplicates. The manager takes ownership and keeps it for the life of the process. Does nothing if the material is already registered.</summary>
+	Material* add(Material* material);
+	///<summary>Flag the constants of a registered material for upload after it was edited.</summary>
+	void markDirty(Material* material);
+
+	///<summary>Upload the constants of every dirty material. Must be called on the thread that owns the OpenGL context, typically once per frame before rendering.</summary>
+	void updateUniformBlock();
+
+	///<summary>Bind the textures of a material, point the sampler uniforms at them and bind its constants.</summary>
+	///<param name="baseUnit">First texture unit the material may use.</param>
+	///<returns>Number of textures bound.</returns>
+	unsigned int bind(const Shader& shader, Material* material, GLuint baseUnit = 0);
+
+	size_t getMaterialCount() const { return this->materials.size() - this->freeIds.size(); }
+	static GLuint getBindingPoint() { return MATERIAL_UNIFORM_BLOCK_BINDING_POINT; }
+
+private:
+	MaterialManager() {}
+	MaterialManager(const MaterialManager&) = delete;
+	MaterialManager& operator=(const MaterialManager&) = delete;
+
+	///<summary>Registered materials, the material with id i is at i - 1. Released materials leave nullptr until their id is reused.</summary>
+	std::vector<Material*> materials;
+	std::vector<unsigned int> freeIds;
+	///<summary>first: hash of the material contents, second: the materials with that hash</summary>
+	std::unordered_multimap<size_t, Material*> lookup;
+	std::vector<Material*> dirtyMaterials;
+	GLuint ubo = 0;
+	GLuint uboCapacity = 0;
+	GLuint uboStride = 0;
+
+	static size_t hash(const Material& material);
+	static bool equal(const Material& a, const Material& b);
+	///<summary>Make room for every registered material in the uniform buffer, reuploading all of them if it had to grow.</summary>
+	void reserve();
+	void upload(const Material* material);
+};
@@ -0,0 +1,365 @@
+#include "MeshCache.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include "FileUtils.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+bool MeshCache::enabled = true;
+
+static const char meshCacheMagic[4] = { 'O', 'G', 'M', 'C' };
+
+struct MeshCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t flags;
+	uint32_t vertexSize;
+	int64_t sourceTime;
+	uint32_t meshCount;
+	uint32_t materialCount;
+};
+
+// mapped file
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other) {
+		this->close();
+		std::swap(this->data, other.data);
+		std::swap(this->size, other.size);
+#ifdef _WIN32
+		std::swap(this->fileHandle, other.fileHandle);
+		std::swap(this->mappingHandle, other.mappingHandle);
+#endif
+	}
+	return *this;
+}
+
+bool MappedFile::open(const std::string& path)
+{
+	this->close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) {
+		CloseHandle(file);
+		return false;
+	}
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == NULL) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	this->fileHandle = file;
+	this->mappingHandle = mapping;
+	this->data = (const uint8_t*)view;
+	this->size = (size_t)fileSize.QuadPart;
+#else
+	int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+	struct stat fileStat;
+	if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0) {
+		::close(file);
+		return false;
+	}
+	void* view = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	// the mapping keeps its own reference to the file
+	::close(file);
+	if (view == MAP_FAILED)
+		return false;
+	this->data = (const uint8_t*)view;
+	this->size = (size_t)fileStat.st_size;
+#endif
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (this->data == nullptr)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(this->data);
+	CloseHandle((HANDLE)this->mappingHandle);
+	CloseHandle((HANDLE)this->fileHandle);
+	this->mappingHandle = nullptr;
+	this->fileHandle = nullptr;
+#else
+	munmap((void*)this->data, this->size);
+#endif
+	this->data = nullptr;
+	this->size = 0;
+}
+
+// cache file reading and writing
+
+// every record in the file is padded to 4 bytes so the vertex and index arrays can be used in place
+static size_t padding(size_t size) { return (4 - (size & 3)) & 3; }
+
+class CacheReader {
+public:
+	CacheReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+	bool good() const { return this->ok; }
+
+	const void* read(size_t bytes) {
+		if (!this->ok || bytes > this->size - this->offset) {
+			this->ok = false;
+			return nullptr;
+		}
+		const void* ptr = this->data + this->offset;
+		this->offset += bytes;
+		this->offset += std::min(padding(bytes), this->size - this->offset);
+		return ptr;
+	}
+
+	template <typename T>
+	T read() {
+		T value{};
+		const void* ptr = this->read(sizeof(T));
+		if (ptr)
+			std::memcpy(&value, ptr, sizeof(T));
+		return value;
+	}
+
+	std::string readString() {
+		uint32_t length = this->read<uint32_t>();
+		const char* chars = (const char*)this->read(length);
+		return chars ? std::string(chars, length) : std::string();
+	}
+
+	std::vector<std::string> readStrings() {
+		std::vector<std::string> strings(this->read<uint32_t>());
+		for (std::string& string : strings) {
+			if (!this->ok)
+				break;
+			string = this->readString();
+		}
+		return strings;
+	}
+
+private:
+	const uint8_t* data;
+	size_t size;
+	size_t offset = 0;
+	bool ok = true;
+};
+
+class CacheWriter {
+public:
+	CacheWriter(std::ofstream& out) : out(out) {}
+
+	void write(const void* data, size_t bytes) {
+		static const char zeros[4] = { 0, 0, 0, 0 };
+		this->out.write((const char*)data, bytes);
+		this->out.write(zeros, padding(bytes));
+	}
+
+	template <typename T>
+	void write(const T& value) { this->write(&value, sizeof(T)); }
+
+	void writeString(const std::string& string) {
+		this->write((uint32_t)string.size());
+		this->write(string.data(), string.size());
+	}
+
+	void writeStrings(const std::vector<std::string>& strings) {
+		this->write((uint32_t)strings.size());
+		for (const std::string& string : strings) {
+			this->writeString(string);
+		}
+	}
+
+private:
+	std::ofstream& out;
+};
+
+std::string MeshCache::getCachePath(const std::string& path, unsigned int flags)
+{
+	// FNV-1a of the source path and flags names the entry
+	std::string key = FileUtils::getCanonicalPath(path) + "|" + std::to_string(flags);
+	uint64_t hash = FileUtils::hashString(key);
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.mesh", (unsigned long long)hash);
+	return std::string(MESH_CACHE_DIRECTORY) + "/" + name;
+}
+
+bool MeshCache::load(const std::string& path, unsigned int flags, ModelData& data)
+{
+	if (!MeshCache::enabled)
+		return false;
+
+	MappedFile file;
+	if (!file.open(MeshCache::getCachePath(path, flags)))
+		return false;
+
+	CacheReader reader(file.getData(), file.getSize());
+	MeshCacheHeader header = reader.read<MeshCacheHeader>();
+	if (!reader.good()
+		|| std::memcmp(header.magic, meshCacheMagic, sizeof(meshCacheMagic)) != 0
+		|| header.version != MESH_CACHE_VERSION
+		|| header.flags != flags
+		|| header.vertexSize != sizeof(VertexData)
+		|| header.sourceTime != FileUtils::getModifiedTime(path)
+		|| reader.readString() != FileUtils::getCanonicalPath(path)) {
+		return false;
+	}
+
+	std::vector<MaterialData> materials(header.materialCount);
+	for (MaterialData& material : materials) {
+		material.name = reader.readString();
+		material.ambientColor = reader.read<glm::vec4>();
+		material.diffuseColor = reader.read<glm::vec4>();
+		material.specularColor = reader.read<glm::vec4>();
+		material.shininess = reader.read<float>();
+		material.opacity = reader.read<float>();
+		material.reflectivity = reader.read<float>();
+		material.refractionIndex = reader.read<float>();
+		material.textureDiffuse = reader.readStrings();
+		material.textureSpecular = reader.readStrings();
+		material.textureNormal = reader.readStrings();
+		material.textureHeight = reader.readStrings();
+		if (!reader.good())
+			return false;
+	}
+
+	std::vector<MeshData> meshes(header.meshCount);
+	for (MeshData& mesh : meshes) {
+		mesh.name = reader.readString();
+		mesh.materialIndex = reader.read<uint32_t>();
+		mesh.vertexCount = reader.read<uint32_t>();
+		mesh.indexCount = reader.read<uint32_t>();
+		uint32_t lodCount = reader.read<uint32_t>();
+		if (!reader.good() || mesh.vertexCount > file.getSize() / sizeof(VertexData) || mesh.indexCount > file.getSize() / sizeof(GLuint) || lodCount > file.getSize() / sizeof(uint32_t))
+			return false;
+		const uint32_t* lodIndexCounts = (const uint32_t*)reader.read(lodCount * sizeof(uint32_t));
+		if (!reader.good())
+			return false;
+		mesh.lodIndexCounts.assign(lodIndexCounts, lodIndexCounts + lodCount);
+		// the levels have to cover the indices exactly
+		size_t lodIndexTotal = 0;
+		for (uint32_t count : mesh.lodIndexCounts)
+			lodIndexTotal += count;
+		if (lodCount > 0 && lodIndexTotal != mesh.indexCount)
+			return false;
+		uint32_t meshletCount = reader.read<uint32_t>();
+		if (!reader.good() || meshletCount > file.getSize() / sizeof(Meshlet))
+			return false;
+		const Meshlet* meshlets = (const Meshlet*)reader.read(meshletCount * sizeof(Meshlet));
+		if (!reader.good())
+			return false;
+		mesh.meshlets.assign(meshlets, meshlets + meshletCount);
+		// meshlets cover the full mesh only
+		size_t fullIndexCount = lodCount > 0 ? mesh.lodIndexCounts[0] : mesh.indexCount;
+		for (const Meshlet& meshlet : mesh.meshlets) {
+			if ((size_t)meshlet.firstIndex + meshlet.indexCount > fullIndexCount)
+				return false;
+		}
+		mesh.vertices = (const VertexData*)reader.read(mesh.vertexCount * sizeof(VertexData));
+		mesh.indices = (const GLuint*)reader.read(mesh.indexCount * sizeof(GLuint));
+		if (!reader.good() || mesh.materialIndex >= materials.size())
+			return false;
+	}
+
+	data.meshes = std::move(meshes);
+	data.materials = std::move(materials);
+	data.file = std::move(file);
+	return true;
+}
+
+bool MeshCache::save(const std::string& path, unsigned int flags, const ModelData& data)
+{
+	if (!MeshCache::enabled)
+		return false;
+
+	std::error_code error;
+	fs::create_directories(MESH_CACHE_DIRECTORY, error);
+	std::string cachePath = MeshCache::getCachePath(path, flags);
+	// write to a temporary file first so a crash never leaves a truncated entry behind
+	std::string tempPath = cachePath + ".tmp";
+	std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+	if (!out.is_open()) {
+		std::cerr << "ERROR::MESH_CACHE:: could not write " << tempPath << std::endl;
+		return false;
+	}
+
+	CacheWriter writer(out);
+	MeshCacheHeader header;
+	std::memcpy(header.magic, meshCacheMagic, sizeof(meshCacheMagic));
+	header.version = MESH_CACHE_VERSION;
+	header.flags = flags;
+	header.vertexSize = sizeof(VertexData);
+	header.sourceTime = FileUtils::getModifiedTime(path);
+	header.meshCount = (uint32_t)data.meshes.size();
+	header.materialCount = (uint32_t)data.materials.size();
+	writer.write(header);
+	writer.writeString(FileUtils::getCanonicalPath(path));
+
+	for (const MaterialData& material : data.materials) {
+		writer.writeString(material.name);
+		writer.write(material.ambientColor);
+		writer.write(material.diffuseColor);
+		writer.write(material.specularColor);
+		writer.write(material.shininess);
+		writer.write(material.opacity);
+		writer.write(material.reflectivity);
+		writer.write(material.refractionIndex);
+		writer.writeStrings(material.textureDiffuse);
+		writer.writeStrings(material.textureSpecular);
+		writer.writeStrings(material.textureNormal);
+		writer.writeStrings(material.textureHeight);
+	}
+
+	for (const MeshData& mesh : data.meshes) {
+		writer.writeString(mesh.name);
+		writer.write((uint32_t)mesh.materialIndex);
+		writer.write((uint32_t)mesh.vertexCount);
+		writer.write((uint32_t)mesh.indexCount);
+		writer.write((uint32_t)mesh.lodIndexCounts.size());
+		writer.write(mesh.lodIndexCounts.data(), mesh.lodIndexCounts.size() * sizeof(uint32_t));
+		writer.write((uint32_t)mesh.meshlets.size());
+		writer.write(mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Meshlet));
+		writer.write(mesh.vertices, mesh.vertexCount * sizeof(VertexData));
+		writer.write(mesh.indices, mesh.indexCount * sizeof(GLuint));
+	}
+
+	out.close();
+	if (out.fail()) {
+		std::cerr << "ERROR::MESH_CACHE:: failed writing " << tempPath << std::endl;
+		fs::remove(tempPath, error);
+		return false;
+	}
+	fs::rename(tempPath, cachePath, error);
+	if (error) {
+		std::cerr << "ERROR::MESH_CACHE:: could not replace " << cachePath << ": " << error.message() << std::endl;
+		fs::remove(tempPath, error);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "vertexData.h"
+#include "MeshletBuilder.h"
+
+// bump whenever the layout of the cache file or the processing done before caching changes
+#define MESH_CACHE_VERSION 4
+#define MESH_CACHE_DIRECTORY "cache/meshes"
+
+///<summary>A read only memory mapping of a whole file. Unmapped when destroyed.</summary>
+class MappedFile {
+public:
+	MappedFile() {}
+	~MappedFile() { this->close(); }
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	///<summary>Map the file at path. Returns false if the file could not be opened or is empty.</summary>
+	bool open(const std::string& path);
+	void close();
+
+	const uint8_t* getData() const { return this->data; }
+	size_t getSize() const { return this->size; }
+	bool isOpen() const { return this->data != nullptr; }
+
+private:
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
+
+///<summary>The coefficients and texture paths of a material as imported, before any textures are loaded.</summary>
+struct MaterialData {
+	std::string name = "default material";
+	glm::vec4 ambientColor = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
+	glm::vec4 diffuseColor = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
+	glm::vec4 specularColor = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
+	float shininess = 32.0f;
+	float opacity = 1.0f;
+	float reflectivity = 0.0f;
+	float refractionIndex = 1.0f;
+	// texture paths relative to the directory of the model
+	std::vector<std::string> textureDiffuse;
+	std::vector<std::string> textureSpecular;
+	std::vector<std::string> textureNormal;
+	std::vector<std::string> textureHeight;
+};
+
+///<summary>The processed vertices and indices of a single mesh.
+///<para>The pointers either reference the storage vectors, after an import, or point straight into a mapped cache file.
+///The indices hold every level of detail one after another, starting with the full mesh, and all levels index the same vertices.</para>
+///</summary>
+struct MeshData {
+	std::string name;
+	unsigned int materialIndex = 0;
+	const VertexData* vertices = nullptr;
+	size_t vertexCount = 0;
+	const GLuint* indices = nullptr;
+	size_t indexCount = 0;
+	// index count of every level of detail, empty if there is only the full mesh
+	std::vector<uint32_t> lodIndexCounts;
+	// meshlets of the full mesh, empty if it is culled as a whole
+	std::vector<Meshlet> meshlets;
+
+	MeshData() {}
+	MeshData(MeshData&&) = default;
+	MeshData& operator=(MeshData&&) = default;
+
+	///<summary>Take ownership of the vertices and indices and point at them.</summary>
+	void setStorage(std::vector<VertexData> vertices, std::vector<GLuint> indices, std::vector<uint32_t> lodIndexCounts = std::vector<uint32_t>()) {
+		this->lodIndexCounts = std::move(lodIndexCounts);
+		this->vertexStorage = std::move(vertices);
+		this->indexStorage = std::move(indices);
+		this->vertices = this->vertexStorage.data();
+		this->vertexCount = this->vertexStorage.size();
+		this->indices = this->indexStorage.data();
+		this->indexCount = this->indexStorage.size();
+	}
+
+	size_t getLodCount() const { return this->lodIndexCounts.empty() ? 1 : this->lodIndexCounts.size(); }
+
+private:
+	MeshData(const MeshData&) = delete;
+	MeshData& operator=(const MeshData&) = delete;
+
+	std::vector<VertexData> vertexStorage;
+	std::vector<GLuint> indexStorage;
+};
+
+///<summary>Everything needed to build a Model without running the importer.</summary>
+struct ModelData {
+	std::vector<MeshData> meshes;
+	std::vector<MaterialData> materials;
+	///<summary>The cache file the mesh data points into, if it was loaded from the cache.</summary>
+	MappedFile file;
+};
+
+///<summary>Binary cache of imported models, stored in MESH_CACHE_DIRECTORY.
+///<para>Entries are keyed on the source path, its modification time and the import flags, so editing a model or changing how it is imported invalidates its entry.</para>
+///</summary>
+class MeshCache {
+public:
+	///<summary>Map the cache entry of a model. The mesh data of data points into the mapping, which stays open for as long as data lives.</summary>
+	///<param name="path">Path of the source model file.</param>
+	///<param name="flags">Import flags the model was processed with.</param>
+	///<param name="data">Receives the cached meshes and materials.</param>
+	///<returns>false if there is no valid entry, in which case the model should be imported and saved.</returns>
+	static bool load(const std::string& path, unsigned int flags, ModelData& data);
+
+	///<summary>Write the processed meshes and materials of a model to the cache.</summary>
+	static bool save(const std::string& path, unsigned int flags, const ModelData& data);
+
+	///<summary>Get the path of the cache file for a model and import flags.</summary>
+	static std::string getCachePath(const std::string& path, unsigned int flags);
+
+	static bool isEnabled() { return MeshCache::enabled; }
+	static void setEnabled(bool enabled) { MeshCache::enabled = enabled; }
+
+private:
+	static bool enabled;
+};
@@ -0,0 +1,297 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <unordered_map>
+
+// weights of the vertex score from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+#define FORSYTH_CACHE_DECAY_POWER 1.5f
+#define FORSYTH_LAST_TRIANGLE_SCORE 0.75f
+#define FORSYTH_VALENCE_BOOST_SCALE 2.0f
+#define FORSYTH_VALENCE_BOOST_POWER 0.5f
+
+#define NO_TRIANGLE SIZE_MAX
+
+MeshOptimizerReport MeshOptimizer::optimize(std::vector<VertexData>& vertices, std::vector<GLuint>& indices)
+{
+	MeshOptimizerReport report;
+	report.verticesBefore = vertices.size();
+	report.before = MeshOptimizer::analyzeVertexCache(indices, vertices.size());
+
+	MeshOptimizer::weldVertices(vertices, indices);
+	MeshOptimizer::optimizeVertexCache(indices, vertices.size());
+	MeshOptimizer::optimizeOverdraw(indices, vertices);
+	MeshOptimizer::optimizeVertexFetch(vertices, indices);
+
+	report.verticesAfter = vertices.size();
+	report.after = MeshOptimizer::analyzeVertexCache(indices, vertices.size());
+	return report;
+}
+
+void MeshOptimizer::weldVertices(std::vector<VertexData>& vertices, std::vector<GLuint>& indices)
+{
+	// FNV-1a over the raw attributes, equal bits means an equal vertex
+	auto hash = [](const VertexData& vertex) {
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&vertex);
+		uint64_t value = 14695981039346656037ull;
+		for (size_t i = 0; i < sizeof(VertexData); i++) {
+			value ^= bytes[i];
+			value *= 1099511628211ull;
+		}
+		return (size_t)value;
+	};
+
+	std::vector<VertexData> welded;
+	welded.reserve(vertices.size());
+	std::vector<GLuint> remap(vertices.size());
+	std::unordered_multimap<size_t, GLuint> lookup;
+	lookup.reserve(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++) {
+		size_t key = hash(vertices[i]);
+		GLuint target = (GLuint)welded.size();
+		auto range = lookup.equal_range(key);
+		for (auto it = range.first; it != range.second; ++it) {
+			if (std::memcmp(&welded[it->second], &vertices[i], sizeof(VertexData)) == 0) {
+				target = it->second;
+				break;
+			}
+		}
+		if (target == welded.size()) {
+			lookup.emplace(key, target);
+			welded.push_back(vertices[i]);
+		}
+		remap[i] = target;
+	}
+
+	for (GLuint& index : indices)
+		index = remap[index];
+	vertices = std::move(welded);
+}
+
+// score of a vertex from its position in the LRU cache, or -1 if it is not cached, and the triangles still using it
+static float vertexScore(int cachePosition, unsigned int remaining)
+{
+	if (remaining == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		// the last triangle's vertices get a fixed score so the next triangle does not just reuse its edge
+		if (cachePosition < 3)
+			score = FORSYTH_LAST_TRIANGLE_SCORE;
+		else
+			score = std::pow(1.0f - (float)(cachePosition - 3) / (MESH_OPTIMIZER_SCORE_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+	}
+	// favour vertices with few triangles left so they are finished off and leave the cache for good
+	score += FORSYTH_VALENCE_BOOST_SCALE * std::pow((float)remaining, -FORSYTH_VALENCE_BOOST_POWER);
+	return score;
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<GLuint>& indices, size_t vertexCount)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// triangles using each vertex, the first remaining[v] entries of each range are the ones not emitted yet
+	std::vector<unsigned int> remaining(vertexCount, 0);
+	for (GLuint index : indices)
+		remaining[index]++;
+	std::vector<size_t> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + remaining[v];
+	std::vector<size_t> adjacency(indices.size());
+	{
+		std::vector<size_t> cursor(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+			adjacency[cursor[indices[i]]++] = i / 3;
+	}
+
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScores[v] = vertexScore(-1, remaining[v]);
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	size_t best = 0;
+	for (size_t t = 0; t < triangleCount; t++) {
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+		if (triangleScores[t] > triangleScores[best])
+			best = t;
+	}
+
+	std::vector<GLuint> output;
+	output.reserve(indices.size());
+	std::vector<GLuint> cache, nextCache;
+	cache.reserve(MESH_OPTIMIZER_SCORE_CACHE_SIZE + 3);
+	nextCache.reserve(MESH_OPTIMIZER_SCORE_CACHE_SIZE + 3);
+	size_t scanCursor = 0;
+	for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+		if (best == NO_TRIANGLE) {
+			// nothing in the cache has triangles left, continue with the next triangle in the original order
+			while (emitted[scanCursor])
+				scanCursor++;
+			best = scanCursor;
+		}
+
+		const GLuint* triangle = &indices[best * 3];
+		emitted[best] = 1;
+		output.insert(output.end(), triangle, triangle + 3);
+
+		// drop the triangle from the remaining lists of its vertices
+		for (int i = 0; i < 3; i++) {
+			GLuint v = triangle[i];
+			size_t* first = &adjacency[offsets[v]];
+			size_t* last = first + remaining[v] - 1;
+			*std::find(first, last + 1, best) = *last;
+			remaining[v]--;
+		}
+
+		// the vertices of the triangle move to the front of the cache
+		nextCache.assign(triangle, triangle + 3);
+		for (GLuint v : cache) {
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				nextCache.push_back(v);
+		}
+		for (size_t i = MESH_OPTIMIZER_SCORE_CACHE_SIZE; i < nextCache.size(); i++)
+			cachePositions[nextCache[i]] = -1;
+
+		// rescore every vertex that was or is cached along with the triangles that use them
+		best = NO_TRIANGLE;
+		float bestScore = -1.0f;
+		for (size_t i = 0; i < nextCache.size(); i++) {
+			GLuint v = nextCache[i];
+			int position = i < MESH_OPTIMIZER_SCORE_CACHE_SIZE ? (int)i : -1;
+			cachePositions[v] = position;
+			float score = vertexScore(position, remaining[v]);
+			float delta = score - vertexScores[v];
+			vertexScores[v] = score;
+			for (size_t j = offsets[v]; j < offsets[v] + remaining[v]; j++) {
+				size_t t = adjacency[j];
+				triangleScores[t] += delta;
+				if (i < MESH_OPTIMIZER_SCORE_CACHE_SIZE && triangleScores[t] > bestScore) {
+					bestScore = triangleScores[t];
+					best = t;
+				}
+			}
+		}
+		if (nextCache.size() > MESH_OPTIMIZER_SCORE_CACHE_SIZE)
+			nextCache.resize(MESH_OPTIMIZER_SCORE_CACHE_SIZE);
+		std::swap(cache, nextCache);
+	}
+	indices = std::move(output);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<GLuint>& indices, const std::vector<VertexData>& vertices)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// a triangle missing all of its vertices starts over with a cold cache, so moving it does not cost any reuse
+	std::vector<size_t> clusterStarts;
+	{
+		std::vector<uint32_t> cachedAt(vertices.size(), 0);
+		uint32_t time = MESH_OPTIMIZER_CACHE_SIZE + 1;
+		for (size_t t = 0; t < triangleCount; t++) {
+			int misses = 0;
+			for (int i = 0; i < 3; i++) {
+				GLuint v = indices[t * 3 + i];
+				if (time - cachedAt[v] > MESH_OPTIMIZER_CACHE_SIZE) {
+					cachedAt[v] = time++;
+					misses++;
+				}
+			}
+			if (t == 0 || misses == 3)
+				clusterStarts.push_back(t);
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+	size_t clusterCount = clusterStarts.size() - 1;
+	if (clusterCount < 2)
+		return;
+
+	// area weighted centroid and normal of each cluster and of the whole mesh
+	std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	for (size_t c = 0; c < clusterCount; c++) {
+		float clusterArea = 0.0f;
+		for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+			const glm::vec3& a = vertices[indices[t * 3]].Position;
+			const glm::vec3& b = vertices[indices[t * 3 + 1]].Position;
+			const glm::vec3& d = vertices[indices[t * 3 + 2]].Position;
+			glm::vec3 normal = glm::cross(b - a, d - a);
+			float area = glm::length(normal);
+			centroids[c] += (a + b + d) * (area / 3.0f);
+			normals[c] += normal;
+			clusterArea += area;
+		}
+		meshCentroid += centroids[c];
+		meshArea += clusterArea;
+		if (clusterArea > 0.0f)
+			centroids[c] /= clusterArea;
+	}
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	// clusters far out along their own normal are likely in front of the rest from wherever they are visible
+	std::vector<float> keys(clusterCount);
+	std::vector<size_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++) {
+		float length = glm::length(normals[c]);
+		keys[c] = length > 0.0f ? glm::dot(centroids[c] - meshCentroid, normals[c] / length) : 0.0f;
+		order[c] = c;
+	}
+	std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+	std::vector<GLuint> output;
+	output.reserve(indices.size());
+	for (size_t c : order)
+		output.insert(output.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+	indices = std::move(output);
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<VertexData>& vertices, std::vector<GLuint>& indices)
+{
+	const GLuint unused = 0xFFFFFFFFu;
+	std::vector<GLuint> remap(vertices.size(), unused);
+	std::vector<VertexData> ordered;
+	ordered.reserve(vertices.size());
+	for (GLuint& index : indices) {
+		if (remap[index] == unused) {
+			remap[index] = (GLuint)ordered.size();
+			ordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+	vertices = std::move(ordered);
+}
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(const std::vector<GLuint>& indices, size_t vertexCount)
+{
+	VertexCacheStats stats;
+	if (indices.empty())
+		return stats;
+
+	// a vertex is cached if fewer than the cache size misses happened since it was loaded
+	std::vector<uint32_t> cachedAt(vertexCount, 0);
+	std::vector<uint8_t> referenced(vertexCount, 0);
+	uint32_t time = MESH_OPTIMIZER_CACHE_SIZE + 1;
+	size_t misses = 0, referencedCount = 0;
+	for (GLuint index : indices) {
+		if (time - cachedAt[index] > MESH_OPTIMIZER_CACHE_SIZE) {
+			cachedAt[index] = time++;
+			misses++;
+		}
+		if (!referenced[index]) {
+			referenced[index] = 1;
+			referencedCount++;
+		}
+	}
+	stats.acmr = (float)misses / (float)(indices.size() / 3);
+	stats.atvr = (float)misses / (float)referencedCount;
+	return stats;
+}
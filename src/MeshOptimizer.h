@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glad/glad.h>
+#include "vertexData.h"
+
+// size of the FIFO post transform cache the statistics are measured against
+#define MESH_OPTIMIZER_CACHE_SIZE 16
+// size of the LRU cache the vertex cache optimization scores vertices with
+#define MESH_OPTIMIZER_SCORE_CACHE_SIZE 32
+
+///<summary>Post transform cache statistics of an index buffer.</summary>
+struct VertexCacheStats {
+	///<summary>Average cache misses per triangle. 0.5 is about the best a regular grid can do, 3 means no reuse at all.</summary>
+	float acmr = 0.0f;
+	///<summary>Average cache misses per referenced vertex. 1 is optimal.</summary>
+	float atvr = 0.0f;
+};
+
+///<summary>What MeshOptimizer::optimize did to a mesh.</summary>
+struct MeshOptimizerReport {
+	size_t verticesBefore = 0;
+	size_t verticesAfter = 0;
+	VertexCacheStats before;
+	VertexCacheStats after;
+};
+
+///<summary>Import time reordering of triangle meshes so the GPU transforms fewer vertices and fetches them more linearly.
+///<para>Indices must be a triangle list. Every function keeps the set of triangles and their winding, only their order and the vertex order change.</para>
+///</summary>
+class MeshOptimizer {
+public:
+	///<summary>Run every stage: weld, vertex cache, overdraw and vertex fetch, in that order.</summary>
+	static MeshOptimizerReport optimize(std::vector<VertexData>& vertices, std::vector<GLuint>& indices);
+
+	///<summary>Merge vertices whose attributes are bit for bit equal.</summary>
+	static void weldVertices(std::vector<VertexData>& vertices, std::vector<GLuint>& indices);
+	///<summary>Reorder triangles for the post transform cache with Tom Forsyth's linear speed algorithm.</summary>
+	static void optimizeVertexCache(std::vector<GLuint>& indices, size_t vertexCount);
+	///<summary>Split a cache optimized index buffer into clusters where the cache starts over anyway, and draw the outward facing clusters first
+	///so more of the mesh is rejected by the depth test.</summary>
+	static void optimizeOverdraw(std::vector<GLuint>& indices, const std::vector<VertexData>& vertices);
+	///<summary>Reorder vertices by first use in the index buffer and drop unreferenced ones.</summary>
+	static void optimizeVertexFetch(std::vector<VertexData>& vertices, std::vector<GLuint>& indices);
+
+	///<summary>Simulate a FIFO cache of MESH_OPTIMIZER_CACHE_SIZE vertices over the index buffer.</summary>
+	static VertexCacheStats analyzeVertexCache(const std::vector<GLuint>& indices, size_t vertexCount);
+};
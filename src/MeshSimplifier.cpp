@@ -0,0 +1,271 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include "MeshOptimizer.h"
+
+// cosine of the largest angle a collapse may turn a remaining triangle by
+#define MESH_SIMPLIFY_MIN_NORMAL_COS 0.5f
+
+///<summary>Weighted sum of the squared distances to a set of planes, as the upper triangle of a symmetric 4x4 matrix.</summary>
+struct Quadric {
+	double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+	double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+	double a22 = 0.0, a23 = 0.0;
+	double a33 = 0.0;
+	///<summary>Sum of the weights of the planes.</summary>
+	double weight = 0.0;
+
+	///<summary>Add the plane dot(normal, p) + distance = 0.</summary>
+	void addPlane(const glm::vec3& normal, float distance, float weight) {
+		double x = normal.x, y = normal.y, z = normal.z, w = distance;
+		this->a00 += weight * x * x; this->a01 += weight * x * y; this->a02 += weight * x * z; this->a03 += weight * x * w;
+		this->a11 += weight * y * y; this->a12 += weight * y * z; this->a13 += weight * y * w;
+		this->a22 += weight * z * z; this->a23 += weight * z * w;
+		this->a33 += weight * w * w;
+		this->weight += weight;
+	}
+
+	void add(const Quadric& other) {
+		this->a00 += other.a00; this->a01 += other.a01; this->a02 += other.a02; this->a03 += other.a03;
+		this->a11 += other.a11; this->a12 += other.a12; this->a13 += other.a13;
+		this->a22 += other.a22; this->a23 += other.a23;
+		this->a33 += other.a33;
+		this->weight += other.weight;
+	}
+
+	///<summary>The weighted average of the squared distances of the point to the planes, so the weights only decide which planes matter most.</summary>
+	double evaluate(const glm::vec3& point) const {
+		double x = point.x, y = point.y, z = point.z;
+		double error = this->a00 * x * x + 2.0 * this->a01 * x * y + 2.0 * this->a02 * x * z + 2.0 * this->a03 * x
+			+ this->a11 * y * y + 2.0 * this->a12 * y * z + 2.0 * this->a13 * y
+			+ this->a22 * z * z + 2.0 * this->a23 * z
+			+ this->a33;
+		if (this->weight <= 0.0)
+			return 0.0;
+		// rounding can take a point on every plane slightly below zero
+		return std::max(error / this->weight, 0.0);
+	}
+};
+
+///<summary>Moving a vertex onto a neighbour, removing the triangles on the edge between them.</summary>
+struct Collapse {
+	GLuint from;
+	GLuint to;
+	double cost;
+};
+
+///<summary>Map every vertex to the first vertex with the same position.</summary>
+static std::vector<GLuint> buildPositionRemap(const std::vector<VertexData>& vertices)
+{
+	std::vector<GLuint> order(vertices.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = (GLuint)i;
+	std::sort(order.begin(), order.end(), [&vertices](GLuint a, GLuint b) {
+		const glm::vec3& p = vertices[a].Position;
+		const glm::vec3& q = vertices[b].Position;
+		if (p.x != q.x)
+			return p.x < q.x;
+		if (p.y != q.y)
+			return p.y < q.y;
+		return p.z < q.z;
+	});
+
+	std::vector<GLuint> remap(vertices.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		bool same = i > 0 && vertices[order[i]].Position == vertices[order[i - 1]].Position;
+		remap[order[i]] = same ? remap[order[i - 1]] : order[i];
+	}
+	return remap;
+}
+
+///<summary>Flag the vertices that must not move: seams, where a position has several vertices, and borders, edges that do not have exactly two triangles.</summary>
+static std::vector<uint8_t> findLockedVertices(const std::vector<GLuint>& positionRemap, const std::vector<GLuint>& indices)
+{
+	std::vector<uint8_t> locked(positionRemap.size(), 0);
+	std::vector<uint32_t> positionUses(positionRemap.size(), 0);
+	for (size_t i = 0; i < positionRemap.size(); i++)
+		positionUses[positionRemap[i]]++;
+	for (size_t i = 0; i < positionRemap.size(); i++)
+		locked[i] = positionUses[positionRemap[i]] > 1;
+
+	// count edges between positions, so a seam is not mistaken for a border
+	auto edgeKey = [&positionRemap](GLuint a, GLuint b) {
+		GLuint pa = positionRemap[a], pb = positionRemap[b];
+		return pa < pb ? ((uint64_t)pa << 32) | pb : ((uint64_t)pb << 32) | pa;
+	};
+	std::unordered_map<uint64_t, uint32_t> edgeUses;
+	edgeUses.reserve(indices.size());
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		for (int k = 0; k < 3; k++)
+			edgeUses[edgeKey(indices[i + k], indices[i + (k + 1) % 3])]++;
+	}
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		for (int k = 0; k < 3; k++) {
+			GLuint a = indices[i + k], b = indices[i + (k + 1) % 3];
+			if (edgeUses[edgeKey(a, b)] != 2) {
+				locked[a] = 1;
+				locked[b] = 1;
+			}
+		}
+	}
+	return locked;
+}
+
+std::vector<GLuint> MeshSimplifier::simplify(const std::vector<VertexData>& vertices, const std::vector<GLuint>& indices, size_t targetIndexCount, float targetError, float* resultError)
+{
+	std::vector<GLuint> result = indices;
+	if (resultError != nullptr)
+		*resultError = 0.0f;
+	size_t vertexCount = vertices.size();
+	if (result.size() <= targetIndexCount || vertexCount == 0)
+		return result;
+
+	glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+	for (const VertexData& vertex : vertices) {
+		min = glm::min(min, vertex.Position);
+		max = glm::max(max, vertex.Position);
+	}
+	float extent = std::max(max.x - min.x, std::max(max.y - min.y, max.z - min.z));
+	if (extent <= 0.0f)
+		return result;
+	// quadrics measure average squared distances
+	double errorLimit = (double)targetError * extent;
+	errorLimit *= errorLimit;
+
+	std::vector<uint8_t> locked = findLockedVertices(buildPositionRemap(vertices), result);
+
+	// area weighted planes of the triangles around every vertex
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < result.size(); i += 3) {
+		const glm::vec3& p0 = vertices[result[i]].Position;
+		glm::vec3 normal = glm::cross(vertices[result[i + 1]].Position - p0, vertices[result[i + 2]].Position - p0);
+		float length = glm::length(normal);
+		if (length <= 0.0f)
+			continue;
+		normal /= length;
+		float distance = -glm::dot(normal, p0);
+		for (int k = 0; k < 3; k++)
+			quadrics[result[i + k]].addPlane(normal, distance, length * 0.5f);
+	}
+
+	std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+	std::vector<uint32_t> triangleCursor(vertexCount);
+	std::vector<uint32_t> vertexTriangles;
+	std::vector<Collapse> collapses;
+	std::vector<uint8_t> touched(vertexCount);
+	std::vector<GLuint> remap(vertexCount);
+	double largestError = 0.0;
+
+	// whether moving from onto to turns a remaining triangle too far or makes it degenerate
+	auto flips = [&](GLuint from, GLuint to) {
+		const glm::vec3& target = vertices[to].Position;
+		for (uint32_t i = triangleOffsets[from]; i < triangleOffsets[from + 1]; i++) {
+			const GLuint* triangle = &result[vertexTriangles[i] * 3];
+			if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+				continue;
+			glm::vec3 before[3], after[3];
+			for (int k = 0; k < 3; k++) {
+				before[k] = vertices[triangle[k]].Position;
+				after[k] = triangle[k] == from ? target : before[k];
+			}
+			glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+			glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+			// also refuse steep turns, a few of them in a row would flip the triangle over several passes
+			if (glm::dot(normalBefore, normalAfter) <= MESH_SIMPLIFY_MIN_NORMAL_COS * glm::length(normalBefore) * glm::length(normalAfter))
+				return true;
+		}
+		return false;
+	};
+
+	// collapse a batch of independent edges per pass, cheapest first
+	while (result.size() > targetIndexCount) {
+		size_t triangleCount = result.size() / 3;
+
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (GLuint index : result)
+			triangleOffsets[index + 1]++;
+		for (size_t i = 0; i < vertexCount; i++)
+			triangleOffsets[i + 1] += triangleOffsets[i];
+		std::copy(triangleOffsets.begin(), triangleOffsets.end() - 1, triangleCursor.begin());
+		vertexTriangles.resize(result.size());
+		for (size_t i = 0; i < result.size(); i++)
+			vertexTriangles[triangleCursor[result[i]]++] = (uint32_t)(i / 3);
+
+		// an inner edge appears once in each direction on its two triangles, so both ways are considered
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (int k = 0; k < 3; k++) {
+				GLuint from = result[i + k], to = result[i + (k + 1) % 3];
+				if (locked[from])
+					continue;
+				Quadric quadric = quadrics[from];
+				quadric.add(quadrics[to]);
+				double cost = quadric.evaluate(vertices[to].Position);
+				if (cost <= errorLimit)
+					collapses.push_back({ from, to, cost });
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		// every collapse removes about two triangles, stop the pass before overshooting the target
+		size_t collapseLimit = (triangleCount - targetIndexCount / 3) / 2 + 1;
+		std::fill(touched.begin(), touched.end(), 0);
+		for (size_t i = 0; i < vertexCount; i++)
+			remap[i] = (GLuint)i;
+		size_t collapsed = 0;
+		for (const Collapse& collapse : collapses) {
+			if (touched[collapse.from] || touched[collapse.to] || flips(collapse.from, collapse.to))
+				continue;
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			// the triangles around the removed vertex changed, leave their vertices for the next pass
+			for (uint32_t i = triangleOffsets[collapse.from]; i < triangleOffsets[collapse.from + 1]; i++) {
+				const GLuint* triangle = &result[vertexTriangles[i] * 3];
+				touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+			}
+			largestError = std::max(largestError, collapse.cost);
+			if (++collapsed >= collapseLimit)
+				break;
+		}
+		if (collapsed == 0)
+			break;
+
+		// apply the pass and drop the triangles that lost their area
+		size_t kept = 0;
+		for (size_t i = 0; i < result.size(); i += 3) {
+			GLuint a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+			result[kept++] = a;
+			result[kept++] = b;
+			result[kept++] = c;
+		}
+		result.resize(kept);
+	}
+
+	if (resultError != nullptr)
+		*resultError = (float)(std::sqrt(largestError) / extent);
+	return result;
+}
+
+std::vector<std::vector<GLuint>> MeshSimplifier::buildLodChain(const std::vector<VertexData>& vertices, const std::vector<GLuint>& indices)
+{
+	std::vector<std::vector<GLuint>> lods;
+	lods.push_back(indices);
+	if (indices.size() / 3 < MESH_LOD_MIN_TRIANGLES)
+		return lods;
+
+	while (lods.size() < MESH_LOD_MAX_LEVELS) {
+		const std::vector<GLuint>& previous = lods.back();
+		size_t targetIndexCount = (size_t)(previous.size() / 3 * MESH_LOD_RATIO) * 3;
+		std::vector<GLuint> level = MeshSimplifier::simplify(vertices, previous, targetIndexCount, MESH_LOD_MAX_ERROR);
+		if (level.size() > previous.size() * MESH_LOD_MIN_REDUCTION)
+			break;
+		MeshOptimizer::optimizeVertexCache(level, vertices.size());
+		lods.push_back(std::move(level));
+	}
+	return lods;
+}
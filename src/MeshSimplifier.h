@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glad/glad.h>
+#include "vertexData.h"
+
+// levels of detail generated per mesh, including the full mesh
+#define MESH_LOD_MAX_LEVELS 4
+// fraction of the triangles of the previous level each level aims for
+#define MESH_LOD_RATIO 0.5f
+// largest distance a level may move the surface, relative to the size of the mesh
+#define MESH_LOD_MAX_ERROR 0.02f
+// a level that keeps more than this fraction of the triangles of the previous one is not worth its indices, the chain ends there
+#define MESH_LOD_MIN_REDUCTION 0.85f
+// meshes with fewer triangles get no levels of detail
+#define MESH_LOD_MIN_TRIANGLES 256
+
+///<summary>Import time simplification of triangle meshes into levels of detail.
+///<para>Simplification only writes new indices into the existing vertices, so every level of a mesh shares one vertex buffer.
+///Edges are collapsed into one of their vertices in order of their quadric error. Vertices on a border of the mesh and on a seam, where vertices share a position but differ in another attribute, are never moved,
+///which keeps the outline and the texture mapping intact at the cost of a less aggressive reduction of heavily split meshes.</para>
+///</summary>
+class MeshSimplifier {
+public:
+	///<summary>Collapse edges until the index count drops to the target or the next collapse would move the surface further than the error.</summary>
+	///<param name="targetError">Largest error relative to the size of the mesh.</param>
+	///<param name="resultError">Optional, receives the largest error of a collapse that was made, relative to the size of the mesh.</param>
+	static std::vector<GLuint> simplify(const std::vector<VertexData>& vertices, const std::vector<GLuint>& indices, size_t targetIndexCount, float targetError, float* resultError = nullptr);
+
+	///<summary>Build the level of detail chain of a mesh, each level simplified from the one before it and optimized for the vertex cache.</summary>
+	///<returns>The index lists of the levels, the first one being the indices that were passed in.</returns>
+	static std::vector<std::vector<GLuint>> buildLodChain(const std::vector<VertexData>& vertices, const std::vector<GLuint>& indices);
+};
@@ -0,0 +1,85 @@
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "Bounds.h"
+
+///<summary>Fill in the bounding sphere and normal cone of a meshlet from its triangles.</summary>
+static void computeMeshletBounds(Meshlet& meshlet, const std::vector<VertexData>& vertices, const GLuint* indices, std::vector<glm::vec3>& points)
+{
+	points.clear();
+	for (GLuint i = 0; i < meshlet.indexCount; i++)
+		points.push_back(vertices[indices[meshlet.firstIndex + i]].Position);
+	Bounds bounds = Bounds::fromPoints(points.data(), points.size(), sizeof(glm::vec3));
+	meshlet.sphere = glm::vec4(bounds.sphere.center, bounds.sphere.radius);
+
+	// the cone axis is the average of the face normals, its cutoff the sine of the largest angle a face makes with it
+	std::vector<glm::vec3> normals;
+	glm::vec3 axis(0.0f);
+	for (GLuint i = 0; i < meshlet.indexCount; i += 3) {
+		glm::vec3 normal = glm::cross(points[i + 1] - points[i], points[i + 2] - points[i]);
+		float length = glm::length(normal);
+		if (length <= 0.0f)
+			continue;
+		normal /= length;
+		normals.push_back(normal);
+		axis += normal;
+	}
+	meshlet.cone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	float axisLength = glm::length(axis);
+	if (normals.empty() || axisLength <= 0.0f)
+		return;
+	axis /= axisLength;
+	float minSpread = 1.0f;
+	for (const glm::vec3& normal : normals)
+		minSpread = std::min(minSpread, glm::dot(axis, normal));
+	if (minSpread <= MESHLET_CONE_MIN_SPREAD)
+		return;
+	meshlet.cone = glm::vec4(axis, std::sqrt(1.0f - minSpread * minSpread));
+}
+
+std::vector<Meshlet> MeshletBuilder::build(const std::vector<VertexData>& vertices, const GLuint* indices, size_t indexCount)
+{
+	std::vector<Meshlet> meshlets;
+	if (indexCount / 3 < MESHLET_MIN_MESH_TRIANGLES)
+		return meshlets;
+
+	// the meshlet each vertex was last counted in, so unique vertices are counted without clearing a set per meshlet
+	std::vector<uint32_t> vertexMeshlet(vertices.size(), UINT32_MAX);
+	auto countNewVertices = [&](size_t triangle, uint32_t current) {
+		size_t count = 0;
+		for (int k = 0; k < 3; k++) {
+			// a triangle that repeats a vertex counts it once
+			bool repeated = (k > 0 && indices[triangle + k] == indices[triangle]) || (k > 1 && indices[triangle + k] == indices[triangle + 1]);
+			if (vertexMeshlet[indices[triangle + k]] != current && !repeated)
+				count++;
+		}
+		return count;
+	};
+
+	std::vector<glm::vec3> points;
+	Meshlet meshlet = {};
+	size_t meshletVertices = 0;
+	for (size_t i = 0; i + 2 < indexCount; i += 3) {
+		uint32_t current = (uint32_t)meshlets.size();
+		size_t newVertices = countNewVertices(i, current);
+		if (meshlet.indexCount > 0 && (meshletVertices + newVertices > MESHLET_MAX_VERTICES || meshlet.indexCount / 3 >= MESHLET_MAX_TRIANGLES)) {
+			computeMeshletBounds(meshlet, vertices, indices, points);
+			meshlets.push_back(meshlet);
+			meshlet = {};
+			meshlet.firstIndex = (GLuint)i;
+			meshletVertices = 0;
+			current++;
+			newVertices = countNewVertices(i, current);
+		}
+		for (int k = 0; k < 3; k++)
+			vertexMeshlet[indices[i + k]] = current;
+		meshletVertices += newVertices;
+		meshlet.indexCount += 3;
+	}
+	if (meshlet.indexCount > 0) {
+		computeMeshletBounds(meshlet, vertices, indices, points);
+		meshlets.push_back(meshlet);
+	}
+	return meshlets;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "vertexData.h"
+
+// limits of a single meshlet, small enough that its bounds and normal cone stay tight
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+// meshes with fewer triangles fit in one meshlet and are culled as a whole
+#define MESHLET_MIN_MESH_TRIANGLES (MESHLET_MAX_TRIANGLES * 2)
+// meshlets whose normals spread further than this from the cone axis, as a cosine, are never back face culled
+#define MESHLET_CONE_MIN_SPREAD 0.1f
+
+///<summary>A run of consecutive triangles of a mesh with the bounds the culling compute shader tests. Laid out for std430.</summary>
+struct Meshlet {
+	///<summary>Object space bounding sphere as (center, radius).</summary>
+	glm::vec4 sphere;
+	///<summary>Object space normal cone as (axis, cutoff). The meshlet faces away from every point in the sphere where dot(center - eye, axis) >= cutoff * length(center - eye) + radius. A cutoff of 1 disables the test.</summary>
+	glm::vec4 cone;
+	///<summary>First index of the meshlet, relative to the mesh until the GeometryArena makes it absolute.</summary>
+	GLuint firstIndex;
+	GLuint indexCount;
+	GLuint padding[2];
+};
+
+///<summary>Import time partition of a mesh into meshlets for per meshlet culling.
+///<para>Meshlets are cut from the index list in order, so each one is a contiguous index range that the mesh already draws and no indices are rewritten.
+///The indices should be optimized for the vertex cache first, which keeps neighbouring triangles together and the meshlets compact.</para>
+///</summary>
+class MeshletBuilder {
+public:
+	///<summary>Split the triangles into meshlets of at most MESHLET_MAX_VERTICES unique vertices and MESHLET_MAX_TRIANGLES triangles.</summary>
+	///<returns>The meshlets in index order, empty for meshes with fewer than MESHLET_MIN_MESH_TRIANGLES triangles.</returns>
+	static std::vector<Meshlet> build(const std::vector<VertexData>& vertices, const GLuint* indices, size_t indexCount);
+};
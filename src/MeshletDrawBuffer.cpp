@@ -0,0 +1,105 @@
+#include "MeshletDrawBuffer.h"
+#include <algorithm>
+#include "glHelper.h"
+#include "shader.h"
+#include "Frustum.h"
+#include "HiZBuffer.h"
+#include "IndirectDrawBuffer.h"
+
+///<summary>Grow a buffer to hold at least the given number of elements. The old contents are dropped.</summary>
+static void reserveBuffer(GLenum target, GLuint& buffer, size_t& capacity, size_t count, size_t elementSize, GLenum usage)
+{
+	if (buffer == 0)
+		glGenBuffers(1, &buffer);
+	glBindBuffer(target, buffer);
+	if (count > capacity) {
+		capacity = std::max(count, capacity * 2);
+		glBufferData(target, capacity * elementSize, NULL, usage);
+	}
+	glBindBuffer(target, 0);
+}
+
+void MeshletDrawBuffer::clear()
+{
+	this->draws.clear();
+	this->batches.clear();
+	this->meshletCount = 0;
+}
+
+void MeshletDrawBuffer::add(const GeometryRange& geometry, GLuint drawIndex, Material* material)
+{
+	if (!geometry.hasMeshlets())
+		return;
+	if (this->batches.empty() || this->batches.back().material != material)
+		this->batches.push_back({ material, (GLuint)this->meshletCount, 0 });
+	this->batches.back().maxCommands += geometry.meshletCount;
+
+	MeshletDraw draw;
+	draw.positionScale = glm::vec4(geometry.positionScale, 0.0f);
+	draw.positionOffset = glm::vec4(geometry.positionOffset, 0.0f);
+	draw.firstMeshlet = geometry.firstMeshlet;
+	draw.meshletCount = (GLuint)geometry.meshletCount;
+	draw.baseInstance = drawIndex & INDIRECT_DRAW_INDEX_MASK;
+	draw.baseVertex = geometry.baseVertex;
+	draw.batch = (GLuint)(this->batches.size() - 1);
+	draw.firstCommand = this->batches.back().firstCommand;
+	draw.padding[0] = draw.padding[1] = 0;
+	this->draws.push_back(draw);
+	this->meshletCount += geometry.meshletCount;
+}
+
+void MeshletDrawBuffer::upload()
+{
+	if (this->draws.empty())
+		return;
+	reserveBuffer(GL_SHADER_STORAGE_BUFFER, this->drawBuffer, this->drawCapacity, this->draws.size(), sizeof(MeshletDraw), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->drawBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, this->draws.size() * sizeof(MeshletDraw), this->draws.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	// every meshlet may survive, the commands and counts are written on the GPU
+	reserveBuffer(GL_DRAW_INDIRECT_BUFFER, this->commandBuffer, this->commandCapacity, this->meshletCount, sizeof(DrawElementsIndirectCommand), GL_DYNAMIC_COPY);
+	reserveBuffer(GL_PARAMETER_BUFFER, this->countBuffer, this->countCapacity, this->batches.size(), sizeof(GLuint), GL_DYNAMIC_COPY);
+	checkGLError("MeshletDrawBuffer::upload");
+}
+
+void MeshletDrawBuffer::cull(const Shader& cullShader, const Frustum& frustum, const glm::vec3& eye, const HiZBuffer* hiZ)
+{
+	if (this->draws.empty())
+		return;
+	static const Uniform planesUniform("planes");
+	static const Uniform eyeUniform("eye");
+	cullShader.Use();
+	// the planes are stored consecutively
+	glUniform4fv(cullShader.getUniformLocation(planesUniform), Frustum::PLANE_COUNT, &frustum.getPlane(Frustum::PLANE_LEFT)[0]);
+	cullShader.setVec3(eyeUniform, eye);
+	HiZBuffer::bindForCulling(cullShader, hiZ);
+
+	// the counters of every batch start at zero and are the draw counts afterwards
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->countBuffer);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, IndirectDrawBuffer::COMMAND_BINDING_POINT, this->commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESHLET_BINDING_POINT, GeometryArena::get().getMeshletBuffer());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESHLET_DRAW_BINDING_POINT, this->drawBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNT_BINDING_POINT, this->countBuffer);
+	glDispatchCompute((GLuint)this->draws.size(), 1, 1);
+	// the draws read the commands and counts written by the compute shader
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+	checkGLError("MeshletDrawBuffer::cull");
+}
+
+void MeshletDrawBuffer::bind(GLuint vertexArray) const
+{
+	glBindVertexArray(vertexArray);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->commandBuffer);
+	glBindBuffer(GL_PARAMETER_BUFFER, this->countBuffer);
+}
+
+void MeshletDrawBuffer::draw(size_t batch) const
+{
+	const MeshletBatch& meshletBatch = this->batches[batch];
+	glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)(meshletBatch.firstCommand * sizeof(DrawElementsIndirectCommand)),
+		(GLintptr)(batch * sizeof(GLuint)), meshletBatch.maxCommands, 0);
+	checkGLError("MeshletDrawBuffer::draw");
+}
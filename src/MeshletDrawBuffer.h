@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "GeometryArena.h"
+
+struct Material;
+class Shader;
+class Frustum;
+class HiZBuffer;
+
+// local size of meshletCull.comp, one work group culls the meshlets of one mesh
+#define MESHLET_CULL_GROUP_SIZE 64
+
+///<summary>A mesh whose meshlets are culled, read by meshletCull.comp. Laid out for std430.</summary>
+struct MeshletDraw {
+	///<summary>Position decode of the mesh. The DrawData model includes it and the meshlet bounds do not, so the shader takes it back out.</summary>
+	glm::vec4 positionScale;
+	glm::vec4 positionOffset;
+	GLuint firstMeshlet;
+	GLuint meshletCount;
+	///<summary>Base instance of the commands written for the meshlets, selecting the DrawData of the mesh.</summary>
+	GLuint baseInstance;
+	GLint baseVertex;
+	///<summary>Batch the surviving meshlets are appended to.</summary>
+	GLuint batch;
+	GLuint firstCommand;
+	GLuint padding[2];
+};
+
+///<summary>Consecutive meshes that share a material. Their surviving meshlets are compacted into one range of commands, drawn by a single glMultiDrawElementsIndirectCount.</summary>
+struct MeshletBatch {
+	Material* material;
+	GLuint firstCommand;
+	///<summary>Meshlets of all meshes of the batch, the most commands the culling can write.</summary>
+	GLsizei maxCommands;
+};
+
+///<summary>Draws meshes of the GeometryArena meshlet by meshlet, culling every meshlet on the GPU first.
+///<para>The culling compute shader tests each meshlet against the frustum, its normal cone against the eye and optionally its sphere against the Hi-Z pyramid of the last frame.
+///Surviving meshlets are appended to the command range of their batch with an atomic counter, and the counters are the draw counts of the multi draws, so nothing is read back.
+///Only the full level of detail of a mesh has meshlets. Buffers are created on the first upload and grow when needed.</para>
+///</summary>
+class MeshletDrawBuffer {
+public:
+	///<summary>Shader storage bindings, following the light clusters.</summary>
+	static const GLuint MESHLET_BINDING_POINT = 5;
+	static const GLuint MESHLET_DRAW_BINDING_POINT = 6;
+	static const GLuint COUNT_BINDING_POINT = 7;
+
+	void clear();
+	///<summary>Append the meshlets of a mesh.</summary>
+	///<param name="geometry">The full level of detail of the mesh, which must have meshlets.</param>
+	///<param name="drawIndex">Index of the DrawData of the mesh.</param>
+	///<param name="material">Material of the mesh. A new batch starts whenever it changes.</param>
+	void add(const GeometryRange& geometry, GLuint drawIndex, Material* material);
+	///<summary>Upload the meshes and make room for the commands. Must be called before cull.</summary>
+	void upload();
+	///<summary>Run the culling compute shader, writing the commands and draw counts of every batch. The DrawData must be bound.</summary>
+	///<param name="eye">World space position the back faces are culled for.</param>
+	///<param name="hiZ">Optional depth pyramid of the last frame. Meshlets whose sphere is behind it are culled as well.</param>
+	void cull(const Shader& cullShader, const Frustum& frustum, const glm::vec3& eye, const HiZBuffer* hiZ = nullptr);
+	///<summary>Bind a vertex array of the arena and the command and count buffers for the draws.</summary>
+	void bind(GLuint vertexArray) const;
+	///<summary>Issue the surviving meshlets of a batch. The buffers must be bound and the shader in use.</summary>
+	void draw(size_t batch) const;
+
+	bool isEmpty() const { return this->draws.empty(); }
+	///<summary>Meshlets submitted to the culling, before any are culled.</summary>
+	size_t getMeshletCount() const { return this->meshletCount; }
+	const std::vector<MeshletBatch>& getBatches() const { return this->batches; }
+
+private:
+	std::vector<MeshletDraw> draws;
+	std::vector<MeshletBatch> batches;
+	size_t meshletCount = 0;
+	GLuint drawBuffer = 0;
+	size_t drawCapacity = 0;
+	// written by the culling shader only
+	GLuint commandBuffer = 0;
+	size_t commandCapacity = 0;
+	GLuint countBuffer = 0;
+	size_t countCapacity = 0;
+};
@@ -1,4 +1,5 @@
 #include "Scene.h"
+#include <algorithm>
 
 Scene::Scene() :
 	up(0.0, 1.0, 0.0),
@@ -8,10 +9,12 @@ Scene::Scene() :
 LightManager* Scene::getLightManager() const { return this->lightManager; }
 void Scene::setLightManager(LightManager* lightManager) { this->lightManager = lightManager; }
 
-std::map<std::string, Model*> Scene::getModels() { return this->models; }
 void Scene::setModels(std::map<std::string, Model*> models) { 
 	this->models = models; 
+	this->renderList.clear();
+	this->renderListIndex.clear();
 	for (auto it : models) {
+		this->addRenderEntry(it.second);
 		if (it.second->getTransparent()) {
 			this->transparentModels.push_back(it.first);
 		}
@@ -24,9 +27,13 @@ void Scene::setModels(std::map<std::string, Model*> models) {
 std::vector<std::string> Scene::getTransparentModels() { return this->transparentModels; }
 std::vector<std::string> Scene::getOpaqueModels() { return this->opaqueModels; }
 
-Model* Scene::getModel(std::string name) { return this->models[name]; }
+Model* Scene::getModel(std::string name) { 
+	auto it = this->models.find(name);
+	return it == this->models.end() ? nullptr : it->second;
+}
 void Scene::setModel(Model* model) { 
 	this->models[model->getName()] = model; 
+	this->addRenderEntry(model);
 	if (model->getTransparent()) {
 		this->transparentModels.push_back(model->getName());
 	}
@@ -37,9 +44,126 @@ void Scene::setModel(Model* model) {
 Model* Scene::removeModel(std::string name) {
 	Model* model = this->models.at(name);
 	this->models.erase(name);
+	this->removeRenderEntry(name);
+	this->transparentModels.erase(std::remove(this->transparentModels.begin(), this->transparentModels.end(), name), this->transparentModels.end());
+	this->opaqueModels.erase(std::remove(this->opaqueModels.begin(), this->opaqueModels.end(), name), this->opaqueModels.end());
 	return model;
 }
 
+InstancedModel* Scene::getInstancedModel(const std::string& name) const {
+	auto it = this->instancedModels.find(name);
+	return it == this->instancedModels.end() ? nullptr : it->second;
+}
+InstancedModel* Scene::removeInstancedModel(const std::string& name) {
+	auto it = this->instancedModels.find(name);
+	if (it == this->instancedModels.end())
+		return nullptr;
+	InstancedModel* instancedModel = it->second;
+	this->instancedModels.erase(it);
+	return instancedModel;
+}
+
+// move the object space bounds of the model and its meshes into world space
+static void updateRenderEntryBounds(RenderEntry& entry) {
+	entry.bounds = entry.model->getBounds().transform(entry.transform);
+	// the model bounds are enough when there is only one mesh to cull
+	if (entry.meshes.size() > 1) {
+		for (RenderMesh& renderMesh : entry.meshes) {
+			renderMesh.bounds = renderMesh.mesh->getBounds().transform(entry.transform);
+		}
+	}
+	else if (entry.meshes.size() == 1) {
+		entry.meshes[0].bounds = entry.bounds;
+	}
+}
+
+void Scene::addRenderEntry(Model* model) {
+	RenderEntry entry;
+	entry.model = model;
+	for (IDrawObj* mesh : model->getMeshes()) {
+		entry.meshes.push_back({ mesh, mesh->getMaterial() });
+	}
+	// the model may have been placed since the last update. only its own chain is computed, the frame update still counts it
+	TransformSystem::get().updateChain(model->getTransform());
+	entry.transform = model->getModelMatrix();
+	entry.normal = model->getNormalMatrix();
+	entry.transformVersion = TransformSystem::get().getVersion(model->getTransform());
+	model->refreshBounds();
+	entry.boundsVersion = model->getBoundsVersion();
+	updateRenderEntryBounds(entry);
+
+	auto it = this->renderListIndex.find(model->getName());
+	if (it != this->renderListIndex.end()) {
+		// replacing a model keeps its shader assignment
+		entry.shader = this->renderList[it->second].shader;
+		this->renderList[it->second] = std::move(entry);
+	}
+	else {
+		this->renderListIndex[model->getName()] = this->renderList.size();
+		this->renderList.push_back(std::move(entry));
+	}
+}
+
+void Scene::removeRenderEntry(const std::string& name) {
+	auto it = this->renderListIndex.find(name);
+	if (it == this->renderListIndex.end())
+		return;
+
+	// move the last entry into the hole so the list stays contiguous
+	size_t index = it->second;
+	this->renderListIndex.erase(it);
+	if (index != this->renderList.size() - 1) {
+		this->renderList[index] = std::move(this->renderList.back());
+		this->renderListIndex[this->renderList[index].model->getName()] = index;
+	}
+	this->renderList.pop_back();
+}
+
+void Scene::updateRenderList() {
+	TransformSystem& transforms = TransformSystem::get();
+	transforms.update();
+	for (RenderEntry& entry : this->renderList) {
+		for (RenderMesh& renderMesh : entry.meshes) {
+			renderMesh.material = renderMesh.mesh->getMaterial();
+		}
+		uint32_t version = transforms.getVersion(entry.model->getTransform());
+		if (version != entry.transformVersion) {
+			entry.transform = entry.model->getModelMatrix();
+			entry.normal = entry.model->getNormalMatrix();
+			entry.transformVersion = version;
+			updateRenderEntryBounds(entry);
+		}
+		// meshes such as the primitives can rebuild their geometry in place
+		entry.model->refreshBounds();
+		if (entry.model->getBoundsVersion() != entry.boundsVersion) {
+			entry.boundsVersion = entry.model->getBoundsVersion();
+			updateRenderEntryBounds(entry);
+		}
+	}
+}
+
+std::string Scene::getModelShader(const std::string& modelName) const {
+	auto it = this->renderListIndex.find(modelName);
+	if (it == this->renderListIndex.end() || this->renderList[it->second].shader.empty())
+		return "Deferred";
+	return this->renderList[it->second].shader;
+}
+
+void Scene::setModelShader(const std::string& modelName, const std::string& shaderName) {
+	auto it = this->renderListIndex.find(modelName);
+	if (it == this->renderListIndex.end()) {
+		std::cout << "ERROR::SCENE:: can not assign a shader to " << modelName << ", it is not in the scene" << std::endl;
+		return;
+	}
+	this->renderList[it->second].shader = shaderName;
+}
+
+void Scene::removeModelShader(const std::string& modelName) {
+	auto it = this->renderListIndex.find(modelName);
+	if (it != this->renderListIndex.end())
+		this->renderList[it->second].shader.clear();
+}
+
 Camera* Scene::getActiveCamera() const { return this->cameras.at(this->activeCamera); }
 void Scene::setActiveCamera(const int &activeCamera) { this->activeCamera = activeCamera; }
 void Scene::addCamera(Camera* camera) { this->cameras.push_back(camera); }
@@ -1,6 +1,11 @@
 #include "ShadowCubeMap.h"
 #include "glHelper.h"
 
+static const Uniform shadowTransformsUniform("shadowTransforms");
+static const Uniform shadowFarUniform("shadowFar");
+static const Uniform lightPosUniform("lightPos");
+static const Uniform culledFacesUniform("culledFaces");
+
 ShadowCubeMap::ShadowCubeMap(const glm::vec3 position, GLsizei resX, GLsizei resY, GLfloat shadowNear, GLfloat shadowFar) :
 	position(position), shadowResX(resX), shadowResY(resY), shadowNear(shadowNear), shadowFar(shadowFar)
 {
@@ -43,14 +48,17 @@ void ShadowCubeMap::setActive() {
 void ShadowCubeMap::uploadUniforms(const Shader& shader) {
 	shader.Use();
 	std::vector<glm::mat4> transforms = this->getShadowTransforms();
-	for (int i = 0; i < transforms.size(); i++) {
-		shader.setMat4("shadowTransforms[" + std::to_string(i) + "]", transforms.at(i));
-	}
-	shader.setFloat("shadowFar", this->shadowFar);
-	shader.setVec3("lightPos", this->position);
+	shader.setMat4(shadowTransformsUniform, transforms.data(), (GLsizei)transforms.size());
+	shader.setFloat(shadowFarUniform, this->shadowFar);
+	shader.setVec3(lightPosUniform, this->position);
+	shader.setInt(culledFacesUniform, 0);
 	checkGLError("BasicLight::drawShadowMap -- upload matrices");
 }
 
+void ShadowCubeMap::uploadCulledFaces(const Shader& shader, unsigned int culledFaces) {
+	shader.setInt(culledFacesUniform, (int)culledFaces);
+}
+
 std::vector<glm::mat4> ShadowCubeMap::getShadowTransforms() {
 	float aspect = (float)this->shadowResX / (float)this->shadowResY;
 	glm::mat4 shadowProj = glm::perspective(glm::radians(90.0f), aspect, this->shadowNear, this->shadowFar);
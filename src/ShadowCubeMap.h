@@ -22,6 +22,12 @@ public:
 	///<summary>Upload uniforms needed during the shadow pass.</summary>
 	void uploadUniforms(const Shader& shader);
 
+	///<summary>Set which faces the next draw skips in the geometry shader. Bit i skips face i, 0 renders all six faces.</summary>
+	void uploadCulledFaces(const Shader& shader, unsigned int culledFaces);
+
+	///<summary>return a vector of all the transforms that need to be applied to the shadowmap based on its light's position.</summary>
+	std::vector<glm::mat4> getShadowTransforms();
+
 	const glm::vec3 getPosition() const { return this->position; }
 	void setPosition(glm::vec3 position) { this->position = position; }
 
@@ -31,7 +37,4 @@ private:
 	GLsizei shadowResX, shadowResY;
 	GLfloat shadowNear, shadowFar;
 	glm::vec3 position;
-
-	///<summary>return a vector of all the transforms that need to be applied to the shadowmap based on its light's position.</summary>
-	std::vector<glm::mat4> getShadowTransforms();
 };
@@ -1,5 +1,7 @@
 #include "ShadowMap.h"
 
+static const Uniform shadowTransformUniform("shadowTransform");
+
 ShadowMap::ShadowMap(const glm::vec3 position, const glm::vec3 direction, GLsizei resX, GLsizei resY, GLsizei shadowWidth, GLsizei shadowHeight, float shadowNear, float shadowFar) :
 	position(position), direction(direction), shadowResX(resX), shadowResY(resY), shadowWidth(shadowWidth), shadowHeight(shadowHeight), shadowNear(shadowNear), shadowFar(shadowFar)
 {
@@ -41,7 +43,7 @@ void ShadowMap::setActive() {
 void ShadowMap::uploadUniforms(const Shader& shader) {
 	shader.Use();
 	glm::mat4 transform = this->getShadowTransform();
-	shader.setMat4("shadowTransform", transform);
+	shader.setMat4(shadowTransformUniform, transform);
 	checkGLError("ShadowMap::drawShadowMap -- upload matrices");
 }
 
@@ -1,7 +1,10 @@
 #include "Sphere.h"
 
 Sphere::Sphere(std::string name, float radius, int sectorCount, int stackCount, bool smooth) : IDrawObj(name) {
-	this->getMaterial()->AmbientColor = glm::vec4(0.0f, 1.0f, 0.0f, 1.0f);
+	// materials are shared, intern a green one instead of editing the default
+	Material material;
+	material.AmbientColor = glm::vec4(0.0f, 1.0f, 0.0f, 1.0f);
+	this->setMaterial(MaterialManager::get().intern(material));
 	this->buildSphere(radius, sectorCount, stackCount, smooth);
 }
 
@@ -21,6 +24,7 @@ void Sphere::buildSphere(float radius, int sectorCount, int stackCount, bool smo
 	else {
 		this->buildVerticesFlat();
 	}
+	this->setBounds(Bounds::fromPoints(this->vertices.data(), this->vertices.size(), sizeof(glm::vec3)));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -38,6 +42,7 @@ void Sphere::setRadius(float radius) {
 		this->vertices[i] *= scale;
 		this->interleavedVertices[i].Position *= scale;
 	}
+	this->setBounds(Bounds::fromPoints(this->vertices.data(), this->vertices.size(), sizeof(glm::vec3)));
 }
 
 void Sphere::setSectorCount(int sectorCount) {
@@ -356,21 +361,47 @@ void Sphere::genVAO() {
 	glDeleteBuffers(1, &EBO);
 }
 
-void Sphere::Draw(const Shader& shader, GLuint baseUnit) {
+GLuint Sphere::getVertexArray() {
 	if (this->VAO == 0) {
 		this->genVAO();
 	}
+	return this->VAO;
+}
 
-	shader.setVec4("material.ambient", this->material->AmbientColor);
-	shader.setVec4("material.diffuse", this->material->DiffuseColor);
-	shader.setVec4("material.specular", this->material->SpecularColor);
-	shader.setFloat("material.shininess", this->material->Shininess);
-	shader.setFloat("material.opacity", this->material->Opacity);
-	shader.setFloat("material.reflectivity", this->material->Reflectivity);
-	shader.setFloat("material.refractionIndex", this->material->RefractionIndex);
+void Sphere::genDepthVAO() {
+	glGenVertexArrays(1, &this->depthVAO);
+	glBindVertexArray(this->depthVAO);
 
-	glBindVertexArray(VAO);
-	glDrawElements(this->smooth ? GL_TRIANGLE_STRIP : GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+	// the positions are in the same order as the interleaved vertices, so the indices are shared
+	glGenBuffers(1, &this->depthVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, this->depthVBO);
+	glBufferData(GL_ARRAY_BUFFER, this->getVertexSize(), this->getVertices(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &this->depthEBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->depthEBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->getIndexSize(), this->getIndices(), GL_STATIC_DRAW);
+
+	glEnableVertexAttribArray(0); // vertex positions
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+
+	// cleanup
+	glBindVertexArray(0);
+	glDeleteBuffers(1, &this->depthVBO);
+	glDeleteBuffers(1, &this->depthEBO);
+}
+
+GLuint Sphere::getDepthVertexArray() {
+	if (this->depthVAO == 0) {
+		this->genDepthVAO();
+	}
+	return this->depthVAO;
+}
+
+void Sphere::drawGeometry(GLsizei instanceCount, size_t lod) {
+	if (instanceCount == 1)
+		glDrawElements(this->smooth ? GL_TRIANGLE_STRIP : GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+	else
+		glDrawElementsInstanced(this->smooth ? GL_TRIANGLE_STRIP : GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0, instanceCount);
 }
 
 void Sphere::genLineVAO() {
@@ -70,7 +70,9 @@ public:
 	const VertexData* getInterleavedVertices() const	{ return this->interleavedVertices.data(); }
 
 	// drawers
-	void Draw(const Shader& shader, GLuint baseUnit = 0);
+	GLuint getVertexArray();
+	GLuint getDepthVertexArray();
+	void drawGeometry(GLsizei instanceCount = 1, size_t lod = 0);
 	void drawLines();
 
 private:
@@ -83,6 +85,7 @@ private:
 	void clearData();
 
 	void genVAO();
+	void genDepthVAO();
 	void genLineVAO();
 
 	float radius;
@@ -96,5 +99,7 @@ private:
 	std::vector<glm::vec3> normals;
 	std::vector<VertexData> interleavedVertices;
 	GLuint VAO = 0, VBO, EBO;
+	// positions only, for the stencil pass of the light volumes
+	GLuint depthVAO = 0, depthVBO, depthEBO;
 	GLuint lineVAO = 0, lineVBO, lineEBO;
 };
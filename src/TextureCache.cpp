@@ -0,0 +1,217 @@
+#include "TextureCache.h"
+#include <filesystem>
+#include <iostream>
+#include "AssetLoader.h"
+#include "glHelper.h"
+
+TextureCache& TextureCache::get()
+{
+	static TextureCache cache;
+	return cache;
+}
+
+std::string TextureCache::makeKey(const std::string& path, bool srgb, bool flip, TextureUsage usage, GLenum wrap)
+{
+	std::error_code error;
+	std::filesystem::path canonical = std::filesystem::weakly_canonical(std::filesystem::absolute(path, error), error);
+	std::string key = error ? path : canonical.generic_string();
+	key += srgb ? "|srgb" : "|linear";
+	if (flip)
+		key += "|flip";
+	if (usage == TextureUsage::Normal)
+		key += "|normal";
+	if (wrap != GL_REPEAT)
+		key += "|wrap" + std::to_string(wrap);
+	return key;
+}
+
+GLuint TextureCache::reference(const std::string& key)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	auto it = this->entries.find(key);
+	if (it == this->entries.end())
+		return 0;
+	it->second.references++;
+	this->hits++;
+	return it->second.id;
+}
+
+void TextureCache::add(const TextureCacheEntry& entry)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->entries[entry.key] = entry;
+	this->keys[entry.id] = entry.key;
+	this->memoryUsage += entry.bytes;
+}
+
+GLuint TextureCache::acquire(const std::string& path, bool srgb, bool flip, TextureUsage usage, GLenum wrap)
+{
+	std::string key = TextureCache::makeKey(path, srgb, flip, usage, wrap);
+	GLuint texture = this->reference(key);
+	if (texture != 0)
+		return texture;
+
+	TextureCacheEntry entry;
+	entry.key = key;
+	entry.references = 1;
+	CompressedImage compressed;
+	if (TextureCompressor::loadOrCompress(path, usage, srgb, flip, compressed)) {
+		entry.id = TextureCompressor::upload(compressed);
+		entry.width = compressed.width;
+		entry.height = compressed.height;
+		entry.bytes = compressed.data.size();
+		entry.compressed = true;
+	}
+	else {
+		ImageData image;
+		if (!AssetLoader::decodeImage(path, image, flip))
+			return 0;
+		entry.id = AssetLoader::uploadImage(image, srgb);
+		entry.width = image.width;
+		entry.height = image.height;
+		entry.bytes = AssetLoader::getTextureSize(image);
+	}
+	// both uploads leave the texture repeating
+	if (wrap != GL_REPEAT) {
+		glBindTexture(GL_TEXTURE_2D, entry.id);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+		checkGLError("TextureCache::acquire");
+	}
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->misses++;
+	}
+	this->add(entry);
+	return entry.id;
+}
+
+GLuint TextureCache::acquireCubeMap(const std::vector<std::string>& faces)
+{
+	std::string key = "cube";
+	for (const std::string& face : faces) {
+		key += ":" + TextureCache::makeKey(face, false, false);
+	}
+	GLuint texture = this->reference(key);
+	if (texture != 0)
+		return texture;
+
+	TextureCacheEntry entry;
+	entry.key = key;
+	entry.target = GL_TEXTURE_CUBE_MAP;
+	glGenTextures(1, &entry.id);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, entry.id);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (GLuint i = 0; i < faces.size(); i++) {
+		ImageData image;
+		if (!AssetLoader::decodeImage(faces[i], image, false, false)) {
+			std::cout << "Texture failed to load at path: " << faces[i] << std::endl;
+			continue;
+		}
+		GLenum format = AssetLoader::getFormat(image.channels);
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels.data());
+		entry.width = image.width;
+		entry.height = image.height;
+		entry.bytes += AssetLoader::getTextureSize(image);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	checkGLError("TextureCache::acquireCubeMap");
+
+	entry.references = 1;
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->misses++;
+	}
+	this->add(entry);
+	return entry.id;
+}
+
+GLuint TextureCache::insert(const std::string& path, bool srgb, bool flip, TextureUsage usage, GLuint texture, int width, int height, size_t bytes)
+{
+	std::string key = TextureCache::makeKey(path, srgb, flip, usage);
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		auto it = this->entries.find(key);
+		if (it != this->entries.end()) {
+			// another load finished first, keep the texture that may already be referenced
+			if (it->second.id != texture)
+				glDeleteTextures(1, &texture);
+			return it->second.id;
+		}
+	}
+
+	TextureCacheEntry entry;
+	entry.key = key;
+	entry.id = texture;
+	entry.width = width;
+	entry.height = height;
+	entry.bytes = bytes;
+	this->add(entry);
+	return texture;
+}
+
+bool TextureCache::contains(const std::string& path, bool srgb, bool flip, TextureUsage usage) const
+{
+	std::string key = TextureCache::makeKey(path, srgb, flip, usage);
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->entries.find(key) != this->entries.end();
+}
+
+void TextureCache::release(GLuint texture)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	auto key_it = this->keys.find(texture);
+	if (key_it == this->keys.end())
+		return;
+	auto it = this->entries.find(key_it->second);
+	if (--it->second.references > 0)
+		return;
+
+	this->memoryUsage -= it->second.bytes;
+	glDeleteTextures(1, &texture);
+	this->entries.erase(it);
+	this->keys.erase(key_it);
+}
+
+void TextureCache::purgeUnused()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	for (auto it = this->entries.begin(); it != this->entries.end();) {
+		if (it->second.references > 0) {
+			++it;
+			continue;
+		}
+		this->memoryUsage -= it->second.bytes;
+		glDeleteTextures(1, &it->second.id);
+		this->keys.erase(it->second.id);
+		it = this->entries.erase(it);
+	}
+}
+
+size_t TextureCache::getMemoryUsage() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->memoryUsage;
+}
+
+size_t TextureCache::getTextureCount() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->entries.size();
+}
+
+std::vector<TextureCacheEntry> TextureCache::getEntries() const
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	std::vector<TextureCacheEntry> entries;
+	for (auto& entry_it : this->entries) {
+		entries.push_back(entry_it.second);
+	}
+	return entries;
+}
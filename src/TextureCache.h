@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include "TextureCompressor.h"
+
+///<summary>A texture in the cache, for display in the debug ui.</summary>
+struct TextureCacheEntry {
+	std::string key;
+	GLuint id = 0;
+	GLenum target = GL_TEXTURE_2D;
+	int width = 0;
+	int height = 0;
+	int references = 0;
+	///<summary>Estimated GPU memory of the texture and its mip chain in bytes.</summary>
+	size_t bytes = 0;
+	///<summary>Whether the texture is block compressed.</summary>
+	bool compressed = false;
+};
+
+///<summary>Process wide, reference counted registry of textures loaded from files.
+///<para>Textures are keyed on their canonical absolute path and color space so every model, skybox and helper loader that references the same file shares one texture.
+///Every acquire must be paired with a release. The texture is deleted when its last reference is released.</para>
+///</summary>
+class TextureCache {
+public:
+	static TextureCache& get();
+
+	///<summary>Get the texture for an image file, loading it on the calling thread if it is not cached. Must be called on the thread that owns the OpenGL context.</summary>
+	///<param name="path">Path of the image file.</param>
+	///<param name="srgb">Whether the image is stored in sRGB and should be linearized when sampled.</param>
+	///<param name="flip">Flip the image vertically on load.</param>
+	///<param name="usage">How the texture is sampled, which picks its compressed format.</param>
+	///<param name="wrap">Wrap mode of both texture coordinates. Textures with different wrap modes are cached separately.</param>
+	///<returns>The texture, or 0 if the image could not be loaded.</returns>
+	GLuint acquire(const std::string& path, bool srgb = false, bool flip = false, TextureUsage usage = TextureUsage::Color, GLenum wrap = GL_REPEAT);
+
+	///<summary>Get the cube map for six face images, ordered +x, -x, +y, -y, +z, -z, loading it if it is not cached.</summary>
+	GLuint acquireCubeMap(const std::vector<std::string>& faces);
+
+	///<summary>Add a texture that was uploaded elsewhere, such as by the AssetLoader, without taking a reference.
+	///<para>The texture must use GL_REPEAT wrapping. If the key is already cached the given texture is deleted and the cached one is returned.</para>
+	///</summary>
+	GLuint insert(const std::string& path, bool srgb, bool flip, TextureUsage usage, GLuint texture, int width, int height, size_t bytes);
+
+	///<summary>Whether a texture is cached. Safe to call from any thread.</summary>
+	bool contains(const std::string& path, bool srgb = false, bool flip = false, TextureUsage usage = TextureUsage::Color) const;
+
+	///<summary>Release a reference taken by acquire. Deletes the texture when no references are left.</summary>
+	void release(GLuint texture);
+
+	///<summary>Delete every texture that has no references, such as textures inserted but never acquired.</summary>
+	void purgeUnused();
+
+	size_t getMemoryUsage() const;
+	size_t getTextureCount() const;
+	///<summary>Number of acquires that found the texture already cached.</summary>
+	size_t getHits() const { return this->hits; }
+	///<summary>Number of acquires that had to load the texture.</summary>
+	size_t getMisses() const { return this->misses; }
+	///<summary>Get a copy of every entry, for display.</summary>
+	std::vector<TextureCacheEntry> getEntries() const;
+
+	///<summary>Build the key a texture is cached under.</summary>
+	static std::string makeKey(const std::string& path, bool srgb, bool flip, TextureUsage usage = TextureUsage::Color, GLenum wrap = GL_REPEAT);
+
+private:
+	TextureCache() {}
+	TextureCache(const TextureCache&) = delete;
+	TextureCache& operator=(const TextureCache&) = delete;
+
+	mutable std::mutex mutex;
+	std::map<std::string, TextureCacheEntry> entries;
+	std::map<GLuint, std::string> keys;
+	size_t memoryUsage = 0;
+	size_t hits = 0, misses = 0;
+
+	///<summary>Take a reference to a cached texture. Returns 0 if it is not cached.</summary>
+	GLuint reference(const std::string& key);
+	void add(const TextureCacheEntry& entry);
+};
@@ -0,0 +1,440 @@
+#include "TextureCompressor.h"
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include "AssetLoader.h"
+#include "FileUtils.h"
+#include "MeshCache.h"
+#include "glHelper.h"
+
+namespace fs = std::filesystem;
+
+bool TextureCompressor::enabled = true;
+bool TextureCompressor::supported = false;
+static bool srgbSupported = false;
+
+static const char textureCacheMagic[4] = { 'O', 'G', 'T', 'C' };
+
+struct TextureCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t internalFormat;
+	uint32_t width;
+	uint32_t height;
+	uint32_t levelCount;
+	int64_t sourceTime;
+};
+
+void TextureCompressor::detectSupport()
+{
+	bool s3tc = false;
+	GLint extensionCount = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+	for (GLint i = 0; i < extensionCount; i++) {
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (!extension)
+			continue;
+		if (std::strcmp(extension, "GL_EXT_texture_compression_s3tc") == 0)
+			s3tc = true;
+		else if (std::strcmp(extension, "GL_EXT_texture_sRGB") == 0 || std::strcmp(extension, "GL_EXT_texture_compression_s3tc_srgb") == 0)
+			srgbSupported = true;
+	}
+	// RGTC (BC4/BC5) is core since OpenGL 3.0, S3TC (BC1/BC3) is an extension every desktop driver exposes
+	TextureCompressor::supported = s3tc;
+	if (!s3tc)
+		std::cout << "S3TC texture compression is not supported, textures are uploaded uncompressed" << std::endl;
+	checkGLError("TextureCompressor::detectSupport");
+}
+
+// block encoders
+
+// fetch a 4x4 block as RGBA, clamping at the edges of images smaller than a block or not a multiple of 4
+static void fetchBlock(const unsigned char* pixels, int width, int height, int channels, TextureUsage usage, int blockX, int blockY, uint8_t block[16][4])
+{
+	for (int y = 0; y < 4; y++) {
+		int py = std::min(blockY * 4 + y, height - 1);
+		for (int x = 0; x < 4; x++) {
+			int px = std::min(blockX * 4 + x, width - 1);
+			const unsigned char* pixel = pixels + ((size_t)py * width + px) * channels;
+			uint8_t* out = block[y * 4 + x];
+			switch (channels) {
+			case 1:
+				out[0] = out[1] = out[2] = pixel[0];
+				out[3] = 255;
+				break;
+			case 2:
+				// two channel normal maps are already xy, otherwise treat it as luminance and alpha
+				if (usage == TextureUsage::Normal) {
+					out[0] = pixel[0]; out[1] = pixel[1]; out[2] = 0;
+					out[3] = 255;
+				}
+				else {
+					out[0] = out[1] = out[2] = pixel[0];
+					out[3] = pixel[1];
+				}
+				break;
+			case 3:
+				out[0] = pixel[0]; out[1] = pixel[1]; out[2] = pixel[2];
+				out[3] = 255;
+				break;
+			default:
+				out[0] = pixel[0]; out[1] = pixel[1]; out[2] = pixel[2];
+				out[3] = pixel[3];
+				break;
+			}
+		}
+	}
+}
+
+static uint16_t packColor565(const float color[3])
+{
+	int r = (int)std::lround(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+	int g = (int)std::lround(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+	int b = (int)std::lround(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpackColor565(uint16_t packed, float color[3])
+{
+	color[0] = (float)((packed >> 11) & 31) * 255.0f / 31.0f;
+	color[1] = (float)((packed >> 5) & 63) * 255.0f / 63.0f;
+	color[2] = (float)(packed & 31) * 255.0f / 31.0f;
+}
+
+// BC1: two 565 endpoints fit along the principal axis of the block colors and 2 bit indices
+static void encodeBC1(const uint8_t block[16][4], uint8_t* out)
+{
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	float minColor[3] = { 255.0f, 255.0f, 255.0f }, maxColor[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 3; c++) {
+			mean[c] += block[i][c] / 16.0f;
+			minColor[c] = std::min(minColor[c], (float)block[i][c]);
+			maxColor[c] = std::max(maxColor[c], (float)block[i][c]);
+		}
+	}
+
+	float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++) {
+		float r = block[i][0] - mean[0], g = block[i][1] - mean[1], b = block[i][2] - mean[2];
+		covariance[0] += r * r; covariance[1] += r * g; covariance[2] += r * b;
+		covariance[3] += g * g; covariance[4] += g * b; covariance[5] += b * b;
+	}
+
+	// a few power iterations starting from the bounding box diagonal find the principal axis
+	float axis[3] = { maxColor[0] - minColor[0], maxColor[1] - minColor[1], maxColor[2] - minColor[2] };
+	for (int iteration = 0; iteration < 4; iteration++) {
+		float next[3] = {
+			covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+			covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+			covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]
+		};
+		float length = std::max(std::max(std::abs(next[0]), std::abs(next[1])), std::abs(next[2]));
+		if (length < 1e-6f)
+			break;
+		for (int c = 0; c < 3; c++)
+			axis[c] = next[c] / length;
+	}
+
+	float minT = 0.0f, maxT = 0.0f;
+	float lengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	if (lengthSquared > 1e-6f) {
+		minT = FLT_MAX; maxT = -FLT_MAX;
+		for (int i = 0; i < 16; i++) {
+			float t = ((block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2]) / lengthSquared;
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+	}
+	// inset the endpoints a little, the interpolated colors cover the extremes better
+	float inset = (maxT - minT) / 16.0f;
+	float endpoint0[3], endpoint1[3];
+	for (int c = 0; c < 3; c++) {
+		endpoint0[c] = mean[c] + axis[c] * (maxT - inset);
+		endpoint1[c] = mean[c] + axis[c] * (minT + inset);
+	}
+
+	uint16_t color0 = packColor565(endpoint0);
+	uint16_t color1 = packColor565(endpoint1);
+	// color0 > color1 selects the four color mode
+	if (color0 < color1)
+		std::swap(color0, color1);
+
+	uint32_t indices = 0;
+	if (color0 != color1) {
+		float palette[4][3];
+		unpackColor565(color0, palette[0]);
+		unpackColor565(color1, palette[1]);
+		for (int c = 0; c < 3; c++) {
+			palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+			palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+		}
+		for (int i = 0; i < 16; i++) {
+			int best = 0;
+			float bestDistance = FLT_MAX;
+			for (int p = 0; p < 4; p++) {
+				float dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+				float distance = dr * dr + dg * dg + db * db;
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= (uint32_t)best << (i * 2);
+		}
+	}
+
+	out[0] = color0 & 0xFF; out[1] = color0 >> 8;
+	out[2] = color1 & 0xFF; out[3] = color1 >> 8;
+	for (int i = 0; i < 4; i++)
+		out[4 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+// BC4: two 8 bit endpoints and 3 bit indices of a single channel, used for BC3 alpha and both BC5 channels
+static void encodeBC4(const uint8_t block[16][4], int channel, uint8_t* out)
+{
+	uint8_t minValue = 255, maxValue = 0;
+	for (int i = 0; i < 16; i++) {
+		minValue = std::min(minValue, block[i][channel]);
+		maxValue = std::max(maxValue, block[i][channel]);
+	}
+
+	uint64_t indices = 0;
+	if (maxValue != minValue) {
+		// value0 > value1 selects the eight value mode
+		float palette[8];
+		palette[0] = maxValue;
+		palette[1] = minValue;
+		for (int i = 1; i < 7; i++)
+			palette[i + 1] = ((7 - i) * (float)maxValue + i * (float)minValue) / 7.0f;
+		for (int i = 0; i < 16; i++) {
+			int best = 0;
+			float bestDistance = FLT_MAX;
+			for (int p = 0; p < 8; p++) {
+				float distance = std::abs(block[i][channel] - palette[p]);
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= (uint64_t)best << (i * 3);
+		}
+	}
+
+	out[0] = maxValue;
+	out[1] = minValue;
+	for (int i = 0; i < 6; i++)
+		out[2 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+static bool hasAlpha(const ImageData& image)
+{
+	if (image.channels != 4 && image.channels != 2)
+		return false;
+	size_t count = (size_t)image.width * image.height;
+	for (size_t i = 0; i < count; i++) {
+		if (image.pixels[i * image.channels + image.channels - 1] != 255)
+			return true;
+	}
+	return false;
+}
+
+void TextureCompressor::compress(const ImageData& source, TextureUsage usage, bool srgb, CompressedImage& image)
+{
+	size_t blockSize = 16;
+	if (usage == TextureUsage::Normal) {
+		image.internalFormat = GL_COMPRESSED_RG_RGTC2;
+	}
+	else if (source.channels == 1) {
+		image.internalFormat = GL_COMPRESSED_RED_RGTC1;
+		blockSize = 8;
+	}
+	else if (hasAlpha(source)) {
+		image.internalFormat = srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	}
+	else {
+		image.internalFormat = srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		blockSize = 8;
+	}
+	image.width = source.width;
+	image.height = source.height;
+	image.levelOffsets.clear();
+	image.levelSizes.clear();
+
+	size_t size = 0;
+	for (int level = 0; level < source.getLevelCount(); level++) {
+		size_t blocks = (size_t)((source.getLevelWidth(level) + 3) / 4) * ((source.getLevelHeight(level) + 3) / 4);
+		image.levelOffsets.push_back(size);
+		image.levelSizes.push_back(blocks * blockSize);
+		size += blocks * blockSize;
+	}
+	image.data.resize(size);
+
+	uint8_t block[16][4];
+	for (int level = 0; level < source.getLevelCount(); level++) {
+		int width = source.getLevelWidth(level);
+		int height = source.getLevelHeight(level);
+		int blocksX = (width + 3) / 4;
+		int blocksY = (height + 3) / 4;
+		const unsigned char* pixels = &source.pixels[source.levelOffsets[level]];
+		uint8_t* out = &image.data[image.levelOffsets[level]];
+		for (int blockY = 0; blockY < blocksY; blockY++) {
+			for (int blockX = 0; blockX < blocksX; blockX++) {
+				fetchBlock(pixels, width, height, source.channels, usage, blockX, blockY, block);
+				switch (image.internalFormat) {
+				case GL_COMPRESSED_RG_RGTC2:
+					encodeBC4(block, 0, out);
+					encodeBC4(block, 1, out + 8);
+					break;
+				case GL_COMPRESSED_RED_RGTC1:
+					encodeBC4(block, 0, out);
+					break;
+				case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+				case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+					encodeBC4(block, 3, out);
+					encodeBC1(block, out + 8);
+					break;
+				default:
+					encodeBC1(block, out);
+					break;
+				}
+				out += blockSize;
+			}
+		}
+	}
+}
+
+GLuint TextureCompressor::upload(const CompressedImage& image)
+{
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.getLevelCount() - 1);
+
+	for (int level = 0; level < image.getLevelCount(); level++) {
+		glCompressedTexImage2D(
+			GL_TEXTURE_2D, level, image.internalFormat,
+			image.getLevelWidth(level), image.getLevelHeight(level), 0,
+			(GLsizei)image.levelSizes[level], &image.data[image.levelOffsets[level]]
+		);
+	}
+	checkGLError("TextureCompressor::upload");
+	return texture;
+}
+
+// compressed texture cache
+
+std::string TextureCompressor::getCachePath(const std::string& path, TextureUsage usage, bool srgb, bool flip)
+{
+	// FNV-1a of the source path and settings names the entry
+	std::string key = FileUtils::getCanonicalPath(path) + "|" + std::to_string((int)usage) + (srgb ? "|srgb" : "") + (flip ? "|flip" : "");
+	uint64_t hash = FileUtils::hashString(key);
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.ktc", (unsigned long long)hash);
+	return std::string(TEXTURE_CACHE_DIRECTORY) + "/" + name;
+}
+
+bool TextureCompressor::load(const std::string& path, TextureUsage usage, bool srgb, bool flip, CompressedImage& image)
+{
+	MappedFile file;
+	if (!file.open(TextureCompressor::getCachePath(path, usage, srgb, flip)))
+		return false;
+
+	const uint8_t* data = file.getData();
+	size_t size = file.getSize();
+	TextureCacheHeader header;
+	if (size < sizeof(header))
+		return false;
+	std::memcpy(&header, data, sizeof(header));
+	if (std::memcmp(header.magic, textureCacheMagic, sizeof(textureCacheMagic)) != 0
+		|| header.version != TEXTURE_CACHE_VERSION
+		|| header.sourceTime != FileUtils::getModifiedTime(path)) {
+		return false;
+	}
+
+	size_t offset = sizeof(header);
+	image.internalFormat = header.internalFormat;
+	image.width = header.width;
+	image.height = header.height;
+	image.levelOffsets.clear();
+	image.levelSizes.clear();
+	image.data.clear();
+	for (uint32_t level = 0; level < header.levelCount; level++) {
+		uint32_t levelSize;
+		if (size - offset < sizeof(levelSize))
+			return false;
+		std::memcpy(&levelSize, data + offset, sizeof(levelSize));
+		offset += sizeof(levelSize);
+		if (size - offset < levelSize)
+			return false;
+		image.levelOffsets.push_back(image.data.size());
+		image.levelSizes.push_back(levelSize);
+		image.data.insert(image.data.end(), data + offset, data + offset + levelSize);
+		offset += levelSize;
+	}
+	return header.levelCount > 0;
+}
+
+bool TextureCompressor::save(const std::string& path, TextureUsage usage, bool srgb, bool flip, const CompressedImage& image)
+{
+	std::error_code error;
+	fs::create_directories(TEXTURE_CACHE_DIRECTORY, error);
+	std::string cachePath = TextureCompressor::getCachePath(path, usage, srgb, flip);
+	// write to a temporary file first so a crash never leaves a truncated entry behind
+	std::string tempPath = cachePath + ".tmp";
+	std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+	if (!out.is_open()) {
+		std::cerr << "ERROR::TEXTURE_CACHE:: could not write " << tempPath << std::endl;
+		return false;
+	}
+
+	TextureCacheHeader header;
+	std::memcpy(header.magic, textureCacheMagic, sizeof(textureCacheMagic));
+	header.version = TEXTURE_CACHE_VERSION;
+	header.internalFormat = image.internalFormat;
+	header.width = image.width;
+	header.height = image.height;
+	header.levelCount = image.getLevelCount();
+	header.sourceTime = FileUtils::getModifiedTime(path);
+	out.write((const char*)&header, sizeof(header));
+	for (int level = 0; level < image.getLevelCount(); level++) {
+		uint32_t levelSize = (uint32_t)image.levelSizes[level];
+		out.write((const char*)&levelSize, sizeof(levelSize));
+		out.write((const char*)&image.data[image.levelOffsets[level]], levelSize);
+	}
+	out.close();
+
+	if (out.fail()) {
+		std::cerr << "ERROR::TEXTURE_CACHE:: failed writing " << tempPath << std::endl;
+		fs::remove(tempPath, error);
+		return false;
+	}
+	fs::rename(tempPath, cachePath, error);
+	if (error) {
+		fs::remove(tempPath, error);
+		return false;
+	}
+	return true;
+}
+
+bool TextureCompressor::loadOrCompress(const std::string& path, TextureUsage usage, bool srgb, bool flip, CompressedImage& image)
+{
+	if (!TextureCompressor::isEnabled() || (srgb && !srgbSupported))
+		return false;
+	if (TextureCompressor::load(path, usage, srgb, flip, image))
+		return true;
+
+	ImageData source;
+	if (!AssetLoader::decodeImage(path, source, flip))
+		return false;
+	TextureCompressor::compress(source, usage, srgb, image);
+	TextureCompressor::save(path, usage, srgb, flip, image);
+	return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+// bump whenever the container layout or the encoders change
+#define TEXTURE_CACHE_VERSION 1
+#define TEXTURE_CACHE_DIRECTORY "cache/textures"
+
+// S3TC is an extension, the loader may not have been generated with it
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+///<summary>What a texture is sampled as, which decides how it is compressed.</summary>
+enum class TextureUsage {
+	///<summary>Diffuse, specular and other color data. BC1, or BC3 if it has alpha, or BC4 for single channel images.</summary>
+	Color,
+	///<summary>Tangent space normal maps. BC5 stores x and y, shaders rebuild z.</summary>
+	Normal
+};
+
+///<summary>A decoded 8 bit image along with its full mip chain.</summary>
+struct ImageData {
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	///<summary>Every mip level, largest first, tightly packed.</summary>
+	std::vector<unsigned char> pixels;
+	///<summary>Offset of each mip level into pixels.</summary>
+	std::vector<size_t> levelOffsets;
+
+	int getLevelCount() const { return (int)this->levelOffsets.size(); }
+	int getLevelWidth(int level) const { return std::max(1, this->width >> level); }
+	int getLevelHeight(int level) const { return std::max(1, this->height >> level); }
+};
+
+///<summary>A block compressed image along with its full mip chain.</summary>
+struct CompressedImage {
+	GLenum internalFormat = 0;
+	int width = 0;
+	int height = 0;
+	///<summary>Every mip level, largest first, tightly packed.</summary>
+	std::vector<uint8_t> data;
+	std::vector<size_t> levelOffsets;
+	std::vector<size_t> levelSizes;
+
+	int getLevelCount() const { return (int)this->levelOffsets.size(); }
+	int getLevelWidth(int level) const { return std::max(1, this->width >> level); }
+	int getLevelHeight(int level) const { return std::max(1, this->height >> level); }
+};
+
+///<summary>CPU block compression of textures and a cache of the results in TEXTURE_CACHE_DIRECTORY.
+///<para>Everything but detectSupport and upload is free of OpenGL calls and may run on worker threads.</para>
+///</summary>
+class TextureCompressor {
+public:
+	///<summary>Query which compressed formats the driver supports. Must be called once on the thread that owns the OpenGL context; until then nothing is compressed.</summary>
+	static void detectSupport();
+
+	///<summary>Whether textures are compressed at all. False if the driver lacks the formats or compression was switched off.</summary>
+	static bool isEnabled() { return TextureCompressor::enabled && TextureCompressor::supported; }
+	static void setEnabled(bool enabled) { TextureCompressor::enabled = enabled; }
+
+	///<summary>Get the compressed image of a file from the cache, or decode, compress and cache it.</summary>
+	///<param name="path">Path of the source image.</param>
+	///<param name="usage">How the texture is sampled.</param>
+	///<param name="srgb">Pick an sRGB format for color textures.</param>
+	///<param name="flip">Flip the image vertically.</param>
+	///<param name="image">Receives the compressed mip chain.</param>
+	static bool loadOrCompress(const std::string& path, TextureUsage usage, bool srgb, bool flip, CompressedImage& image);
+
+	///<summary>Block compress every mip level of an image.</summary>
+	static void compress(const ImageData& source, TextureUsage usage, bool srgb, CompressedImage& image);
+
+	///<summary>Create a texture from a compressed image with glCompressedTexImage2D.</summary>
+	static GLuint upload(const CompressedImage& image);
+
+private:
+	static bool enabled;
+	static bool supported;
+
+	static std::string getCachePath(const std::string& path, TextureUsage usage, bool srgb, bool flip);
+	static bool load(const std::string& path, TextureUsage usage, bool srgb, bool flip, CompressedImage& image);
+	static bool save(const std::string& path, TextureUsage usage, bool srgb, bool flip, const CompressedImage& image);
+};
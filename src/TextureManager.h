@@ -2,6 +2,7 @@
 
 #include "stb_image.h"
 #include "vertexData.h"
+#include "TextureCache.h"
 
 struct Texture {
     GLuint id;
@@ -21,126 +22,32 @@ Texture static createTexture(std::string type, glm::vec3 color) {
 	return newTexture;
 };
 
+///<summary>Load a cube map from six face images through the texture cache. Release it with TextureCache::release.</summary>
 GLuint static loadSkyboxTexture(const std::vector<std::string> faces)
 {
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-	int width, height, nrComponents;
-	for (GLuint i = 0; i < faces.size(); i++) {
-
-		unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrComponents, 0);
-		if (data)
-		{
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-			stbi_image_free(data);
-		}
-		else
-		{
-			std::cout << "Texture failed to load at path: " << faces[i] << std::endl;
-			stbi_image_free(data);
-		}
-	}
-
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    return textureID;
+	return TextureCache::get().acquireCubeMap(faces);
 }
 
+///<summary>Load a texture relative to a directory through the texture cache. Release it with TextureCache::release.</summary>
 GLuint static TextureFromFile(const std::string &path, const std::string &directory, const bool &gammaCorrection = false)
 {
-	stbi_set_flip_vertically_on_load(false);
-    std::string filename = path;
-    filename = directory + '/' + filename;
-
-	std::cout << "filename: " << filename << std::endl;
-
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-		GLenum internalFormat;
-		if (nrComponents == 1) {
-			format = GL_RED;
-			internalFormat = GL_RED;
-		}
-		else if (nrComponents == 3) {
-			format = GL_RGB;
-			internalFormat = gammaCorrection ? GL_SRGB : GL_RGB;
-		}
-		else if (nrComponents == 4) {
-			format = GL_RGBA;
-			internalFormat = gammaCorrection ? GL_SRGB_ALPHA : GL_RGBA ;
-		}
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+	std::string filename = path;
+	filename = directory + '/' + filename;
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
+	GLuint textureID = TextureCache::get().acquire(filename, gammaCorrection);
+	if (textureID == 0)
+		std::cout << "Texture failed to load at path: " << path << std::endl;
+	return textureID;
 };
 
+///<summary>Load a vertically flipped texture through the texture cache. Textures with an alpha channel clamp to the edge, the others repeat. Release it with TextureCache::release.</summary>
 GLuint static loadTexture(const std::string &path, const bool &gammaCorrection = false)
 {
-	stbi_set_flip_vertically_on_load(true);
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum dataFormat, internalFormat;
-		if (nrComponents == 1) {
-			dataFormat = internalFormat = GL_RED;
-		}
-		else if (nrComponents == 3) {
-			dataFormat = GL_RGB;
-			internalFormat = gammaCorrection ? GL_SRGB : GL_RGB;
-		}
-		else if (nrComponents == 4) {
-			dataFormat = GL_RGBA;
-			internalFormat = gammaCorrection ? GL_SRGB_ALPHA : GL_RGBA ;
-		}
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, dataFormat == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, dataFormat == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
+	// only the header is read to find the channel count
+	int width, height, nrComponents;
+	GLenum wrap = stbi_info(path.c_str(), &width, &height, &nrComponents) && nrComponents == 4 ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+	GLuint textureID = TextureCache::get().acquire(path, gammaCorrection, true, TextureUsage::Color, wrap);
+	if (textureID == 0)
+		std::cout << "Texture failed to load at path: " << path << std::endl;
+	return textureID;
 };
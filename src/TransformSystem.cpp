@@ -0,0 +1,142 @@
+#include "TransformSystem.h"
+#include <cmath>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+
+// relative difference below which the scale axes count as equal
+#define TRANSFORM_UNIFORM_SCALE_EPSILON 1e-5f
+
+TransformSystem& TransformSystem::get()
+{
+	static TransformSystem system;
+	return system;
+}
+
+TransformHandle TransformSystem::create()
+{
+	TransformHandle handle;
+	if (!this->freeHandles.empty()) {
+		handle = this->freeHandles.back();
+		this->freeHandles.pop_back();
+	}
+	else {
+		handle = (TransformHandle)this->positions.size();
+		this->positions.emplace_back();
+		this->rotations.emplace_back();
+		this->scales.emplace_back();
+		this->parents.emplace_back();
+		this->dirty.emplace_back();
+		this->worlds.emplace_back();
+		this->normals.emplace_back();
+		this->uniformScales.emplace_back();
+		this->versions.push_back(0);
+		this->visitedStamps.push_back(0);
+		this->recomputedStamps.push_back(0);
+	}
+	this->positions[handle] = glm::vec3(0.0f);
+	this->rotations[handle] = glm::vec3(0.0f);
+	this->scales[handle] = glm::vec3(1.0f);
+	this->parents[handle] = TRANSFORM_NONE;
+	this->dirty[handle] = 1;
+	this->worlds[handle] = glm::mat4(1.0f);
+	this->normals[handle] = glm::mat3(1.0f);
+	this->uniformScales[handle] = 1;
+	return handle;
+}
+
+void TransformSystem::destroy(TransformHandle handle)
+{
+	for (TransformHandle child = 0; child < this->parents.size(); child++) {
+		if (this->parents[child] == handle) {
+			this->parents[child] = TRANSFORM_NONE;
+			this->dirty[child] = 1;
+		}
+	}
+	this->parents[handle] = TRANSFORM_NONE;
+	this->dirty[handle] = 0;
+	this->freeHandles.push_back(handle);
+}
+
+void TransformSystem::setParent(TransformHandle handle, TransformHandle parent)
+{
+	for (TransformHandle ancestor = parent; ancestor != TRANSFORM_NONE; ancestor = this->parents[ancestor]) {
+		if (ancestor == handle) {
+			std::cerr << "ERROR::TRANSFORM_SYSTEM:: can not attach a transform to one of its children" << std::endl;
+			return;
+		}
+	}
+	this->parents[handle] = parent;
+	this->dirty[handle] = 1;
+}
+
+void TransformSystem::update()
+{
+	this->stamp++;
+	this->recomputed = 0;
+	for (TransformHandle handle = 0; handle < this->positions.size(); handle++) {
+		this->resolve(handle);
+	}
+}
+
+void TransformSystem::updateChain(TransformHandle handle)
+{
+	// mark the chain from the transform up to the root, then compute it from the root down
+	std::vector<TransformHandle> chain;
+	for (TransformHandle ancestor = handle; ancestor != TRANSFORM_NONE; ancestor = this->parents[ancestor])
+		chain.push_back(ancestor);
+	for (auto it = chain.rbegin(); it != chain.rend(); ++it)
+		this->computeWorld(*it);
+}
+
+void TransformSystem::resolve(TransformHandle handle)
+{
+	if (this->visitedStamps[handle] == this->stamp)
+		return;
+	this->visitedStamps[handle] = this->stamp;
+
+	TransformHandle parent = this->parents[handle];
+	if (parent != TRANSFORM_NONE)
+		this->resolve(parent);
+	bool parentChanged = parent != TRANSFORM_NONE && this->recomputedStamps[parent] == this->stamp;
+	if (!this->dirty[handle] && !parentChanged)
+		return;
+
+	this->computeWorld(handle);
+	this->dirty[handle] = 0;
+	this->versions[handle]++;
+	this->recomputedStamps[handle] = this->stamp;
+	this->recomputed++;
+}
+
+void TransformSystem::computeWorld(TransformHandle handle)
+{
+	TransformHandle parent = this->parents[handle];
+	const glm::vec3& rotation = this->rotations[handle];
+	const glm::vec3& scale = this->scales[handle];
+	glm::mat4 local = glm::translate(glm::mat4(1.0f), this->positions[handle]);
+	local = glm::rotate(local, glm::radians(rotation.x), glm::vec3(1.0, 0.0, 0.0));
+	local = glm::rotate(local, glm::radians(rotation.y), glm::vec3(0.0, 1.0, 0.0));
+	local = glm::rotate(local, glm::radians(rotation.z), glm::vec3(0.0, 0.0, 1.0));
+	local = glm::scale(local, scale);
+
+	float largest = std::fmax(std::fabs(scale.x), std::fmax(std::fabs(scale.y), std::fabs(scale.z)));
+	bool uniform = std::fabs(scale.x - scale.y) <= largest * TRANSFORM_UNIFORM_SCALE_EPSILON
+		&& std::fabs(scale.y - scale.z) <= largest * TRANSFORM_UNIFORM_SCALE_EPSILON;
+	if (parent != TRANSFORM_NONE) {
+		this->worlds[handle] = this->worlds[parent] * local;
+		uniform = uniform && this->uniformScales[parent];
+	}
+	else {
+		this->worlds[handle] = local;
+	}
+
+	glm::mat3 world(this->worlds[handle]);
+	float squaredScale = glm::dot(world[0], world[0]);
+	if (uniform && squaredScale > 0.0f)
+		this->normals[handle] = world * (1.0f / squaredScale);
+	else
+		this->normals[handle] = glm::inverseTranspose(world);
+
+	this->uniformScales[handle] = uniform ? 1 : 0;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+///<summary>Index of a transform in the TransformSystem.</summary>
+typedef uint32_t TransformHandle;
+#define TRANSFORM_NONE 0xFFFFFFFFu
+
+///<summary>Process wide store of the position, rotation and scale of every model, with the world and normal matrices derived from them.
+///<para>Each attribute lives in its own array indexed by handle, so update only walks the data it needs. Setters mark a transform dirty and update recomputes
+///the dirty transforms and the children of recomputed ones, once per frame. A transform with a parent is placed relative to the world matrix of the parent.</para>
+///<para>The normal matrix is the inverse transpose of the world matrix, which for a uniform scale is the world matrix divided by the squared scale, so the inverse is skipped.</para>
+///</summary>
+class TransformSystem {
+public:
+	static TransformSystem& get();
+
+	///<summary>Add an identity transform.</summary>
+	TransformHandle create();
+	///<summary>Free a transform. Its children are detached and keep their local transform.</summary>
+	void destroy(TransformHandle handle);
+
+	const glm::vec3& getPosition(TransformHandle handle) const { return this->positions[handle]; }
+	const glm::vec3& getRotation(TransformHandle handle) const { return this->rotations[handle]; }
+	const glm::vec3& getScale(TransformHandle handle) const { return this->scales[handle]; }
+	TransformHandle getParent(TransformHandle handle) const { return this->parents[handle]; }
+	void setPosition(TransformHandle handle, const glm::vec3& position) { this->positions[handle] = position; this->dirty[handle] = 1; }
+	///<summary>Set the rotation in degrees around x, then y, then z.</summary>
+	void setRotation(TransformHandle handle, const glm::vec3& rotation) { this->rotations[handle] = rotation; this->dirty[handle] = 1; }
+	void setScale(TransformHandle handle, const glm::vec3& scale) { this->scales[handle] = scale; this->dirty[handle] = 1; }
+	///<summary>Attach a transform to a parent, or detach it with TRANSFORM_NONE. Refused if it would create a cycle.</summary>
+	void setParent(TransformHandle handle, TransformHandle parent);
+
+	///<summary>Recompute the world and normal matrices of every dirty transform and of the children of recomputed transforms.</summary>
+	void update();
+	///<summary>Compute the world and normal matrices of one transform and its parents up to the root, without a full update.
+	///<para>Their dirty flags and versions are left alone, so the next update still recomputes them and their children and counts them for that frame.</para>
+	///</summary>
+	void updateChain(TransformHandle handle);
+
+	///<summary>The world matrix as of the last update.</summary>
+	const glm::mat4& getWorld(TransformHandle handle) const { return this->worlds[handle]; }
+	///<summary>The normal matrix as of the last update.</summary>
+	const glm::mat3& getNormal(TransformHandle handle) const { return this->normals[handle]; }
+	///<summary>Incremented every time the world matrix is recomputed, so copies of it can tell when they are stale.</summary>
+	uint32_t getVersion(TransformHandle handle) const { return this->versions[handle]; }
+
+	///<summary>Transforms recomputed by the last update.</summary>
+	unsigned int getRecomputedCount() const { return this->recomputed; }
+	size_t getTransformCount() const { return this->positions.size() - this->freeHandles.size(); }
+
+private:
+	TransformSystem() {}
+	TransformSystem(const TransformSystem&) = delete;
+	TransformSystem& operator=(const TransformSystem&) = delete;
+
+	// local transform
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> rotations;
+	std::vector<glm::vec3> scales;
+	std::vector<TransformHandle> parents;
+	std::vector<uint8_t> dirty;
+	// derived by update
+	std::vector<glm::mat4> worlds;
+	std::vector<glm::mat3> normals;
+	std::vector<uint8_t> uniformScales;
+	std::vector<uint32_t> versions;
+	// update that last visited and last recomputed each transform
+	std::vector<uint32_t> visitedStamps;
+	std::vector<uint32_t> recomputedStamps;
+	std::vector<TransformHandle> freeHandles;
+	uint32_t stamp = 0;
+	unsigned int recomputed = 0;
+
+	///<summary>Bring a transform up to date after its parents.</summary>
+	void resolve(TransformHandle handle);
+	///<summary>Derive the world and normal matrices from the local transform, expecting the parent to be up to date.</summary>
+	void computeWorld(TransformHandle handle);
+};
@@ -11,7 +11,6 @@ Camera::Camera(
 ) :
 	position(pos), up(up), pitch(pitch), yaw(yaw), front(glm::vec3(0.0f, 0.0f, -1.0f))
 {
-	setupUbos();
 }
 
 glm::mat4 Camera::getViewMatrix() const
@@ -86,25 +85,13 @@ void Camera::uploadUniforms(Shader& shader)
 
 void Camera::updateUniformBlock()
 {
-	glm::mat4 view = this->getViewMatrix();
-	glm::vec3 position = this->getPosition();
-	glBindBuffer(GL_UNIFORM_BUFFER, this->uboBlock);
-	glBufferSubData(GL_UNIFORM_BUFFER, 0, 64, glm::value_ptr(view));
-	glBufferSubData(GL_UNIFORM_BUFFER, 64, 16, glm::value_ptr(position));
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
+	// std140 layout of the Camera block
+	struct {
+		glm::mat4 view;
+		glm::vec4 position;
+	} block;
+	block.view = this->getViewMatrix();
+	block.position = glm::vec4(this->getPosition(), 1.0f);
+	FrameUniformAllocator::get().upload(CAMERA_UNIFORM_BLOCK_BINDING_POINT, &block, sizeof(block));
 	checkGLError("Camera::updateUniformBlock");
 }
-
-void Camera::setupUbos()
-{
-	int uboSize = sizeof(glm::mat4) + sizeof(glm::vec4);
-	glGenBuffers(1, &this->uboBlock);
-	glBindBuffer(GL_UNIFORM_BUFFER, this->uboBlock);
-	glBufferData(GL_UNIFORM_BUFFER, uboSize, NULL, GL_STATIC_DRAW);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
-	glBindBufferRange(GL_UNIFORM_BUFFER, 1, this->uboBlock, 0, uboSize);
-	checkGLError("Camera::setupUbos");
-
-	this->updateUniformBlock();
-}
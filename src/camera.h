@@ -8,14 +8,15 @@
 #include "glHelper.h"
 #include "shader.h"
 #include "FBOManager.h"
+#include "FrameUniformAllocator.h"
 
 class Camera
 {
+	static const GLuint CAMERA_UNIFORM_BLOCK_BINDING_POINT = 1;
 public:
 	glm::vec3 position;
 	glm::vec3 front;
 	glm::vec3 up;
-	GLuint uboBlock;
 	float yaw;
 	float pitch;
 
@@ -45,12 +46,10 @@ public:
 	void setYaw(float yaw);
 
 	void uploadUniforms(Shader& shader);
+	///<summary>Upload the view and position to the Camera block for the current frame.</summary>
 	void updateUniformBlock();
 
 	void updateVectors(glm::vec3 worldUp);
 
 	~Camera();
-
-private:
-	void setupUbos();
 };
@@ -2,7 +2,7 @@
 
 DebugControl::DebugControl(const char* glsl_version, GLFWwindow* window, Scene* scene, Renderer* renderer) : 
     scene(scene), renderer(renderer), showFrameData(false), showRenderSettings(false),
-    showGBufferTextures(false), showSceneObjects(false), 
+    showGBufferTextures(false), showSceneObjects(false), showTextureCache(false),
     pLightSelected(-1), dLightSelected(-1), modelSelected("")
 {
     IMGUI_CHECKVERSION();
@@ -48,6 +48,10 @@ void DebugControl::onFrame()
     if (this->showSceneObjects) {
         this->displaySceneObjects();
     }
+
+    if (this->showTextureCache) {
+        this->displayTextureCache();
+    }
 }
 
 void DebugControl::render() {
@@ -63,6 +67,7 @@ void DebugControl::displayBaseMenu()
     ImGui::Checkbox("show render settings", &this->showRenderSettings);
     ImGui::Checkbox("Show gBuffer textures", &this->showGBufferTextures);
     ImGui::Checkbox("Show scene objects", &this->showSceneObjects);
+    ImGui::Checkbox("Show texture cache", &this->showTextureCache);
 
     ImGui::End();
 }
@@ -79,6 +84,22 @@ void DebugControl::displayFrameData() {
     if (ImGui::Begin("Frame Data", &this->showFrameData, window_flags)) {
         ImGui::Text("FPS: %.1f (%.3f ms/frame)", io.Framerate, 1000.0f/io.Framerate);
         ImGui::Separator();
+        const CullingStats& cullingStats = this->renderer->getCullingStats();
+        ImGui::Text("Models: %u visible, %u culled", cullingStats.modelsVisible, cullingStats.modelsCulled);
+        ImGui::Text("Meshes: %u visible, %u culled", cullingStats.meshesVisible, cullingStats.meshesCulled);
+        ImGui::Text("Occluded: %u models, %u meshes", cullingStats.modelsOccluded, cullingStats.meshesOccluded);
+        ImGui::Text("Shadow casters: %u drawn, %u culled", cullingStats.shadowCastersVisible, cullingStats.shadowCastersCulled);
+        ImGui::Text("Shadow cube faces: %u drawn, %u culled", cullingStats.shadowFacesRendered, cullingStats.shadowFacesCulled);
+        ImGui::Text("Instanced models: %u visible, %u culled", cullingStats.instancedModelsVisible, cullingStats.instancedModelsCulled);
+        ImGui::Text("Reduced detail: %u meshes, %u shadow casters", cullingStats.meshesReducedLod, cullingStats.shadowMeshesReducedLod);
+        ImGui::Separator();
+        const DrawStats& drawStats = this->renderer->getDrawStats();
+        ImGui::Text("Draw calls: %u, instances: %u, indirect commands: %u", drawStats.drawCalls, drawStats.instancesDrawn, drawStats.indirectCommands);
+        ImGui::Text("Meshlets submitted: %u", drawStats.meshletsSubmitted);
+        ImGui::Text("Binds: %u shaders, %u materials, %u textures, %u vertex arrays", drawStats.shaderBinds, drawStats.materialBinds, drawStats.textureBinds, drawStats.vertexArrayBinds);
+        ImGui::Text("Transform uploads: %u", drawStats.transformUploads);
+        ImGui::Text("Transforms recomputed: %u", drawStats.transformsRecomputed);
+        ImGui::Separator();
         if (ImGui::IsMousePosValid())
             ImGui::Text("Mouse Position: (%.1f,%.1f)", io.MousePos.x, io.MousePos.y);
         else
@@ -95,6 +116,14 @@ void DebugControl::displayRenderSettings() {
     ImVec2 bounds = ImVec2(this->renderer->getNearBound(), this->renderer->getFarBound());
     float fov = this->renderer->getFieldOfView();
     bool drawLights = this->renderer->getDrawLights();
+    bool frustumCulling = this->renderer->getFrustumCulling();
+    bool sortDraws = this->renderer->getSortDraws();
+    bool indirectDraws = this->renderer->getIndirectDraws();
+    bool gpuCulling = this->renderer->getGpuCulling();
+    bool occlusionCulling = this->renderer->getOcclusionCulling();
+    bool lodSelection = this->renderer->getLodSelection();
+    bool meshletCulling = this->renderer->getMeshletCulling();
+    int lightingMode = (int)this->renderer->getLightingMode();
 
     if (ImGui::InputFloat2("Near and Far Bounds", (float*) &bounds)) {
         this->renderer->setNearBound(bounds.x);
@@ -109,6 +138,43 @@ void DebugControl::displayRenderSettings() {
         this->renderer->setDrawLights(drawLights);
     }
 
+    if (ImGui::Checkbox("Frustum Culling", &frustumCulling)) {
+        this->renderer->setFrustumCulling(frustumCulling);
+    }
+
+    if (ImGui::Checkbox("Sort Draws", &sortDraws)) {
+        this->renderer->setSortDraws(sortDraws);
+    }
+
+    if (ImGui::Checkbox("Indirect Draws", &indirectDraws)) {
+        this->renderer->setIndirectDraws(indirectDraws);
+    }
+
+    if (ImGui::Checkbox("GPU Culling", &gpuCulling)) {
+        this->renderer->setGpuCulling(gpuCulling);
+    }
+
+    if (ImGui::Checkbox("Occlusion Culling", &occlusionCulling)) {
+        this->renderer->setOcclusionCulling(occlusionCulling);
+    }
+
+    if (ImGui::Checkbox("Levels of Detail", &lodSelection)) {
+        this->renderer->setLodSelection(lodSelection);
+    }
+
+    if (ImGui::Checkbox("Meshlet Culling", &meshletCulling)) {
+        this->renderer->setMeshletCulling(meshletCulling);
+    }
+
+    const char* lightingModes[] = {
+        getLightingModeName(LightingMode::StencilVolumes),
+        getLightingModeName(LightingMode::InstancedVolumes),
+        getLightingModeName(LightingMode::Clustered)
+    };
+    if (ImGui::Combo("Lighting", &lightingMode, lightingModes, (int)LightingMode::Count)) {
+        this->renderer->setLightingMode((LightingMode)lightingMode);
+    }
+
     ImGui::End();
 }
 
@@ -122,13 +188,43 @@ void DebugControl::displayGBufferTextures()
 	ImVec2 uv_max = ImVec2(0.0f, 0.0f);                 // Lower-right
 	ImVec4 tint_col = ImVec4(1.0f, 1.0f, 1.0f, 1.0f);   // No tint
 	ImVec4 border_col = ImVec4(1.0f, 1.0f, 1.0f, 0.5f); // 50% opaque white
-    ImGui::Image((void*)gBuffer->getPositionTexture(), textureSize, uv_min, uv_max, tint_col, border_col);
+    ImGui::Image((void*)gBuffer->getDepthTexture(), textureSize, uv_min, uv_max, tint_col, border_col);
     ImGui::Image((void*)gBuffer->getNormalTexture(), textureSize, uv_min, uv_max, tint_col, border_col);
     ImGui::Image((void*)gBuffer->getAlbedoSpecTexture(), textureSize, uv_min, uv_max, tint_col, border_col);
 
 	ImGui::End();
 }
 
+void DebugControl::displayTextureCache()
+{
+    if (!ImGui::Begin("Texture Cache", &this->showTextureCache)) {
+        ImGui::End();
+        return;
+    }
+    TextureCache& cache = TextureCache::get();
+    ImGui::Text("Textures: %zu", cache.getTextureCount());
+    ImGui::Text("Memory: %.2f MB", cache.getMemoryUsage() / (1024.0 * 1024.0));
+    ImGui::Text("Hits: %zu, misses: %zu", cache.getHits(), cache.getMisses());
+    ImGui::Separator();
+
+    ImGui::Columns(5, "textures");
+    ImGui::Text("Path"); ImGui::NextColumn();
+    ImGui::Text("Size"); ImGui::NextColumn();
+    ImGui::Text("Format"); ImGui::NextColumn();
+    ImGui::Text("Refs"); ImGui::NextColumn();
+    ImGui::Text("KB"); ImGui::NextColumn();
+    ImGui::Separator();
+    for (const TextureCacheEntry& entry : cache.getEntries()) {
+        ImGui::TextUnformatted(entry.key.c_str()); ImGui::NextColumn();
+        ImGui::Text("%dx%d", entry.width, entry.height); ImGui::NextColumn();
+        ImGui::Text(entry.compressed ? "BC" : "RGBA"); ImGui::NextColumn();
+        ImGui::Text("%d", entry.references); ImGui::NextColumn();
+        ImGui::Text("%zu", entry.bytes / 1024); ImGui::NextColumn();
+    }
+    ImGui::Columns(1);
+    ImGui::End();
+}
+
 void DebugControl::displaySceneObjects()
 {
     ImGui::SetNextWindowSize(ImVec2(430, 450), ImGuiCond_FirstUseEver);
@@ -172,7 +268,7 @@ void DebugControl::displayModel(Model* model) {
     ImGui::Text(model->getName().c_str());
     ImGui::NextColumn();
     if (node_open) {
-        std::string shaderName = this->renderer->getModelShader(model->getName());
+        std::string shaderName = this->scene->getModelShader(model->getName());
         glm::vec3 mPosition = model->getPosition();
         glm::vec3 mRotation = model->getRotation();
         glm::vec3 mScale = model->getScale();
@@ -189,13 +285,13 @@ void DebugControl::displayModel(Model* model) {
         ImGui::TreeNodeEx("Shader", attrFlags);
         ImGui::NextColumn();
 		if (ImGui::BeginCombo("Assigned Shader", shaderName.c_str())) {
-			if (ImGui::Selectable("deferred", (shaderName == "deferred")))
-				this->renderer->removeModelShader(model->getName());
+			if (ImGui::Selectable("Deferred", (shaderName == "Deferred")))
+				this->scene->removeModelShader(model->getName());
 
             for (auto& shaderIt : this->renderer->getShaders()) {
                 const bool is_selected = (shaderName == shaderIt.first);
                 if (ImGui::Selectable(shaderIt.first.c_str(), is_selected))
-                    this->renderer->setModelShader(model->getName(), shaderIt.first);
+                    this->scene->setModelShader(model->getName(), shaderIt.first);
                     //shaderName = shaderIt.first;
 
                 if (is_selected)
@@ -251,15 +347,20 @@ void DebugControl::displayDrawObj(IDrawObj* mesh) {
     if (node_open) {
 		ImGuiTreeNodeFlags attrFlags = ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen | ImGuiTreeNodeFlags_Bullet;
 
-        displayMaterial(mesh->getMaterial());
+        displayMaterial(mesh);
 
         ImGui::TreePop();
     }
     ImGui::PopID();
 }
 
-void DebugControl::displayMaterial(Material* material) {
-    ImGui::PushID(material);
+void DebugControl::displayMaterial(IDrawObj* mesh) {
+    // materials are shared between meshes, edit a copy and give only this mesh the result
+    Material* material = mesh->getMaterial();
+    Material edited = *material;
+    bool changed = false;
+    // the id stays the same when the edit replaces the material, so a drag continues
+    ImGui::PushID("Material");
     ImGui::AlignTextToFramePadding();
     bool node_open = ImGui::TreeNode("Material");
 
@@ -277,47 +378,49 @@ void DebugControl::displayMaterial(Material* material) {
         ImGui::PushID("AmbientColor");
         ImGui::TreeNodeEx("Ambient", attrFlags);
         ImGui::NextColumn();
-        ImGui::ColorEdit4("Color", (float*)&material->AmbientColor);
+        changed |= ImGui::ColorEdit4("Color", (float*)&edited.AmbientColor);
         ImGui::NextColumn();
         ImGui::PopID();
 
         ImGui::PushID("DiffuseColor");
         ImGui::TreeNodeEx("Diffuse", attrFlags);
         ImGui::NextColumn();
-        ImGui::ColorEdit4("Color", (float*) &material->DiffuseColor);
+        changed |= ImGui::ColorEdit4("Color", (float*) &edited.DiffuseColor);
         ImGui::NextColumn();
         ImGui::PopID();
 
         ImGui::PushID("SpecularColor");
         ImGui::TreeNodeEx("Specular", attrFlags);
         ImGui::NextColumn();
-        ImGui::ColorEdit4("Color", (float*) &material->SpecularColor);
+        changed |= ImGui::ColorEdit4("Color", (float*) &edited.SpecularColor);
         ImGui::NextColumn();
         ImGui::PopID();
 
         ImGui::PushID("Shininess");
         ImGui::TreeNodeEx("Shininess", attrFlags);
         ImGui::NextColumn();
-        ImGui::DragFloat("shininess", (float*) &material->Shininess);
+        changed |= ImGui::DragFloat("shininess", (float*) &edited.Shininess);
         ImGui::NextColumn();
         ImGui::PopID();
 
         ImGui::PushID("Opacity");
         ImGui::TreeNodeEx("Opacity", attrFlags);
         ImGui::NextColumn();
-        ImGui::DragFloat("opacity", (float*) &material->Opacity);
+        changed |= ImGui::DragFloat("opacity", (float*) &edited.Opacity);
         ImGui::NextColumn();
         ImGui::PopID();
 
         ImGui::PushID("Reflectivity");
         ImGui::TreeNodeEx("Reflectivity", attrFlags);
         ImGui::NextColumn();
-        ImGui::DragFloat("reflectivity", (float*) &material->Reflectivity);
+        changed |= ImGui::DragFloat("reflectivity", (float*) &edited.Reflectivity);
         ImGui::NextColumn();
         ImGui::PopID();
 
         ImGui::TreePop();
     }
+    if (changed)
+        mesh->setMaterial(MaterialManager::get().intern(edited));
     ImGui::PopID();
 }
 
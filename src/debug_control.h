@@ -24,13 +24,15 @@ private:
 
 	void displayGBufferTextures();
 
+	void displayTextureCache();
+
 	void displaySceneObjects();
 
 	void displayModel(Model* model);
 
 	void displayDrawObj(IDrawObj* mesh);
 
-	void displayMaterial(Material* material);
+	void displayMaterial(IDrawObj* mesh);
 
 	void displayPointLightControl(int pointLightIndex);
 
@@ -41,7 +43,7 @@ private:
 
 	//ImGuiIO& io;
 
-	bool showFrameData, showGBufferTextures, showSceneObjects, showRenderSettings;
+	bool showFrameData, showGBufferTextures, showSceneObjects, showRenderSettings, showTextureCache;
 	int pLightSelected, dLightSelected;
 	std::string modelSelected;
 };
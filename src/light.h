@@ -22,10 +22,33 @@
 #include "ShadowMap.h"
 #include "ShadowCubeMap.h"
 
+///<summary>A point light as laid out in the std140 Lights uniform block.</summary>
+struct PointLightBlock {
+	float ambient, diffuse, specular, constant, linear, quadratic;
+	float padding[2];
+	glm::vec4 color;
+	glm::vec4 position;
+};
+
+///<summary>A spot light as laid out in the std140 Lights uniform block.</summary>
+struct SpotLightBlock {
+	glm::vec4 color;
+	glm::vec4 position;
+	glm::vec4 direction;
+	float ambient, diffuse, specular, constant, linear, quadratic, cutOff, outerCutOff;
+};
+
+///<summary>A direction light as laid out in the std140 Lights uniform block.</summary>
+struct DirectionLightBlock {
+	float ambient, diffuse, specular;
+	float padding;
+	glm::vec4 color;
+	glm::vec4 direction;
+};
+
 class ILight {
 public:
 	virtual void uploadUniforms(const Shader& shader) const = 0;
-	virtual GLuint updateUniformBlock(GLuint ubo, GLuint start) = 0;
 };
 
 class Light: public ILight
@@ -40,23 +63,29 @@ class Light: public ILight
 		);
         /*  Model Data */
 		const glm::vec3 getColor() const { return this->color; }
-		void setColor(const glm::vec3& color) { this->color = color; }
+		void setColor(const glm::vec3& color) { this->color = color; this->dirty = true; }
 		const float getAmbient() const { return this->ambient; }
-		void setAmbient(const float& ambient) { this->ambient = ambient; }
+		void setAmbient(const float& ambient) { this->ambient = ambient; this->dirty = true; }
 		const float getDiffuse() const { return this->diffuse; }
-		void setDiffuse(const float& diffuse) { this->diffuse = diffuse; }
+		void setDiffuse(const float& diffuse) { this->diffuse = diffuse; this->dirty = true; }
 		const float getSpecular() const { return this->specular; }
-		void setSpecular(const float& specular) { this->specular = specular; }
+		void setSpecular(const float& specular) { this->specular = specular; this->dirty = true; }
+
+		///<summary>Whether a setter changed the light since the LightManager last uploaded it.</summary>
+		bool isDirty() const { return this->dirty; }
+		void clearDirty() { this->dirty = false; }
 		
 		virtual void uploadUniforms(const Shader& shader) const = 0;
-		virtual GLuint updateUniformBlock(GLuint ubo, GLuint start) = 0;
 
     protected:
+		bool dirty = true;
 		glm::vec3 color;
 		float ambient;
 		float diffuse;
 		float specular;
 		const std::string prefix;
+		// handles to the uniforms of this light, built from the prefix once
+		Uniform ambientUniform, diffuseUniform, specularUniform, colorUniform;
 		GLuint shadowFBO;
 		Texture shadowTexture;
 };
@@ -78,13 +107,13 @@ class PointLight : public Light
 		);
 
 		const float getConstant() const { return this->constant; }
-		void setConstant(const float constant) { this->constant = constant; }
+		void setConstant(const float constant) { this->constant = constant; this->dirty = true; }
 		const float getLinear() const { return this->linear; };
-		void setLinear(const float linear) { this->linear = linear; }
+		void setLinear(const float linear) { this->linear = linear; this->dirty = true; }
 		const float getQuadratic() const { return this->quadratic; }
-		void setQuadratic(const float quadratic) { this->quadratic = quadratic; }
+		void setQuadratic(const float quadratic) { this->quadratic = quadratic; this->dirty = true; }
 		const glm::vec3 getPosition() { return this->position; }
-		void setPosition(const glm::vec3 position) { this->position = position; }
+		void setPosition(const glm::vec3 position) { this->position = position; this->dirty = true; }
 		const Model* getModel() { return this->model; }
 		void setModel(Model* model) { this->model = model; }
 
@@ -94,11 +123,13 @@ class PointLight : public Light
 		const float getRadius();
 
 		void uploadUniforms(const Shader& shader) const;
-		GLuint updateUniformBlock(GLuint ubo, GLuint start);
+		///<summary>Write the light into its slot of the Lights uniform block mirror.</summary>
+		void packBlock(PointLightBlock& block) const;
 
 protected:
 	float constant, linear, quadratic;
 	glm::vec3 position;
+	Uniform constantUniform, linearUniform, quadraticUniform, positionUniform;
 	Model* model;
 	std::map<std::string, std::function<void(PointLight*)>> updateFuncs;
 };
@@ -117,13 +148,15 @@ class DirectionLight : public Light
 
 		glm::vec3 getDirection() const { return this->direction; }
 		const glm::vec3& getDirectionRef() const { return this->direction; }
-		void setDirection(glm::vec3 direction) { this->direction = direction; }
+		void setDirection(glm::vec3 direction) { this->direction = direction; this->dirty = true; }
 
 		void uploadUniforms(const Shader& shader) const;
-		GLuint updateUniformBlock(GLuint ubo, GLuint start);
+		///<summary>Write the light into its slot of the Lights uniform block mirror.</summary>
+		void packBlock(DirectionLightBlock& block) const;
 
 protected:
         glm::vec3 direction;
+		Uniform directionUniform;
 		std::map<std::string, std::function<void(DirectionLight*)>> updateFuncs;
 };
 
@@ -150,19 +183,21 @@ class SpotLight : public PointLight
 		);
 
 		glm::vec3 getDirection() const { return this->direction; }
-		void setDirection(glm::vec3 direction) { this->direction = direction; }
+		void setDirection(glm::vec3 direction) { this->direction = direction; this->dirty = true; }
 
 		float getCutOff() const { return this->cutOff; }
-		void setCutOff(float cutOff) { this->cutOff = cutOff; }
+		void setCutOff(float cutOff) { this->cutOff = cutOff; this->dirty = true; }
 
 		float getOuterCutOff() const { return this->outerCutOff; }
-		void setOuterCutOff(float outerCutOff) { this->outerCutOff = outerCutOff; }
+		void setOuterCutOff(float outerCutOff) { this->outerCutOff = outerCutOff; this->dirty = true; }
 
 		void uploadUniforms(const Shader& shader) const;
 
-		GLuint updateUniformBlock(GLuint ubo, GLuint start) override;
+		///<summary>Write the light into its slot of the Lights uniform block mirror.</summary>
+		void packBlock(SpotLightBlock& block) const;
 
 private:
+	Uniform directionUniform, cutOffUniform, outerCutOffUniform;
 	std::map<std::string, std::function<void(SpotLight*)>> updateFuncs;
 };
 
@@ -7,6 +7,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string>
 #include <iostream>
 
 #include <glad/glad.h>
@@ -25,6 +26,9 @@
 #include "Icosphere.h"
 #include "scenes.h"
 #include "debug_control.h"
+#include "Benchmark.h"
+#include "TextureCompressor.h"
+#include "GeometryArena.h"
 
 
 // opengl function for handling debug output
@@ -81,6 +85,7 @@ typedef struct
 	Renderer render;
 	Scene* scene;
     DebugControl* debugControl;
+    AssetLoader* loader;
     int id;
 } Slot;
 
@@ -417,10 +422,202 @@ static void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     slot->render.setDimensions(width, height);
 }
 
+typedef struct
+{
+    bool benchmark;
+    bool headless;
+    int contextApi;
+    int width;
+    int height;
+    std::string scene;
+    int stressCount;
+    bool instancedStress;
+    bool textureCompression;
+    bool indirectDraws;
+    bool gpuCulling;
+    bool occlusionCulling;
+    LightingMode lightingMode;
+    bool lightSweep;
+    bool packedVertices;
+    bool positionStreams;
+    bool lodSelection;
+    bool meshletCulling;
+    BenchmarkOptions benchmarkOptions;
+} LaunchOptions;
+
+static void print_usage(const char* program)
+{
+    printf("usage: %s [options]\n", program);
+    printf("  --benchmark <frames>      render a fixed number of frames and write timings as JSON\n");
+    printf("  --warmup <frames>         frames rendered before timing starts (default 30)\n");
+    printf("  --headless                do not show a window, implies --benchmark\n");
+    printf("  --context <api>           context creation api: native, egl or osmesa\n");
+    printf("  --size <width>x<height>   framebuffer size (default 1024x1024)\n");
+    printf("  --scene <name>            basic, stress:<count> or instanced:<count> (default basic)\n");
+    printf("  --out <file>              file the benchmark report is written to (default stdout)\n");
+    printf("  --no-texture-compression  upload textures uncompressed\n");
+    printf("  --no-indirect             draw every mesh with its own draw call\n");
+    printf("  --gpu-culling             cull the indirect draws with a compute shader\n");
+    printf("  --no-occlusion            do not cull models hidden behind the last frame's depth\n");
+    printf("  --lighting <mode>         deferred point lights: stencil, instanced or clustered (default clustered)\n");
+    printf("  --light-sweep             benchmark every lighting mode with 16, 128 and 1024 point lights\n");
+    printf("  --packed-vertices         store meshes in the 20 byte quantized vertex format\n");
+    printf("  --no-position-stream      draw depth and shadow passes through the full vertex format\n");
+    printf("  --no-lod                  draw every mesh at full detail\n");
+    printf("  --no-meshlets             cull large meshes as a whole instead of per meshlet\n");
+}
+
+static bool parse_options(int argc, char** argv, LaunchOptions& options)
+{
+    options.benchmark = false;
+    options.headless = false;
+    options.contextApi = GLFW_NATIVE_CONTEXT_API;
+    options.width = 1024;
+    options.height = 1024;
+    options.scene = "basic";
+    options.stressCount = 0;
+    options.instancedStress = false;
+    options.textureCompression = true;
+    options.indirectDraws = true;
+    options.gpuCulling = false;
+    options.occlusionCulling = true;
+    options.lightingMode = LightingMode::Clustered;
+    options.lightSweep = false;
+    options.packedVertices = false;
+    options.positionStreams = true;
+    options.lodSelection = true;
+    options.meshletCulling = true;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--benchmark" && hasValue) {
+            options.benchmark = true;
+            int frames;
+            if (sscanf(argv[++i], "%d", &frames) != 1 || frames < 1) {
+                fprintf(stderr, "invalid frame count %s\n", argv[i]);
+                return false;
+            }
+            options.benchmarkOptions.frames = frames;
+        }
+        else if (arg == "--warmup" && hasValue) {
+            int warmupFrames;
+            if (sscanf(argv[++i], "%d", &warmupFrames) != 1 || warmupFrames < 0) {
+                fprintf(stderr, "invalid warmup frame count %s\n", argv[i]);
+                return false;
+            }
+            options.benchmarkOptions.warmupFrames = warmupFrames;
+        }
+        else if (arg == "--headless") {
+            options.headless = true;
+            options.benchmark = true;
+        }
+        else if (arg == "--context" && hasValue) {
+            std::string api = argv[++i];
+            if (api == "native")
+                options.contextApi = GLFW_NATIVE_CONTEXT_API;
+            else if (api == "egl")
+                options.contextApi = GLFW_EGL_CONTEXT_API;
+            else if (api == "osmesa")
+                options.contextApi = GLFW_OSMESA_CONTEXT_API;
+            else {
+                fprintf(stderr, "unknown context api %s\n", api.c_str());
+                return false;
+            }
+        }
+        else if (arg == "--size" && hasValue) {
+            if (sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2 || options.width <= 0 || options.height <= 0) {
+                fprintf(stderr, "invalid size %s\n", argv[i]);
+                return false;
+            }
+        }
+        else if (arg == "--scene" && hasValue) {
+            options.scene = argv[++i];
+            if (options.scene.rfind("stress", 0) == 0 || options.scene.rfind("instanced", 0) == 0) {
+                size_t colon = options.scene.find(':');
+                options.stressCount = colon == std::string::npos ? 256 : atoi(options.scene.c_str() + colon + 1);
+                options.instancedStress = options.scene.rfind("instanced", 0) == 0;
+            }
+            else if (options.scene != "basic") {
+                fprintf(stderr, "unknown scene %s\n", options.scene.c_str());
+                return false;
+            }
+        }
+        else if (arg == "--out" && hasValue) {
+            options.benchmarkOptions.outputPath = argv[++i];
+        }
+        else if (arg == "--no-texture-compression") {
+            options.textureCompression = false;
+        }
+        else if (arg == "--no-indirect") {
+            options.indirectDraws = false;
+        }
+        else if (arg == "--gpu-culling") {
+            options.gpuCulling = true;
+        }
+        else if (arg == "--no-occlusion") {
+            options.occlusionCulling = false;
+        }
+        else if (arg == "--lighting" && hasValue) {
+            std::string mode = argv[++i];
+            int index = 0;
+            while (index < (int)LightingMode::Count && mode != getLightingModeName((LightingMode)index))
+                index++;
+            if (index == (int)LightingMode::Count) {
+                fprintf(stderr, "unknown lighting mode %s\n", mode.c_str());
+                return false;
+            }
+            options.lightingMode = (LightingMode)index;
+        }
+        else if (arg == "--light-sweep") {
+            options.benchmark = true;
+            options.lightSweep = true;
+        }
+        else if (arg == "--packed-vertices") {
+            options.packedVertices = true;
+        }
+        else if (arg == "--no-position-stream") {
+            options.positionStreams = false;
+        }
+        else if (arg == "--no-lod") {
+            options.lodSelection = false;
+        }
+        else if (arg == "--no-meshlets") {
+            options.meshletCulling = false;
+        }
+        else {
+            print_usage(argv[0]);
+            return false;
+        }
+    }
+    options.benchmarkOptions.sceneName = options.scene;
+    return true;
+}
+
+static void setup_scene(Slot& slot, const LaunchOptions& options)
+{
+    if (options.stressCount > 0 && options.instancedStress)
+        setupInstanced(slot.scene, &slot.render, slot.loader, options.stressCount);
+    else if (options.stressCount > 0)
+        setupStress(slot.scene, &slot.render, slot.loader, options.stressCount);
+    else
+        setupBasic(slot.scene, &slot.render, slot.loader);
+}
+
 int main(int argc, char** argv)
 {
+    LaunchOptions options;
+    if (!parse_options(argc, argv, options))
+        exit(EXIT_FAILURE);
+
     // initialize glfw
     glfwSetErrorCallback(glfw_error_callback);
+#ifdef GLFW_PLATFORM_NULL
+    // without a display server the null platform can still create egl and osmesa contexts
+    if (options.headless && options.contextApi != GLFW_NATIVE_CONTEXT_API)
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
     if (!glfwInit())
         exit(EXIT_FAILURE);
 
@@ -433,19 +630,25 @@ int main(int argc, char** argv)
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     //glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, true);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, !options.benchmark);
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, options.contextApi);
+    if (options.headless)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     size_t width, height;
     GLFWmonitor* monitor = glfwGetPrimaryMonitor();
 
-	const GLFWvidmode* mode = glfwGetVideoMode(monitor);
-	glfwWindowHint(GLFW_REFRESH_RATE, mode->refreshRate);
-	glfwWindowHint(GLFW_RED_BITS, mode->redBits);
-	glfwWindowHint(GLFW_GREEN_BITS, mode->greenBits);
-	glfwWindowHint(GLFW_BLUE_BITS, mode->blueBits);
+    // there may be no monitor when running headless
+    if (monitor) {
+        const GLFWvidmode* mode = glfwGetVideoMode(monitor);
+        glfwWindowHint(GLFW_REFRESH_RATE, mode->refreshRate);
+        glfwWindowHint(GLFW_RED_BITS, mode->redBits);
+        glfwWindowHint(GLFW_GREEN_BITS, mode->greenBits);
+        glfwWindowHint(GLFW_BLUE_BITS, mode->blueBits);
+    }
 
-	width = 1024;
-	height = 1024;
+	width = options.width;
+	height = options.height;
 	//Create the window
     GLFWwindow* window = glfwCreateWindow(width, height, "Simple example", NULL, NULL);
     if (!window)
@@ -465,6 +668,10 @@ int main(int argc, char** argv)
     }
     std::cout << "Loaded OpenGL " << GLVersion.major << "." << GLVersion.minor << std::endl;
     std::cout << "opengl version: " << glGetString(GL_VERSION) << std::endl;
+    TextureCompressor::detectSupport();
+    TextureCompressor::setEnabled(options.textureCompression);
+    GeometryArena::setPackedVertices(options.packedVertices);
+    GeometryArena::setPositionStreams(options.positionStreams);
 
 	// initialize debug output must be after glad has been loaded
 	GLint flags; glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
@@ -493,10 +700,33 @@ int main(int argc, char** argv)
 	//slot.render.setTBM(tbm);
 	GBuffer* gBuffer = new GBuffer(width, height);
 	slot.render.setGBuffer(gBuffer);
+    slot.render.setIndirectDraws(options.indirectDraws);
+    slot.render.setGpuCulling(options.gpuCulling);
+    slot.render.setOcclusionCulling(options.occlusionCulling);
+    slot.render.setLodSelection(options.lodSelection);
+    slot.render.setMeshletCulling(options.meshletCulling);
+    slot.render.setLightingMode(options.lightingMode);
     slot.id = 0;
+    slot.loader = new AssetLoader();
 
     //create callbacks
     glfwSetWindowUserPointer(window, &slot);
+    glfwSetFramebufferSizeCallback(slot.window, framebuffer_size_callback);
+
+    if (options.benchmark) {
+        setup_scene(slot, options);
+
+        // every run should time the same fully loaded scene
+        slot.loader->waitIdle();
+        int result = options.lightSweep
+            ? runLightSweep(slot.window, &slot.render, slot.scene, options.benchmarkOptions)
+            : runBenchmark(slot.window, &slot.render, slot.scene, options.benchmarkOptions);
+        delete slot.loader;
+
+        glfwDestroyWindow(slot.window);
+        glfwTerminate();
+        return result;
+    }
 
     glfwSetMonitorCallback(monitor_callback);
     glfwSetKeyCallback(slot.window, key_callback);
@@ -509,13 +739,12 @@ int main(int argc, char** argv)
     glfwSetWindowPosCallback(slot.window, window_position_callback);
     glfwSetMouseButtonCallback(slot.window, mouse_button_callback);
     glfwSetScrollCallback(slot.window, scroll_callback);
-    glfwSetFramebufferSizeCallback(slot.window, framebuffer_size_callback);
 
     // this needs to be below other callbacks. it chains callbacks
     slot.debugControl = new DebugControl(glsl_version, slot.window, slot.scene, &slot.render);
 
     // load stuff into the scene
-    setupBasic(slot.scene, &slot.render);
+    setup_scene(slot, options);
 
     float lastTime = glfwGetTime();
     float lastPrint = lastTime;
@@ -540,6 +769,9 @@ int main(int argc, char** argv)
         }
         counter.push(elapsedTime);
 
+		// add models that finished loading in the background
+		slot.loader->processUploads();
+
 		slot.render.setTime(currentTime);
 		slot.render.preRender(slot.scene);
 		slot.render.render(slot.scene);
@@ -565,6 +797,7 @@ int main(int argc, char** argv)
     }
 
     delete slot.debugControl;
+    delete slot.loader;
 
     glfwDestroyWindow(slot.window);
 
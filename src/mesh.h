@@ -10,11 +10,14 @@
 #include <sstream>
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <cstdint>
 
 #include "shader.h"
 #include "glHelper.h"
 #include "vertexData.h"
 #include "DrawObj.h"
+#include "MeshletBuilder.h"
 
 class Mesh : public IDrawObj {
     public:
@@ -22,110 +25,51 @@ class Mesh : public IDrawObj {
         /*  Functions  */
         // constructor and destructor
 		~Mesh() {
-			glDeleteVertexArrays(1, &VAO);
+			GeometryArena::get().free(this->lods[0]);
+			for (size_t i = 1; i < this->lods.size(); i++)
+				GeometryArena::get().freeIndices(this->lods[i]);
 		}
 
 		// custom constructors
-        Mesh(std::vector<VertexData> vertices, std::vector<GLuint> indices, std::string name, Material* material = new Material()):
-			vertices(vertices), indices(indices), IDrawObj(name, material)
-        {
-            // vertex array object
-            glGenVertexArrays(1, &VAO);
-            glBindVertexArray(VAO);
-
-            // load data into vertex buffers
-			// copy vertex buffer data
-            glGenBuffers(1, &VBO);
-            glBindBuffer(GL_ARRAY_BUFFER, VBO);
-            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(VertexData), &vertices.front(), GL_STATIC_DRAW);  
-
-			// copy index buffer data
-            glGenBuffers(1, &EBO);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices.front(), GL_STATIC_DRAW);
-            checkGLError("setupMesh buffers");
-
-            // set the vertex attribute pointers for shader
-            glEnableVertexAttribArray(0); // vertex positions
-            glEnableVertexAttribArray(1); // vertex normals	
-            glEnableVertexAttribArray(2); // vertex UVs (texture coords)
-            glEnableVertexAttribArray(3); // vertex tangent
-            glEnableVertexAttribArray(4); // vertex biTangent
-            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)0);
-            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)offsetof(VertexData, Normal));
-            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)offsetof(VertexData, uv));
-            glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)offsetof(VertexData, Tangent));
-            glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData), (void*)offsetof(VertexData, Bitangent));
-            
-            checkGLError("setupMesh attribs");
-			// cleanup
-            glBindVertexArray(0);
-			glDeleteBuffers(1, &VBO);
-			glDeleteBuffers(1, &EBO);
-        }
+        Mesh(const std::vector<VertexData>& vertices, const std::vector<GLuint>& indices, std::string name, Material* material = MaterialManager::get().intern(Material())):
+			Mesh(vertices.data(), vertices.size(), indices.data(), indices.size(), name, material)
+		{
+		}
 
-        // render the mesh
-        void Draw(const Shader& shader, GLuint baseUnit = 0) 
+		// upload vertex data that is not owned by the mesh, such as a mapped cache file. Nothing is kept on the CPU.
+		// lodIndexCounts splits the indices into levels of detail stored one after another, the full mesh first. Empty if there is only the full mesh.
+		// meshlets split the full mesh for finer culling, empty to cull it as a whole.
+		Mesh(const VertexData* vertices, size_t vertexCount, const GLuint* indices, size_t indexCount, std::string name, Material* material = MaterialManager::get().intern(Material()),
+			const std::vector<uint32_t>& lodIndexCounts = std::vector<uint32_t>(), const std::vector<Meshlet>& meshlets = std::vector<Meshlet>()):
+			IDrawObj(name, material)
         {
-            // bind appropriate textures
-			GLuint unit = baseUnit;
-			GLuint ambientNr = 0;
-			GLuint diffuseNr = 0;
-			GLuint specularNr = 0;
-			GLuint normalNr = 0;
-			GLuint heightNr = 0;
-			GLuint reflectNr = 0;
-			for (GLuint &texture : this->material->textureAmbient)
-			{
-                glActiveTexture(GL_TEXTURE0 + unit);
-                glBindTexture(GL_TEXTURE_2D, texture);
-				shader.setInt("material.texture_ambient" + (ambientNr++ > 0 ? std::to_string(ambientNr) : ""), unit++);
-			}
-			for (GLuint &texture : this->material->textureDiffuse)
-			{
-                glActiveTexture(GL_TEXTURE0 + unit);
-                glBindTexture(GL_TEXTURE_2D, texture);
-				shader.setInt("material.texture_diffuse" + (diffuseNr++ > 0 ? std::to_string(diffuseNr) : ""), unit++);
+			this->bounds = Bounds::fromPoints(vertices, vertexCount, sizeof(VertexData));
+			// suballocate the vertices and indices from the buffers shared by every mesh
+			size_t fullIndexCount = lodIndexCounts.empty() ? indexCount : lodIndexCounts[0];
+			this->lods.push_back(GeometryArena::get().allocateMesh(vertices, vertexCount, indices, fullIndexCount));
+			GeometryArena::get().allocateMeshlets(this->lods[0], meshlets.data(), meshlets.size());
+			// the levels of detail only have indices of their own
+			size_t firstIndex = fullIndexCount;
+			for (size_t i = 1; i < lodIndexCounts.size() && firstIndex + lodIndexCounts[i] <= indexCount; i++) {
+				this->lods.push_back(GeometryArena::get().allocateIndices(this->lods[0], indices + firstIndex, lodIndexCounts[i]));
+				firstIndex += lodIndexCounts[i];
 			}
-			for (GLuint &texture : this->material->textureSpecular)
-			{
-                glActiveTexture(GL_TEXTURE0 + unit);
-                glBindTexture(GL_TEXTURE_2D, texture);
-				shader.setInt("material.texture_specular" + (specularNr++ > 0 ? std::to_string(specularNr) : ""), unit++);
-			}
-			for (GLuint &texture : this->material->textureNormal)
-			{
-                glActiveTexture(GL_TEXTURE0 + unit);
-                glBindTexture(GL_TEXTURE_2D, texture);
-				shader.setInt("material.texture_normal" + (normalNr++ > 0 ? std::to_string(normalNr) : ""), unit++);
-			}
-			for (GLuint &texture : this->material->textureReflect)
-			{
-                glActiveTexture(GL_TEXTURE0 + unit);
-                glBindTexture(GL_TEXTURE_2D, texture);
-				shader.setInt("material.texture_reflect" + (reflectNr++ > 0 ? std::to_string(reflectNr) : ""), unit++);
-			}
-			checkGLError("Mesh::Draw bind textures");
-
-			// set material coefficiants
-			shader.setVec4("material.ambient", this->material->AmbientColor);
-			shader.setVec4("material.diffuse", this->material->DiffuseColor);
-			shader.setVec4("material.specular", this->material->SpecularColor);
-			shader.setFloat("material.shininess", this->material->Shininess);
-			shader.setFloat("material.opacity", this->material->Opacity);
-			shader.setFloat("material.reflectivity", this->material->Reflectivity);
-			shader.setFloat("material.refractionIndex", this->material->RefractionIndex);
-			checkGLError("Mesh::Draw bind constants");
+            checkGLError("setupMesh buffers");
+        }
 
-            // draw mesh
-            glBindVertexArray(VAO);
-            glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        GLuint getVertexArray() { return GeometryArena::get().getVertexArray(); }
+        GLuint getDepthVertexArray() { return GeometryArena::get().getDepthVertexArray(); }
+        const GeometryRange* getGeometry(size_t lod = 0) { return &this->lods[std::min(lod, this->lods.size() - 1)]; }
+        size_t getLodCount() { return this->lods.size(); }
 
-			for (int i = baseUnit; i <= unit; i++) {
-				glActiveTexture(GL_TEXTURE0 + unit);
-				glBindTexture(GL_TEXTURE_2D, 0);
-			}
-            checkGLError("Mesh::Draw draw VAO");
+        void drawGeometry(GLsizei instanceCount = 1, size_t lod = 0)
+        {
+            const GeometryRange& geometry = *this->getGeometry(lod);
+            if (instanceCount == 1)
+                glDrawElementsBaseVertex(GL_TRIANGLES, geometry.indexCount, GL_UNSIGNED_INT, geometry.getIndexOffset(), geometry.baseVertex);
+            else
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, geometry.indexCount, GL_UNSIGNED_INT, geometry.getIndexOffset(), instanceCount, geometry.baseVertex);
+            checkGLError("Mesh::drawGeometry");
         }
 
     private:
@@ -134,7 +78,6 @@ class Mesh : public IDrawObj {
 		Mesh & operator = (Mesh const &) = delete;
 
         /*  Render data  */
-        GLuint VAO, VBO, EBO;
-        std::vector<VertexData> vertices;
-        std::vector<GLuint> indices;
+        // the full mesh followed by its levels of detail, which share its vertices
+        std::vector<GeometryRange> lods;
 };
@@ -1,39 +1,112 @@
 #include "model.h"
 
+static const Uniform modelUniform("Model");
+static const Uniform normalUniform("Normal");
+
 /*  Functions   */
 // constructor, expects a filepath to a 3D model.
 Model::Model(
 	std::string name,
 	std::string const path,
 	unsigned int assimp_flags
-) : name(name), position(glm::vec3(0)), scale(glm::vec3(1)), rotation(glm::vec3(0)), isTransparent(false)
+) : name(name), isTransparent(false)
+{
+	this->directory = Model::getDirectory(path);
+
+	ModelData data;
+	if (Model::loadModelData(path, assimp_flags, data)) {
+		this->createMeshes(data);
+	}
+	this->computeBounds();
+}
+
+Model::Model(
+	std::string name,
+	const std::string& directory,
+	const ModelData& data
+) : name(name), directory(directory), isTransparent(false)
+{
+	this->createMeshes(data);
+	this->computeBounds();
+}
+
+Model::~Model()
+{
+	TransformSystem::get().destroy(this->transform);
+	// the meshes release their materials before the textures those reference
+	this->meshes.clear();
+	for (GLuint texture : this->textures) {
+		TextureCache::get().release(texture);
+	}
+}
+
+bool Model::loadModelData(const std::string& path, unsigned int assimp_flags, ModelData& data)
 {
+	unsigned int flags = aiProcess_Triangulate | aiProcess_CalcTangentSpace | assimp_flags;
+
+	// only run the importer if there is no up to date cache entry
+	if (MeshCache::load(path, flags, data))
+		return true;
+
 	Assimp::Importer importer;
-	const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_CalcTangentSpace | assimp_flags);
+	const aiScene* scene = importer.ReadFile(path, flags);
 	// check for errors
 	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
 	{
 		if (!scene) fprintf(stderr, "%s\n", importer.GetErrorString());
+		return false;
 	}
-	else {
-		processNode(path.substr(0, path.find_last_of("/")), scene->mRootNode, scene);
-	}
+	processMaterials(scene, data);
+	processNode(scene->mRootNode, scene, data);
+	MeshCache::save(path, flags, data);
+	return true;
+}
+
+std::string Model::getDirectory(const std::string& path)
+{
+	return path.substr(0, path.find_last_of("/"));
 }
 
 Model::Model(
 	std::string name,
 	std::vector<std::unique_ptr<IDrawObj>>& meshes
-) : name(name), position(glm::vec3(0)), scale(glm::vec3(1)), rotation(glm::vec3(0)), isTransparent(false)
+) : name(name), isTransparent(false)
 {
 	std::move(meshes.begin(), meshes.end(), std::back_inserter(this->meshes));
+	this->computeBounds();
 }
 
 Model::Model(
 	std::string name,
 	std::unique_ptr<IDrawObj> mesh
-) : name(name), position(glm::vec3(0)), scale(glm::vec3(1)), rotation(glm::vec3(0)), isTransparent(false)
+) : name(name), isTransparent(false)
 {
 	this->meshes.push_back(std::move(mesh));
+	this->computeBounds();
+}
+
+void Model::computeBounds()
+{
+	this->bounds = Bounds();
+	this->boundsVersion = 0;
+	for (const std::unique_ptr<IDrawObj>& mesh : this->meshes) {
+		this->bounds.expand(mesh->getBounds());
+		this->boundsVersion += mesh->getBoundsVersion();
+	}
+	// a single mesh keeps its tighter sphere
+	if (this->meshes.size() == 1)
+		this->bounds = this->meshes[0]->getBounds();
+}
+
+void Model::refreshBounds()
+{
+	// mesh versions only grow, so the sum changes whenever any of them does
+	uint32_t version = 0;
+	for (const std::unique_ptr<IDrawObj>& mesh : this->meshes) {
+		version += mesh->getBoundsVersion();
+	}
+	if (version != this->boundsVersion)
+		this->computeBounds();
 }
 
 // draws the model, and thus all its meshes
@@ -43,23 +116,22 @@ void Model::Draw(const Shader& shader, GLuint baseUnit)
 	for (unsigned int i = 0; i < meshes.size(); i++)
 		meshes[i]->Draw(shader, baseUnit);
 }
+void Model::DrawDepth()
+{
+	for (unsigned int i = 0; i < meshes.size(); i++)
+		meshes[i]->DrawDepth();
+}
 void Model::uploadUniforms(const Shader& shader)
 {
 	checkGLError("Model::uploadUniforms -- start");
 	shader.Use();
-	glm::mat4 model = glm::mat4(1.0f);
-	model = glm::translate(model, this->position);
-	//rotate x
-	model = glm::rotate(model, glm::radians(this->rotation.x), glm::vec3(1.0, 0.0, 0.0));
-	//rotate y
-	model = glm::rotate(model, glm::radians(this->rotation.y), glm::vec3(0.0, 1.0, 0.0));
-	//rotate z
-	model = glm::rotate(model, glm::radians(this->rotation.z), glm::vec3(0.0, 0.0, 1.0));
-	model = glm::scale(model, this->scale);
-	glm::mat3 normal = glm::inverseTranspose(glm::mat3(model));
-
-	shader.setMat4("Model", model);
-	shader.setMat3("Normal", normal);
+	Model::uploadUniforms(shader, this->getModelMatrix(), this->getNormalMatrix());
+}
+
+void Model::uploadUniforms(const Shader& shader, const glm::mat4& model, const glm::mat3& normal)
+{
+	shader.setMat4(modelUniform, model);
+	shader.setMat3(normalUniform, normal);
 	checkGLError("Model::uploadUniforms -- end");
 }
 
@@ -75,7 +147,7 @@ const std::vector<IDrawObj*> Model::getMeshes()
 /*  Functions   */
 
 // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-void Model::processNode(std::string const &path, aiNode *node, const aiScene *scene)
+void Model::processNode(aiNode *node, const aiScene *scene, ModelData& data)
 {
 	// process each mesh located at the current node
 	for (unsigned int i = 0; i < node->mNumMeshes; i++)
@@ -83,21 +155,22 @@ void Model::processNode(std::string const &path, aiNode *node, const aiScene *sc
 		// the node object only contains indices to index the actual objects in the scene. 
 		// the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
 		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		processMesh(path, mesh, scene);
+		data.meshes.push_back(processMesh(mesh, data));
 	}
 	// after we've processed all of the meshes (if any) we then recursively process each of the children nodes
 	for (unsigned int i = 0; i < node->mNumChildren; i++)
 	{
-		processNode(path, node->mChildren[i], scene);
+		processNode(node->mChildren[i], scene, data);
 	}
 }
 
-void Model::processMesh(std::string const &path, aiMesh *mesh, const aiScene *scene)
+MeshData Model::processMesh(aiMesh *mesh, const ModelData& data)
 {
 	// data to fill
 	std::vector<VertexData> vertices;
 	std::vector<GLuint> indices;
-	std::string name;
+	vertices.reserve(mesh->mNumVertices);
+	indices.reserve(mesh->mNumFaces * 3);
 
 	// Walk through each of the mesh's vertices
 	for (unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -149,130 +222,152 @@ void Model::processMesh(std::string const &path, aiMesh *mesh, const aiScene *sc
 		}
 	}
 
-	name = mesh->mName.C_Str();
+	MeshData meshData;
+	meshData.name = mesh->mName.C_Str();
+	if (meshData.name == "") {
+		meshData.name = "mesh_" + std::to_string(data.meshes.size());
+	}
 
-	// process materials
-	aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+	// reorder for the vertex cache and fetch before the mesh is cached, so it only runs on import
+	MeshOptimizerReport report = MeshOptimizer::optimize(vertices, indices);
+	printf("optimized mesh %s: %zu -> %zu vertices, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+		meshData.name.c_str(), report.verticesBefore, report.verticesAfter,
+		report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr);
+	meshData.materialIndex = mesh->mMaterialIndex;
 
-	// load in the coeficients.
-	Material* mat = new Material();
-	float shininess, opacity, reflectivity, refractionIndex;
-	aiColor4D ambientColor, diffuseColor, specularColor;
-	aiString mat_name;
-	if (AI_SUCCESS == aiGetMaterialString(material, AI_MATKEY_NAME, &mat_name)) {
-		mat->Name = mat_name.C_Str();
-	}
-	if (AI_SUCCESS == aiGetMaterialFloat(material, AI_MATKEY_SHININESS, &shininess)) {
-		mat->Shininess = shininess;
-	}
-	if (AI_SUCCESS == aiGetMaterialColor(material, AI_MATKEY_COLOR_AMBIENT, &ambientColor)) {
-		mat->AmbientColor = glm::vec4(ambientColor.r, ambientColor.g, ambientColor.b, ambientColor.a);
-	}
-	if (AI_SUCCESS == aiGetMaterialColor(material, AI_MATKEY_COLOR_DIFFUSE, &diffuseColor)) {
-		mat->DiffuseColor = glm::vec4(diffuseColor.r, diffuseColor.g, diffuseColor.b, diffuseColor.a);
-	}
-	if (AI_SUCCESS == aiGetMaterialColor(material, AI_MATKEY_COLOR_SPECULAR, &specularColor)) {
-		mat->SpecularColor = glm::vec4(specularColor.r, specularColor.g, specularColor.b, specularColor.a);
-	}
-	if (AI_SUCCESS == aiGetMaterialFloat(material, AI_MATKEY_OPACITY, &opacity)) {
-		mat->Opacity = opacity;
+	// simplified levels of detail are cached after the full mesh, all of them indexing the same vertices
+	std::vector<std::vector<GLuint>> lods = MeshSimplifier::buildLodChain(vertices, indices);
+	std::vector<uint32_t> lodIndexCounts;
+	if (lods.size() > 1) {
+		std::string lodTriangles;
+		for (size_t i = 1; i < lods.size(); i++) {
+			lodIndexCounts.push_back((uint32_t)lods[i].size());
+			indices.insert(indices.end(), lods[i].begin(), lods[i].end());
+			lodTriangles += " -> " + std::to_string(lods[i].size() / 3);
+		}
+		lodIndexCounts.insert(lodIndexCounts.begin(), (uint32_t)lods[0].size());
+		printf("simplified mesh %s: %zu%s triangles\n", meshData.name.c_str(), lods[0].size() / 3, lodTriangles.c_str());
 	}
-	if (AI_SUCCESS == aiGetMaterialFloat(material, AI_MATKEY_REFLECTIVITY, &reflectivity)) {
-		mat->Reflectivity = reflectivity;
+	// meshlets are cut from the full mesh after it was ordered for the vertex cache, which keeps each one compact
+	size_t fullIndexCount = lodIndexCounts.empty() ? indices.size() : lodIndexCounts[0];
+	meshData.meshlets = MeshletBuilder::build(vertices, indices.data(), fullIndexCount);
+	if (!meshData.meshlets.empty())
+		printf("split mesh %s into %zu meshlets\n", meshData.name.c_str(), meshData.meshlets.size());
+	meshData.setStorage(std::move(vertices), std::move(indices), std::move(lodIndexCounts));
+	return meshData;
+}
+
+void Model::processMaterials(const aiScene *scene, ModelData& data)
+{
+	for (unsigned int i = 0; i < scene->mNumMaterials; i++)
+	{
+		aiMaterial* material = scene->mMaterials[i];
+
+		// load in the coeficients.
+		MaterialData mat;
+		float shininess, opacity, reflectivity, refractionIndex;
+		aiColor4D ambientColor, diffuseColor, specularColor;
+		aiString mat_name;
+		if (AI_SUCCESS == aiGetMaterialString(material, AI_MATKEY_NAME, &mat_name)) {
+			mat.name = mat_name.C_Str();
+		}
+		if (AI_SUCCESS == aiGetMaterialFloat(material, AI_MATKEY_SHININESS, &shininess)) {
+			mat.shininess = shininess;
+		}
+		if (AI_SUCCESS == aiGetMaterialColor(material, AI_MATKEY_COLOR_AMBIENT, &ambientColor)) {
+			mat.ambientColor = glm::vec4(ambientColor.r, ambientColor.g, ambientColor.b, ambientColor.a);
+		}
+		if (AI_SUCCESS == aiGetMaterialColor(material, AI_MATKEY_COLOR_DIFFUSE, &diffuseColor)) {
+			mat.diffuseColor = glm::vec4(diffuseColor.r, diffuseColor.g, diffuseColor.b, diffuseColor.a);
+		}
+		if (AI_SUCCESS == aiGetMaterialColor(material, AI_MATKEY_COLOR_SPECULAR, &specularColor)) {
+			mat.specularColor = glm::vec4(specularColor.r, specularColor.g, specularColor.b, specularColor.a);
+		}
+		if (AI_SUCCESS == aiGetMaterialFloat(material, AI_MATKEY_OPACITY, &opacity)) {
+			mat.opacity = opacity;
+		}
+		if (AI_SUCCESS == aiGetMaterialFloat(material, AI_MATKEY_REFLECTIVITY, &reflectivity)) {
+			mat.reflectivity = reflectivity;
+		}
+		if (AI_SUCCESS == aiGetMaterialFloat(material, AI_MATKEY_REFRACTI, &refractionIndex)) {
+			mat.refractionIndex = refractionIndex;
+		}
+
+		// 1. diffuse maps
+		mat.textureDiffuse = getMaterialTexturePaths(material, aiTextureType_DIFFUSE);
+		// 2. specular maps
+		mat.textureSpecular = getMaterialTexturePaths(material, aiTextureType_SPECULAR);
+		// 3. normal maps
+		mat.textureNormal = getMaterialTexturePaths(material, aiTextureType_HEIGHT);
+		// 4. height maps
+		mat.textureHeight = getMaterialTexturePaths(material, aiTextureType_AMBIENT);
+
+		data.materials.push_back(mat);
 	}
-	if (AI_SUCCESS == aiGetMaterialFloat(material, AI_MATKEY_REFRACTI, &refractionIndex)) {
-		mat->RefractionIndex = refractionIndex;
+}
+
+std::vector<std::string> Model::getMaterialTexturePaths(aiMaterial *material, aiTextureType type)
+{
+	std::vector<std::string> paths;
+	for (unsigned int i = 0; i < material->GetTextureCount(type); i++)
+	{
+		aiString mat_path; // local path of material texture from obj
+		material->GetTexture(type, i, &mat_path);
+		paths.push_back(mat_path.C_Str());
 	}
+	return paths;
+}
 
+void Model::createMeshes(const ModelData& data)
+{
 	// we assume a convention for sampler names in the shaders. Each diffuse texture should be named
 	// as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER. 
 	// Same applies to other texture as the following list summarizes:
 	// diffuse: texture_diffuseN
 	// specular: texture_specularN
 	// normal: texture_normalN
-	std::map<GLuint, std::string> textures;
-
-	// 1. diffuse maps
-	mat->textureDiffuse = loadMaterialTextures(path, material, aiTextureType_DIFFUSE);
-	// 2. specular maps
-	mat->textureSpecular = loadMaterialTextures(path, material, aiTextureType_SPECULAR);
-	// 3. normal maps
-	mat->textureNormal = loadMaterialTextures(path, material, aiTextureType_HEIGHT);
-	// 4. height maps
-	mat->textureHeight = loadMaterialTextures(path, material, aiTextureType_AMBIENT);
-
-	// return a mesh object created from the extracted mesh data
-	if (name == "") {
-		name = "mesh_" + this->meshes.size();
+	// materials are interned so identical materials of this and other models share one id and uniform buffer slot
+	std::vector<Material*> materials;
+	for (const MaterialData& materialData : data.materials) {
+		Material mat;
+		mat.Name = materialData.name;
+		mat.AmbientColor = materialData.ambientColor;
+		mat.DiffuseColor = materialData.diffuseColor;
+		mat.SpecularColor = materialData.specularColor;
+		mat.Shininess = materialData.shininess;
+		mat.Opacity = materialData.opacity;
+		mat.Reflectivity = materialData.reflectivity;
+		mat.RefractionIndex = materialData.refractionIndex;
+		mat.textureDiffuse = loadMaterialTextures(materialData.textureDiffuse);
+		mat.textureSpecular = loadMaterialTextures(materialData.textureSpecular);
+		mat.textureNormal = loadMaterialTextures(materialData.textureNormal, TextureUsage::Normal);
+		mat.textureHeight = loadMaterialTextures(materialData.textureHeight);
+		materials.push_back(MaterialManager::get().intern(mat));
+	}
+	// meshes that share an assimp material share a Material, each mesh holds its own reference
+	for (const MeshData& meshData : data.meshes) {
+		Material* mat = meshData.materialIndex < materials.size() ? MaterialManager::get().acquire(materials[meshData.materialIndex]) : MaterialManager::get().intern(Material());
+		this->meshes.push_back(std::unique_ptr<IDrawObj>((IDrawObj*)new Mesh(
+			meshData.vertices, meshData.vertexCount, meshData.indices, meshData.indexCount, meshData.name, mat, meshData.lodIndexCounts, meshData.meshlets
+		)));
+	}
+	for (Material* mat : materials) {
+		MaterialManager::get().release(mat);
 	}
-	meshes.push_back(std::unique_ptr<IDrawObj>((IDrawObj*)new Mesh(vertices, indices, name, mat)));
 }
 
-// checks all material textures of a given type and loads the textures if they're not loaded yet.
-// the required info is returned as a Texture struct.
-std::vector<GLuint> Model::loadMaterialTextures(const std::string& path, aiMaterial *material, aiTextureType type)
+// takes a reference to the textures at the given paths, relative to the model directory, from the texture cache.
+std::vector<GLuint> Model::loadMaterialTextures(const std::vector<std::string>& paths, TextureUsage usage)
 {
-	//std::vector<Texture> textures;
-	stbi_set_flip_vertically_on_load(false);
 	std::vector<GLuint> textures;
-	for (unsigned int i = 0; i < material->GetTextureCount(type); i++)
+	for (const std::string& mat_path : paths)
 	{
-		GLenum format; // format of the texture on creation
-		GLuint textureId; // actual texture id
-		std::string mode; // type of texture thats being imported
-
-		aiString mat_path; // local path of material texture from obj
-		material->GetTexture(type, i, &mat_path);
-
-		auto it = textures_loaded.find(mat_path.C_Str());
-		if (it != textures_loaded.end())
-		{
-			textures.push_back(it->second.id);
-		}
-		else
-		{   // if texture hasn't been loaded already, load it
-
-			int width, height, channel_num; // texture width and height, number of channels in the image (RGBa)
-			std::string filename = path + "/" + mat_path.C_Str(); // actual path to file in local file system
-			unsigned char *image_data = stbi_load(filename.c_str(), &width, &height, &channel_num, 0); // image data of texture
-			if (!image_data) {
-				fprintf(stderr, "%s %s\n", "Failed to load texture", filename.c_str());
-			}
-
-			switch (channel_num)
-			{
-				case 1: format = GL_RED;     break;
-				//case 2 : format = GL_LUMINANCE; break;
-				case 3: format = GL_RGB;       break;
-				case 4: format = GL_RGBA;      break;
-			}
-
-			glGenTextures(1, &textureId);
-			glBindTexture(GL_TEXTURE_2D, textureId);
-
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-			glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, image_data);
-			glGenerateMipmap(GL_TEXTURE_2D);
-
-			stbi_image_free(image_data);
-
-			switch (type) {
-			case aiTextureType_DIFFUSE: mode = "texture_diffuse"; break;
-			case aiTextureType_SPECULAR: mode = "texture_specular"; break;
-			case aiTextureType_HEIGHT: mode = "texture_normal"; break;
-			case aiTextureType_AMBIENT: mode = "texture_height"; break;
-			}
-
-			Texture texture;
-			texture.id = textureId;
-			texture.type = mode;
-			this->textures_loaded.insert(std::make_pair(mat_path.C_Str(), texture));
-			textures.push_back(textureId);
-		}
+		std::string filename = this->directory + "/" + mat_path; // actual path to file in local file system
+		GLuint textureId = TextureCache::get().acquire(filename, false, false, usage);
+		if (textureId == 0)
+			continue;
+		this->textures.push_back(textureId);
+		textures.push_back(textureId);
 	}
 	return textures;
 }
@@ -20,8 +20,15 @@
 #include "glHelper.h"
 #include "shader.h"
 #include "TextureManager.h"
+#include "TextureCache.h"
 #include "DrawObj.h"
 #include "mesh.h"
+#include "MeshCache.h"
+#include "TextureCompressor.h"
+#include "TransformSystem.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
 
 class Model 
 {
@@ -29,11 +36,19 @@ class Model
         /*  Functions   */
         // constructor, expects a filepath to a 3D model.
         // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+        // the processed meshes are cached in MESH_CACHE_DIRECTORY and the importer only runs when the cache is out of date.
 		Model(
 			std::string name,
 			std::string const path,
 			unsigned int assimp_flags = 0
 		);
+		// constructor for model data that was loaded ahead of time, such as by the AssetLoader.
+		// textures are taken from the texture cache and only loaded here if they are not cached yet.
+		Model(
+			std::string name,
+			const std::string& directory,
+			const ModelData& data
+		);
 		//constructor expects vertex data, indices, and textures
 		Model(
 			std::string name,
@@ -45,38 +60,78 @@ class Model
 			std::unique_ptr<IDrawObj> meshes
 		);
 
+		// releases the textures the model took from the texture cache.
+		~Model();
+
+		///<summary>Load the processed meshes and materials of a model file from the mesh cache, or import it with assimp on a cache miss.
+		///<para>Does not touch OpenGL so it may be called from any thread.</para>
+		///</summary>
+		///<returns>false if the file could not be imported.</returns>
+		static bool loadModelData(const std::string& path, unsigned int assimp_flags, ModelData& data);
+		///<summary>Get the directory that the textures of a model file are relative to.</summary>
+		static std::string getDirectory(const std::string& path);
+
         // drastd::ws the model, and thus all its meshes
 		void Draw(const Shader& shader, GLuint baseUnit = 0);
+		///<summary>Draw the meshes through their position only vertex arrays, without materials.</summary>
+		void DrawDepth();
 		void uploadUniforms(const Shader& shader);
+		///<summary>Upload an already computed model and normal matrix to the shader.</summary>
+		static void uploadUniforms(const Shader& shader, const glm::mat4& model, const glm::mat3& normal);
+
+		///<summary>Get the model matrix as of the last TransformSystem::update.</summary>
+		const glm::mat4& getModelMatrix() const { return TransformSystem::get().getWorld(this->transform); }
+		///<summary>Get the inverse transpose of the upper 3x3 of the model matrix as of the last TransformSystem::update.</summary>
+		const glm::mat3& getNormalMatrix() const { return TransformSystem::get().getNormal(this->transform); }
+		TransformHandle getTransform() const { return this->transform; }
 
 		const std::string getName() { return this->name; }
 		const std::vector<IDrawObj*> getMeshes();
+		///<summary>Get the bounds of all meshes in object space.</summary>
+		const Bounds& getBounds() const { return this->bounds; }
+		///<summary>Recompute the bounds if a mesh was rebuilt since they were last computed.</summary>
+		void refreshBounds();
+		///<summary>Changes whenever the bounds are recomputed. Compare with a stored value after refreshBounds to know whether copies of the bounds are stale.</summary>
+		uint32_t getBoundsVersion() const { return this->boundsVersion; }
 		const bool getTransparent() const { return this->isTransparent; }
-		const glm::vec3 getPosition() const { return this->position; }
-		const glm::vec3 getScale() const { return this->scale; }
-		const glm::vec3 getRotation() const { return this->rotation; }
+		const glm::vec3 getPosition() const { return TransformSystem::get().getPosition(this->transform); }
+		const glm::vec3 getScale() const { return TransformSystem::get().getScale(this->transform); }
+		const glm::vec3 getRotation() const { return TransformSystem::get().getRotation(this->transform); }
 
 		void setName(std::string name) { this->name = name; }
 		Model* setTransparent(bool isTransparent) { this->isTransparent = isTransparent; return this; }
-		Model* setPosition(glm::vec3 position) { this->position = position; return this; }
-		Model* setScale(glm::vec3 scale) { this->scale = scale; return this; }
-		Model* setRotation(glm::vec3 rotation) { this->rotation = rotation; return this; }
+		Model* setPosition(glm::vec3 position) { TransformSystem::get().setPosition(this->transform, position); return this; }
+		Model* setScale(glm::vec3 scale) { TransformSystem::get().setScale(this->transform, scale); return this; }
+		Model* setRotation(glm::vec3 rotation) { TransformSystem::get().setRotation(this->transform, rotation); return this; }
+		///<summary>Place the model relative to another one, so it follows it. Pass nullptr to detach it.</summary>
+		Model* setParent(const Model* parent) { TransformSystem::get().setParent(this->transform, parent ? parent->transform : TRANSFORM_NONE); return this; }
 
     private:
 		std::string name;
         std::vector<std::unique_ptr<IDrawObj>> meshes;
-        std::map<std::string, Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+        std::vector<GLuint> textures; // references taken from the texture cache, released on destruction.
         std::string directory; //the directory that the model is loaded from.
-		glm::vec3 position, scale, rotation; //the world location attributes of the model.
+		TransformHandle transform = TransformSystem::get().create(); //the position, rotation and scale of the model, relative to its parent.
 		bool isTransparent; //whether or not the model has transparent textures.
+		Bounds bounds; //the bounds of all meshes in object space.
+		uint32_t boundsVersion = 0; //sum of the bounds versions of the meshes the bounds were computed from.
+
+		void computeBounds();
 
         /*  Functions   */
         // processes a std::node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-		void processNode(std::string const &path, aiNode *node, const aiScene *scene);
+		static void processNode(aiNode *node, const aiScene *scene, ModelData& data);
+
+		static MeshData processMesh(aiMesh *mesh, const ModelData& data);
+
+		// read the coefficients and texture paths of every material in the scene.
+		static void processMaterials(const aiScene *scene, ModelData& data);
+
+		static std::vector<std::string> getMaterialTexturePaths(aiMaterial *mat, aiTextureType type);
 
-		void processMesh(std::string const &path, aiMesh *mesh, const aiScene *scene);
+		// create the materials and upload the meshes of imported or cached model data.
+		void createMeshes(const ModelData& data);
 
-        // checks all material textures of a given type and loads the textures if they're not loaded yet.
-        // the required info is returned as a Texture struct.
-		std::vector<GLuint> loadMaterialTextures(const std::string& path, aiMaterial *mat, aiTextureType type);
+        // takes a reference to the textures at the given paths, relative to the model directory, from the texture cache.
+		std::vector<GLuint> loadMaterialTextures(const std::vector<std::string>& paths, TextureUsage usage = TextureUsage::Color);
 };
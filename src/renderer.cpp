@@ -1,4 +1,8 @@
 #include "renderer.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
 
 Renderer::Renderer(int width, int height) :
 	width(width),
@@ -7,6 +11,7 @@ Renderer::Renderer(int width, int height) :
 	farBound(90.0f),
 	fieldOfView(90),
 	drawLights(true),
+	renderShadows(true),
 	time(0.0),
 	gammaCorrection(2.2f),
 	exposure(1.0f),
@@ -35,8 +40,6 @@ Renderer::Renderer(int width, int height) :
 
 	checkGLError("Renderer::initialize");
 
-	this->setupUbo();
-
 	this->shaders = {
 		//debug
 		{"vertexNormalLines", Shader("src/shaders/vertexNormalLines.vert", "src/shaders/vertexNormalLines.frag", "src/shaders/vertexNormalLines.geom").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1) },
@@ -56,12 +59,22 @@ Renderer::Renderer(int width, int height) :
 		{"bloom2D", Shader("src/shaders/bloom2D.vert", "src/shaders/bloom2D.frag").setUniformBlock("Scene", 0)},
 		//gbuffer
 		{"gBufferGeometry", Shader("src/shaders/gBuffer.vert", "src/shaders/gBuffer.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1)},
-		{"gBufferDLight", Shader("src/shaders/ds_dlight_pass.vert", "src/shaders/ds_dlight_pass.frag").setUniformBlock("Camera", 1).setUniformBlock("Lights", 2).Use().setInt("gPosition", 0).setInt("gNormal", 1).setInt("gAlbedoSpec", 2)},
-		{"gBufferPLight", Shader("src/shaders/ds_plight_pass.vert", "src/shaders/ds_plight_pass.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1).Use().setInt("gPosition", 0).setInt("gNormal", 1).setInt("gAlbedoSpec", 2)},
+		{"gBufferGeometryInstanced", Shader("src/shaders/gBufferInstanced.vert", "src/shaders/gBuffer.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1)},
+		{"gBufferGeometryIndirect", Shader("src/shaders/gBufferIndirect.vert", "src/shaders/gBuffer.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1)},
+		{"indirectCull", Shader::fromCompute("src/shaders/indirectCull.comp")},
+		{"meshletCull", Shader::fromCompute("src/shaders/meshletCull.comp")},
+		{"hiZBuild", Shader::fromCompute("src/shaders/hiZBuild.comp")},
+		{"gBufferDLight", Shader("src/shaders/ds_dlight_pass.vert", "src/shaders/ds_dlight_pass.frag").setUniformBlock("Camera", 1).setUniformBlock("Lights", 2).Use().setInt("gDepth", 0).setInt("gNormal", 1).setInt("gAlbedoSpec", 2)},
+		{"clusterCull", Shader::fromCompute("src/shaders/clusterCull.comp")},
+		{"gBufferClustered", Shader("src/shaders/ds_dlight_pass.vert", "src/shaders/ds_clustered.frag").setUniformBlock("Camera", 1).setUniformBlock("Lights", 2).Use().setInt("gDepth", 0).setInt("gNormal", 1).setInt("gAlbedoSpec", 2)},
+		{"gBufferPLightInstanced", Shader("src/shaders/ds_plight_instanced.vert", "src/shaders/ds_plight_instanced.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1).Use().setInt("gDepth", 0).setInt("gNormal", 1).setInt("gAlbedoSpec", 2)},
+		{"gBufferPLight", Shader("src/shaders/ds_plight_pass.vert", "src/shaders/ds_plight_pass.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1).Use().setInt("gDepth", 0).setInt("gNormal", 1).setInt("gAlbedoSpec", 2)},
 		{"depth", Shader("src/shaders/depth.vert", "src/shaders/depth.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1)},
 		// drawing
 		{"basic", Shader("src/shaders/basic.vert", "src/shaders/basic.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1)},
+		{"basicInstanced", Shader("src/shaders/basicInstanced.vert", "src/shaders/basic.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1)},
 		{"texture", Shader("src/shaders/basic.vert", "src/shaders/texture.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1)},
+		{"textureInstanced", Shader("src/shaders/basicInstanced.vert", "src/shaders/texture.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1)},
 		{"trans", Shader("src/shaders/basic.vert", "src/shaders/trans.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1)},
 		{"skybox", Shader("src/shaders/skybox.vert", "src/shaders/skybox.frag")},
 		{"highlight", Shader("src/shaders/basic.vert", "src/shaders/highlight.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1)},
@@ -69,16 +82,23 @@ Renderer::Renderer(int width, int height) :
 		{"explode", Shader("src/shaders/explode.vert", "src/shaders/texture.frag", "src/shaders/explode.geom").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1)},
 		{"light", Shader("src/shaders/basic.vert", "src/shaders/light.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1)},
 		// lighting
-		{"material", Shader("src/shaders/material.vert", "src/shaders/material.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1).setUniformBlock("Lights", 2)},
+		{"material", Shader("src/shaders/material.vert", "src/shaders/material.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1).setUniformBlock("Lights", 2).setUniformBlock("MaterialConstants", MaterialManager::getBindingPoint())},
 		{"shadowDepth", Shader("src/shaders/shadowDepth.vert", "src/shaders/shadowDepth.frag")},
 		{"shadowCubeDepth", Shader("src/shaders/shadowDepthCube.vert", "src/shaders/shadowDepthCube.frag", "src/shaders/shadowDepthCube.geom")},
+		{"shadowDepthInstanced", Shader("src/shaders/shadowDepthInstanced.vert", "src/shaders/shadowDepth.frag")},
+		{"shadowCubeDepthInstanced", Shader("src/shaders/shadowDepthCubeInstanced.vert", "src/shaders/shadowDepthCube.frag", "src/shaders/shadowDepthCube.geom")},
+		{"shadowDepthIndirect", Shader("src/shaders/shadowDepthIndirect.vert", "src/shaders/shadowDepth.frag")},
+		{"shadowCubeDepthIndirect", Shader("src/shaders/shadowDepthCubeIndirect.vert", "src/shaders/shadowDepthCube.frag", "src/shaders/shadowDepthCubeIndirect.geom")},
 		{"shadowDebug2D", Shader("src/shaders/shadowDebug.vert", "src/shaders/shadowDebug.frag").setUniformBlock("Camera", 1).Use().setInt("depthMap", 0)},
 		{"shadowCubeDebug", Shader("src/shaders/shadowCubeDebug.vert", "src/shaders/shadowCubeDebug.frag").setUniformBlock("Camera", 1).Use().setInt("depthMap", 1)},
 		{"phongLighting", Shader("src/shaders/lighting.vert", "src/shaders/phongLighting.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1).setUniformBlock("Lights", 2)},
-		{"directionalShadows", Shader("src/shaders/directionalShadows.vert", "src/shaders/directionalShadows.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1).setUniformBlock("Lights", 2).Use().setInt("shadowMap", 0)},
-		{"pointShadows", Shader("src/shaders/pointShadows.vert", "src/shaders/pointShadows.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1).setUniformBlock("Lights", 2).Use().setInt("shadowCubeMap", 1)},
-		{"blinnPhongLighting", Shader("src/shaders/lighting.vert", "src/shaders/blinnPhongLighting.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1).setUniformBlock("Lights", 2)},
-		{"BPLightingNorm", Shader("src/shaders/BPLightingNorm.vert", "src/shaders/BPLightingNorm.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1).setUniformBlock("Lights", 2)}
+		{"phongLightingInstanced", Shader("src/shaders/lightingInstanced.vert", "src/shaders/phongLighting.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1).setUniformBlock("Lights", 2)},
+		{"directionalShadows", Shader("src/shaders/directionalShadows.vert", "src/shaders/directionalShadows.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1).setUniformBlock("Lights", 2).setUniformBlock("MaterialConstants", MaterialManager::getBindingPoint()).Use().setInt("shadowMap", 0)},
+		{"directionalShadowsInstanced", Shader("src/shaders/directionalShadowsInstanced.vert", "src/shaders/directionalShadows.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1).setUniformBlock("Lights", 2).setUniformBlock("MaterialConstants", MaterialManager::getBindingPoint()).Use().setInt("shadowMap", 0)},
+		{"pointShadows", Shader("src/shaders/pointShadows.vert", "src/shaders/pointShadows.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1).setUniformBlock("Lights", 2).setUniformBlock("MaterialConstants", MaterialManager::getBindingPoint()).Use().setInt("shadowCubeMap", 1)},
+		{"blinnPhongLighting", Shader("src/shaders/lighting.vert", "src/shaders/blinnPhongLighting.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1).setUniformBlock("Lights", 2).setUniformBlock("MaterialConstants", MaterialManager::getBindingPoint())},
+		{"blinnPhongLightingInstanced", Shader("src/shaders/lightingInstanced.vert", "src/shaders/blinnPhongLighting.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1).setUniformBlock("Lights", 2).setUniformBlock("MaterialConstants", MaterialManager::getBindingPoint())},
+		{"BPLightingNorm", Shader("src/shaders/BPLightingNorm.vert", "src/shaders/BPLightingNorm.frag").setUniformBlock("Scene", 0).setUniformBlock("Camera", 1).setUniformBlock("Lights", 2).setUniformBlock("MaterialConstants", MaterialManager::getBindingPoint())}
 	};
 	int uniformBlockSize = this->shaders["BPLightingNorm"].getUniformBlockSize("Scene");
 	int window_size_offset = this->shaders["BPLightingNorm"].getUniformOffset({ 
@@ -105,8 +125,29 @@ void Renderer::preRender(Scene* scene)
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	// update uniform block objects for use during shaders
+	ProfileScope profile(this->profiler, "preRender");
+	FrameUniformAllocator::get().beginFrame();
 	this->updateUbo();
+	this->drawStats.reset();
+	scene->updateRenderList();
+	this->drawStats.transformsRecomputed = TransformSystem::get().getRecomputedCount();
+	// the depth seen by another camera or through another projection says nothing about this frame
+	glm::mat4 projection = this->getProjectionMatrix();
+	if (scene->getActiveCamera() != this->hiZCamera || projection != this->hiZProjection) {
+		this->hiZBuffer.invalidate();
+		this->hiZCamera = scene->getActiveCamera();
+		this->hiZProjection = projection;
+	}
+	for (auto& instancedModel_it : scene->getInstancedModels()) {
+		instancedModel_it.second->updateBuffer();
+	}
+	this->cullRenderList(scene);
+	this->selectMeshLods(scene);
+	this->updateDrawData(scene);
+	MaterialManager::get().updateUniformBlock();
 	scene->getLightManager()->updateUniformBlock();
+	if (this->lightingMode != LightingMode::StencilVolumes)
+		scene->getLightManager()->updateLightBuffer();
 	scene->getActiveCamera()->updateUniformBlock();
 }
 
@@ -114,84 +155,269 @@ void Renderer::render(Scene* scene)
 {
 	// render shadow depth maps
 	if (this->renderShadows) {
+		ProfileScope profile(this->profiler, "shadows");
 		this->renderShadowMaps(scene);
 	}
 
 	// render all the models without forward rendering enabled
-	auto models = scene->getModels();
+	const std::vector<RenderEntry>& renderList = scene->getRenderList();
 
-	this->gBuffer->BindForWriting();
-	for (auto &it : models) {
-		if (this->modelShaders.count(it.first) < 1) {
-			it.second->uploadUniforms(this->shaders["gBufferGeometry"]);
-			it.second->Draw(this->shaders["gBufferGeometry"]);
+	{
+		ProfileScope profile(this->profiler, "gBuffer");
+		this->gBuffer->BindForWriting();
+		const Shader& gBufferShader = this->shaders.at("gBufferGeometry");
+		this->resetDrawState();
+		this->buildDrawItems(renderList, false);
+		bool meshletCulled = this->indirectDraws && this->meshletCulling && this->frustumCulling;
+		if (this->indirectDraws) {
+			// arena meshes are drawn by one multi draw per material after the rest
+			this->queueIndirectDrawItems(renderList, this->gBufferDraws, meshletCulled ? &this->gBufferMeshlets : nullptr);
+			this->gBufferDraws.upload();
+			if (this->gpuCulling && this->frustumCulling)
+				this->gBufferDraws.cull(this->shaders.at("indirectCull"), this->cameraFrustum, this->occlusionCulling ? &this->hiZBuffer : nullptr);
+		}
+		if (meshletCulled && !this->gBufferMeshlets.isEmpty()) {
+			this->gBufferMeshlets.upload();
+			this->gBufferMeshlets.cull(this->shaders.at("meshletCull"), this->cameraFrustum, scene->getActiveCamera()->getPosition(), this->occlusionCulling ? &this->hiZBuffer : nullptr);
 		}
+		if (!this->drawItems.empty()) {
+			gBufferShader.Use();
+			this->boundProgram = gBufferShader.getId();
+			this->drawStats.shaderBinds++;
+			this->submitDrawItems(scene, &gBufferShader);
+		}
+		if (this->indirectDraws && !this->gBufferDraws.isEmpty()) {
+			const Shader& indirectShader = this->shaders.at("gBufferGeometryIndirect");
+			indirectShader.Use();
+			this->boundProgram = indirectShader.getId();
+			this->drawStats.shaderBinds++;
+			this->submitIndirect(this->gBufferDraws, indirectShader, 0, true);
+		}
+		if (meshletCulled && !this->gBufferMeshlets.isEmpty()) {
+			const Shader& indirectShader = this->shaders.at("gBufferGeometryIndirect");
+			if (indirectShader.getId() != this->boundProgram) {
+				indirectShader.Use();
+				this->boundProgram = indirectShader.getId();
+				this->drawStats.shaderBinds++;
+			}
+			this->submitMeshlets(this->gBufferMeshlets, indirectShader, 0);
+		}
+		this->renderInstancedModels(scene, false);
 	}
 
-	this->gBuffer->DSLightingPass(
-		this->shaders["gBufferDLight"], 
-		this->shaders["gBufferPLight"], 
-		this->shaders["depth"], 
-		scene->getLightManager()->getPointLights()
-	);
-
-	glEnable(GL_DEPTH_TEST);
-	glDepthMask(GL_TRUE);
+	glm::mat4 projection = this->getProjectionMatrix();
+	glm::mat4 view = scene->getActiveCamera()->getViewMatrix();
+	glm::mat4 viewProjection = projection * view;
 
-	// disable blending that was used to add direction and point lighting to the scene
-	glDisable(GL_BLEND);
+	// the depth of this frame is tested against by the culling of the next one
+	if (this->occlusionCulling && this->frustumCulling) {
+		ProfileScope profile(this->profiler, "hiZ");
+		this->hiZBuffer.build(this->shaders.at("hiZBuild"), this->gBuffer->getDepthTexture(), this->gBuffer->getWidth(), this->gBuffer->getHeight(), viewProjection);
+		this->hiZBuffer.readBack();
+	}
 
-	this->gBuffer->copyDepth(0, this->width, this->height);
+	{
+		ProfileScope profile(this->profiler, "deferredLighting");
+		// the lighting passes reconstruct world positions from the gBuffer depth
+		glm::mat4 inverseViewProjection = glm::inverse(viewProjection);
+		if (this->lightingMode == LightingMode::Clustered) {
+			// bin the lights into the clusters of the camera and shade them all in one pass
+			scene->getLightManager()->bindLightBuffer();
+			this->lightClusters.cull(this->shaders.at("clusterCull"), view, projection, this->nearBound, this->farBound);
+			const Shader& clusteredShader = this->shaders.at("gBufferClustered");
+			clusteredShader.Use()
+				.setMat4("inverseViewProjection", inverseViewProjection)
+				.setFloat("nearBound", this->nearBound)
+				.setFloat("farBound", this->farBound);
+			this->gBuffer->clusteredLightingPass(clusteredShader);
+		}
+		else if (this->lightingMode == LightingMode::InstancedVolumes) {
+			// the point lights are the first packed lights, one instance each
+			scene->getLightManager()->bindLightBuffer();
+			this->shaders.at("gBufferDLight").Use().setMat4("inverseViewProjection", inverseViewProjection);
+			this->shaders.at("gBufferPLightInstanced").Use().setMat4("inverseViewProjection", inverseViewProjection);
+			this->gBuffer->instancedLightingPass(
+				this->shaders["gBufferDLight"],
+				this->shaders["gBufferPLightInstanced"],
+				(GLsizei)scene->getLightManager()->getPointLights().size()
+			);
+		}
+		else {
+			this->shaders.at("gBufferDLight").Use().setMat4("inverseViewProjection", inverseViewProjection);
+			this->shaders.at("gBufferPLight").Use().setMat4("inverseViewProjection", inverseViewProjection);
+			this->gBuffer->DSLightingPass(
+				this->shaders["gBufferDLight"], 
+				this->shaders["gBufferPLight"], 
+				this->shaders["depth"], 
+				scene->getLightManager()->getPointLights()
+			);
+		}
 
-	// render the models with forward rendering
-	for (auto &it : this->modelShaders) {
-		Model* model = models.at(it.first);
-		const Shader& shader = this->shaders.at(it.second);
+		glEnable(GL_DEPTH_TEST);
+		glDepthMask(GL_TRUE);
 
-		// upload shadow uniforms and bind shadow textures
-		std::vector<ShadowMap*> shadowMaps = scene->getLightManager()->getShadowMaps();
-		int textureNum = 0;
-		for (int i = 0; i < shadowMaps.size(); i++) {
-			shadowMaps[i]->uploadUniforms(shader);
-			glActiveTexture(GL_TEXTURE0 + textureNum++);
-			glBindTexture(GL_TEXTURE_2D, shadowMaps[i]->getTexture());
-		}
+		// disable blending that was used to add direction and point lighting to the scene
+		glDisable(GL_BLEND);
 
-		std::vector<ShadowCubeMap*> shadowCubeMaps = scene->getLightManager()->getShadowCubeMaps();
-		for (int i = 0; i < shadowCubeMaps.size(); i++) {
-			shadowCubeMaps[i]->uploadUniforms(shader);
-			glActiveTexture(GL_TEXTURE0 + textureNum++);
-			glBindTexture(GL_TEXTURE_CUBE_MAP, shadowCubeMaps[i]->getTexture());
-		}
+		this->gBuffer->copyDepth(0, this->width, this->height);
+	}
 
-		model->uploadUniforms(shader);
-		model->Draw(shader, textureNum);
+	// render the models with forward rendering
+	{
+		ProfileScope profile(this->profiler, "forward");
+		this->resetDrawState();
+		this->buildDrawItems(renderList, true);
+		this->submitDrawItems(scene, nullptr);
+		this->renderInstancedModels(scene, true);
 	}
 
 	// render lights for debug purposes
-	if (this->drawLights)
+	if (this->drawLights) {
+		ProfileScope profile(this->profiler, "lights");
 		this->renderLights(scene);
+	}
 }
 
 void Renderer::renderShadowMaps(Scene* scene)
 {
-	std::map<std::string, Model*> models = scene->getModels();
+	const std::vector<RenderEntry>& renderList = scene->getRenderList();
+	const std::map<std::string, InstancedModel*>& instancedModels = scene->getInstancedModels();
 	std::vector<ShadowMap*> shadowMaps = scene->getLightManager()->getShadowMaps();
 	std::vector<ShadowCubeMap*> shadowCubeMaps = scene->getLightManager()->getShadowCubeMaps();
+	const Shader& shadowShader = this->shaders.at("shadowDepth");
+	const Shader& instancedShadowShader = this->shaders.at("shadowDepthInstanced");
 	for (auto shadowMap : shadowMaps) {
 		shadowMap->setActive();
-		shadowMap->uploadUniforms(this->shaders["shadowDepth"]);
-		for (auto model_it : models) {
-			model_it.second->uploadUniforms(this->shaders["shadowDepth"]);
-			model_it.second->Draw(this->shaders["shadowDepth"]);
+		shadowMap->uploadUniforms(shadowShader);
+		this->resetDrawState();
+		this->shadowDraws.clear();
+		// cull casters against the orthographic volume of the shadow map
+		Frustum frustum(shadowMap->getShadowTransform());
+		for (size_t i = 0; i < renderList.size(); i++) {
+			const RenderEntry& entry = renderList[i];
+			const uint8_t* meshLod = this->getEntryLods(this->shadowMeshLod, i, entry.meshes.size());
+			this->shadowMeshVisible.assign(entry.meshes.size(), 1);
+			if (this->frustumCulling) {
+				if (!frustum.intersects(entry.bounds)) {
+					this->cullingStats.shadowCastersCulled++;
+					continue;
+				}
+				this->cullingStats.shadowCastersVisible++;
+				// a single mesh shares the bounds of its model
+				if (entry.meshes.size() > 1) {
+					for (size_t j = 0; j < entry.meshes.size(); j++) {
+						this->shadowMeshVisible[j] = frustum.intersects(entry.meshes[j].bounds);
+					}
+				}
+			}
+			if (this->queueIndirectMeshes(this->shadowDraws, i, entry, this->shadowMeshVisible.data(), meshLod, 0))
+				this->drawEntryDepth(shadowShader, entry, this->shadowMeshVisible.data(), meshLod);
+		}
+		if (!this->shadowDraws.isEmpty()) {
+			const Shader& indirectShadowShader = this->shaders.at("shadowDepthIndirect");
+			this->shadowDraws.upload();
+			shadowMap->uploadUniforms(indirectShadowShader);
+			this->boundProgram = indirectShadowShader.getId();
+			this->submitIndirect(this->shadowDraws, indirectShadowShader, 0, false);
+		}
+
+		if (instancedModels.empty())
+			continue;
+		shadowMap->uploadUniforms(instancedShadowShader);
+		this->resetDrawState();
+		for (auto& instancedModel_it : instancedModels) {
+			InstancedModel* instancedModel = instancedModel_it.second;
+			if (this->frustumCulling && !frustum.intersects(instancedModel->getBounds())) {
+				this->cullingStats.shadowCastersCulled++;
+				continue;
+			}
+			this->cullingStats.shadowCastersVisible++;
+			this->drawInstanced(instancedShadowShader, instancedModel, 0, false);
 		}
 	}
+	const Shader& shadowCubeShader = this->shaders.at("shadowCubeDepth");
+	const Shader& instancedShadowCubeShader = this->shaders.at("shadowCubeDepthInstanced");
 	for (auto shadowCubeMap : shadowCubeMaps) {
 		shadowCubeMap->setActive();
-		shadowCubeMap->uploadUniforms(this->shaders["shadowCubeDepth"]);
-		for (auto model_it : models) {
-			model_it.second->uploadUniforms(this->shaders["shadowCubeDepth"]);
-			model_it.second->Draw(this->shaders["shadowCubeDepth"]);
+		shadowCubeMap->uploadUniforms(shadowCubeShader);
+		this->resetDrawState();
+
+		// cull casters against each face and only let the geometry shader emit to the faces they overlap
+		std::vector<glm::mat4> transforms = shadowCubeMap->getShadowTransforms();
+		Frustum faces[6];
+		for (int face = 0; face < 6; face++) {
+			faces[face] = Frustum(transforms[face]);
+		}
+		// returns the faces the bounds are outside of, or 0x3F if the caster can be skipped
+		auto cullFaces = [this, &faces](const Bounds& bounds) {
+			unsigned int culledFaces = 0;
+			for (int face = 0; face < 6; face++) {
+				if (!faces[face].intersects(bounds))
+					culledFaces |= 1u << face;
+			}
+			if (culledFaces == 0x3F) {
+				this->cullingStats.shadowCastersCulled++;
+				this->cullingStats.shadowFacesCulled += 6;
+				return culledFaces;
+			}
+			unsigned int faceCount = 0;
+			for (int face = 0; face < 6; face++) {
+				faceCount += (culledFaces >> face) & 1u;
+			}
+			this->cullingStats.shadowCastersVisible++;
+			this->cullingStats.shadowFacesCulled += faceCount;
+			this->cullingStats.shadowFacesRendered += 6 - faceCount;
+			return culledFaces;
+		};
+
+		unsigned int uploadedCulledFaces = 0;
+		this->shadowDraws.clear();
+		for (size_t i = 0; i < renderList.size(); i++) {
+			const RenderEntry& entry = renderList[i];
+			unsigned int culledFaces = this->frustumCulling ? cullFaces(entry.bounds) : 0;
+			if (culledFaces == 0x3F)
+				continue;
+			// indirect draws carry their culled faces in the base instance
+			const uint8_t* meshLod = this->getEntryLods(this->shadowMeshLod, i, entry.meshes.size());
+			this->shadowMeshVisible.assign(entry.meshes.size(), 1);
+			if (!this->queueIndirectMeshes(this->shadowDraws, i, entry, this->shadowMeshVisible.data(), meshLod, culledFaces))
+				continue;
+			if (culledFaces != uploadedCulledFaces) {
+				shadowCubeMap->uploadCulledFaces(shadowCubeShader, culledFaces);
+				uploadedCulledFaces = culledFaces;
+			}
+			this->drawEntryDepth(shadowCubeShader, entry, this->shadowMeshVisible.data(), meshLod);
+		}
+		if (uploadedCulledFaces != 0) {
+			shadowCubeMap->uploadCulledFaces(shadowCubeShader, 0);
+		}
+		if (!this->shadowDraws.isEmpty()) {
+			const Shader& indirectShadowCubeShader = this->shaders.at("shadowCubeDepthIndirect");
+			this->shadowDraws.upload();
+			shadowCubeMap->uploadUniforms(indirectShadowCubeShader);
+			this->boundProgram = indirectShadowCubeShader.getId();
+			this->submitIndirect(this->shadowDraws, indirectShadowCubeShader, 0, false);
+		}
+
+		if (instancedModels.empty())
+			continue;
+		// uploadUniforms also resets the culled faces of the instanced shader
+		shadowCubeMap->uploadUniforms(instancedShadowCubeShader);
+		this->resetDrawState();
+		uploadedCulledFaces = 0;
+		for (auto& instancedModel_it : instancedModels) {
+			InstancedModel* instancedModel = instancedModel_it.second;
+			unsigned int culledFaces = this->frustumCulling ? cullFaces(instancedModel->getBounds()) : 0;
+			if (culledFaces == 0x3F)
+				continue;
+			if (culledFaces != uploadedCulledFaces) {
+				shadowCubeMap->uploadCulledFaces(instancedShadowCubeShader, culledFaces);
+				uploadedCulledFaces = culledFaces;
+			}
+			this->drawInstanced(instancedShadowCubeShader, instancedModel, 0, false);
+		}
+		if (uploadedCulledFaces != 0) {
+			shadowCubeMap->uploadCulledFaces(instancedShadowCubeShader, 0);
 		}
 	}
 
@@ -200,6 +426,204 @@ void Renderer::renderShadowMaps(Scene* scene)
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
+void Renderer::cullRenderList(Scene* scene)
+{
+	const std::vector<RenderEntry>& renderList = scene->getRenderList();
+	this->cullingStats.reset();
+
+	// lay out one visibility flag per mesh so the passes can skip culled meshes of visible models
+	this->meshVisibleOffset.resize(renderList.size());
+	size_t meshCount = 0;
+	for (size_t i = 0; i < renderList.size(); i++) {
+		this->meshVisibleOffset[i] = meshCount;
+		meshCount += renderList[i].meshes.size();
+	}
+	this->entryVisible.assign(renderList.size(), 1);
+	this->meshVisible.assign(meshCount, 1);
+	const std::map<std::string, InstancedModel*>& instancedModels = scene->getInstancedModels();
+	this->instancedVisible.assign(instancedModels.size(), 1);
+
+	if (!this->frustumCulling) {
+		this->cullingStats.modelsVisible = (unsigned int)renderList.size();
+		this->cullingStats.meshesVisible = (unsigned int)meshCount;
+		this->cullingStats.instancedModelsVisible = (unsigned int)instancedModels.size();
+		return;
+	}
+
+	this->cameraFrustum = Frustum(this->getProjectionMatrix() * scene->getActiveCamera()->getViewMatrix());
+	const Frustum& frustum = this->cameraFrustum;
+
+	// instances are culled as a group
+	size_t instancedIndex = 0;
+	for (auto& instancedModel_it : instancedModels) {
+		if (frustum.intersects(instancedModel_it.second->getBounds()))
+			this->cullingStats.instancedModelsVisible++;
+		else {
+			this->instancedVisible[instancedIndex] = 0;
+			this->cullingStats.instancedModelsCulled++;
+		}
+		instancedIndex++;
+	}
+
+	// test the bounding spheres of all models in one batch
+	this->cullSpheres.resize(renderList.size());
+	for (size_t i = 0; i < renderList.size(); i++) {
+		const BoundingSphere& sphere = renderList[i].bounds.sphere;
+		this->cullSpheres[i] = glm::vec4(sphere.center, sphere.radius);
+	}
+	frustum.intersects(this->cullSpheres.data(), this->cullSpheres.size(), this->entryVisible.data());
+
+	for (size_t i = 0; i < renderList.size(); i++) {
+		const RenderEntry& entry = renderList[i];
+		uint8_t* meshVisible = &this->meshVisible[this->meshVisibleOffset[i]];
+
+		// the sphere test is loose, refine the survivors with the box
+		if (this->entryVisible[i] && !frustum.intersects(entry.bounds.box))
+			this->entryVisible[i] = 0;
+
+		if (!this->entryVisible[i]) {
+			std::fill(meshVisible, meshVisible + entry.meshes.size(), 0);
+			this->cullingStats.modelsCulled++;
+			this->cullingStats.meshesCulled += (unsigned int)entry.meshes.size();
+			continue;
+		}
+		this->cullingStats.modelsVisible++;
+
+		// a single mesh shares the bounds of its model
+		if (entry.meshes.size() == 1) {
+			this->cullingStats.meshesVisible++;
+			continue;
+		}
+		for (size_t j = 0; j < entry.meshes.size(); j++) {
+			meshVisible[j] = frustum.intersects(entry.meshes[j].bounds);
+			if (meshVisible[j])
+				this->cullingStats.meshesVisible++;
+			else
+				this->cullingStats.meshesCulled++;
+		}
+	}
+
+	if (this->occlusionCulling)
+		this->occlusionCullRenderList(scene);
+}
+
+///<summary>Fraction of the view height a sphere covers, or of the map for an orthographic shadow transform. FLT_MAX if the sphere reaches the eye.</summary>
+static float projectedSize(const BoundingSphere& sphere, const glm::mat4& viewProjection)
+{
+	// length of the row that makes clip y, the scale of the projection without the divide
+	float scale = glm::length(glm::vec3(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1]));
+	float w = viewProjection[0][3] * sphere.center.x + viewProjection[1][3] * sphere.center.y + viewProjection[2][3] * sphere.center.z + viewProjection[3][3];
+	bool orthographic = viewProjection[0][3] == 0.0f && viewProjection[1][3] == 0.0f && viewProjection[2][3] == 0.0f;
+	if (orthographic)
+		return sphere.radius * scale / w;
+	if (w < -sphere.radius)
+		return 0.0f;
+	if (w <= sphere.radius)
+		return FLT_MAX;
+	return sphere.radius * scale / w;
+}
+
+///<summary>Pick the level of detail for a projected size. The current level is kept until the size moves MESH_LOD_HYSTERESIS levels past its range.</summary>
+static uint8_t selectLod(size_t lodCount, float size, uint8_t current)
+{
+	if (lodCount <= 1)
+		return 0;
+	size_t lastLod = std::min(lodCount - 1, (size_t)UINT8_MAX);
+	// level n covers the sizes between MESH_LOD_SCREEN_SIZE / 2^n and half of that
+	float level = size >= MESH_LOD_SCREEN_SIZE ? 0.0f : size > 0.0f ? log2f(MESH_LOD_SCREEN_SIZE / size) : (float)lastLod;
+	if (current <= lastLod && level >= current - MESH_LOD_HYSTERESIS && level < current + 1.0f + MESH_LOD_HYSTERESIS)
+		return current;
+	return (uint8_t)std::min((size_t)level, lastLod);
+}
+
+void Renderer::selectMeshLods(Scene* scene)
+{
+	const std::vector<RenderEntry>& renderList = scene->getRenderList();
+	// resized rather than reset, the last level of every mesh feeds the hysteresis
+	this->meshLod.resize(this->meshVisible.size(), 0);
+	this->shadowMeshLod.resize(this->meshVisible.size(), 0);
+	if (!this->lodSelection) {
+		std::fill(this->meshLod.begin(), this->meshLod.end(), 0);
+		std::fill(this->shadowMeshLod.begin(), this->shadowMeshLod.end(), 0);
+		return;
+	}
+
+	glm::mat4 cameraTransform = this->getProjectionMatrix() * scene->getActiveCamera()->getViewMatrix();
+	// a caster is drawn at the same level into every shadow map, the finest any of them needs
+	std::vector<glm::mat4> shadowTransforms;
+	if (this->renderShadows) {
+		for (ShadowMap* shadowMap : scene->getLightManager()->getShadowMaps())
+			shadowTransforms.push_back(shadowMap->getShadowTransform());
+		for (ShadowCubeMap* shadowCubeMap : scene->getLightManager()->getShadowCubeMaps()) {
+			std::vector<glm::mat4> faceTransforms = shadowCubeMap->getShadowTransforms();
+			shadowTransforms.insert(shadowTransforms.end(), faceTransforms.begin(), faceTransforms.end());
+		}
+	}
+
+	for (size_t i = 0; i < renderList.size(); i++) {
+		const RenderEntry& entry = renderList[i];
+		for (size_t j = 0; j < entry.meshes.size(); j++) {
+			size_t index = this->meshVisibleOffset[i] + j;
+			size_t lodCount = entry.meshes[j].mesh->getLodCount();
+			const BoundingSphere& sphere = entry.meshes[j].bounds.sphere;
+
+			this->meshLod[index] = selectLod(lodCount, projectedSize(sphere, cameraTransform), this->meshLod[index]);
+			if (this->meshLod[index] > 0 && this->entryVisible[i] && this->meshVisible[index])
+				this->cullingStats.meshesReducedLod++;
+
+			if (shadowTransforms.empty())
+				continue;
+			float shadowSize = 0.0f;
+			for (const glm::mat4& shadowTransform : shadowTransforms)
+				shadowSize = std::max(shadowSize, projectedSize(sphere, shadowTransform));
+			this->shadowMeshLod[index] = selectLod(lodCount, shadowSize * MESH_LOD_SHADOW_SCALE, this->shadowMeshLod[index]);
+			if (this->shadowMeshLod[index] > 0)
+				this->cullingStats.shadowMeshesReducedLod++;
+		}
+	}
+}
+
+const uint8_t* Renderer::getEntryLods(const std::vector<uint8_t>& lods, size_t entryIndex, size_t meshCount) const
+{
+	if (entryIndex >= this->meshVisibleOffset.size() || this->meshVisibleOffset[entryIndex] + meshCount > lods.size())
+		return nullptr;
+	return &lods[this->meshVisibleOffset[entryIndex]];
+}
+
+void Renderer::occlusionCullRenderList(Scene* scene)
+{
+	const std::vector<RenderEntry>& renderList = scene->getRenderList();
+	this->hiZBuffer.fetchReadBack();
+	if (!this->hiZBuffer.hasReadBack())
+		return;
+
+	for (size_t i = 0; i < renderList.size(); i++) {
+		if (!this->entryVisible[i])
+			continue;
+		const RenderEntry& entry = renderList[i];
+		uint8_t* meshVisible = &this->meshVisible[this->meshVisibleOffset[i]];
+		if (this->hiZBuffer.isOccluded(entry.bounds.box)) {
+			this->entryVisible[i] = 0;
+			unsigned int meshesOccluded = (unsigned int)std::count(meshVisible, meshVisible + entry.meshes.size(), 1);
+			std::fill(meshVisible, meshVisible + entry.meshes.size(), 0);
+			this->cullingStats.modelsVisible--;
+			this->cullingStats.modelsOccluded++;
+			this->cullingStats.meshesVisible -= meshesOccluded;
+			this->cullingStats.meshesOccluded += meshesOccluded;
+			continue;
+		}
+		if (entry.meshes.size() == 1)
+			continue;
+		for (size_t j = 0; j < entry.meshes.size(); j++) {
+			if (meshVisible[j] && this->hiZBuffer.isOccluded(entry.meshes[j].bounds.box)) {
+				meshVisible[j] = 0;
+				this->cullingStats.meshesVisible--;
+				this->cullingStats.meshesOccluded++;
+			}
+		}
+	}
+}
+
 void Renderer::renderLights(Scene* scene)
 {
 	scene->getLightManager()->drawLights(this->shaders["light"]);
@@ -216,38 +640,376 @@ void Renderer::renderSkybox(Scene* scene)
 
 void Renderer::renderToGBuffer(Scene* scene) {
 	this->gBuffer->BindForWriting();
-	for (auto &it : scene->getModels()) {
-		it.second->uploadUniforms(this->shaders["gBufferGeometry"]);
-		it.second->Draw(this->shaders["gBufferGeometry"]);
-	}
+	this->drawRenderList(scene, this->shaders.at("gBufferGeometry"));
 }
 
 void Renderer::renderVertexNormalLines(Scene* scene) { 
-	const Shader& shader = this->shaders.at("vertexNormalLines");
-	for (auto &it : scene->getModels()) {
-		it.second->uploadUniforms(shader);
-		it.second->Draw(shader);
-	}
+	this->drawRenderList(scene, this->shaders.at("vertexNormalLines"));
 }
 void Renderer::renderTBNLines(Scene* scene) { 
-	const Shader& shader = this->shaders.at("tbnLines");
-	for (auto &it : scene->getModels()) {
-		it.second->uploadUniforms(shader);
-		it.second->Draw(shader);
-	}
+	this->drawRenderList(scene, this->shaders.at("tbnLines"));
 }
 void Renderer::renderVertexFaceLines(Scene* scene) { 
-	const Shader& shader = this->shaders.at("vertexFaceLines");
-	for (auto &it : scene->getModels()) {
-		it.second->uploadUniforms(shader);
-		it.second->Draw(shader);
-	}
+	this->drawRenderList(scene, this->shaders.at("vertexFaceLines"));
 }
 void Renderer::renderDepth(Scene* scene) { 
 	const Shader& shader = this->shaders.at("depth");
-	for (auto &it : scene->getModels()) {
-		it.second->uploadUniforms(shader);
-		it.second->Draw(shader);
+	shader.Use();
+	this->resetDrawState();
+	const std::vector<RenderEntry>& renderList = scene->getRenderList();
+	for (size_t i = 0; i < renderList.size(); i++) {
+		this->drawEntryDepth(shader, renderList[i], nullptr, this->getEntryLods(this->meshLod, i, renderList[i].meshes.size()));
+	}
+}
+
+void Renderer::drawEntry(const Shader& shader, const RenderEntry& entry, GLuint baseUnit, const uint8_t* meshVisible) {
+	for (size_t i = 0; i < entry.meshes.size(); i++) {
+		if (meshVisible == nullptr || meshVisible[i]) {
+			this->drawMesh(shader, entry, entry.meshes[i], baseUnit);
+		}
+	}
+}
+
+void Renderer::drawEntryDepth(const Shader& shader, const RenderEntry& entry, const uint8_t* meshVisible, const uint8_t* meshLod) {
+	const GeometryRange* boundDecode = nullptr;
+	Model::uploadUniforms(shader, entry.transform, entry.normal);
+	this->drawStats.transformUploads++;
+	for (size_t i = 0; i < entry.meshes.size(); i++) {
+		if (meshVisible != nullptr && !meshVisible[i])
+			continue;
+		IDrawObj* mesh = entry.meshes[i].mesh;
+		// packed meshes store positions inside their own bounds, which differ from mesh to mesh. The levels of detail share the decode of the full mesh
+		const GeometryRange* geometry = mesh->getGeometry();
+		const GeometryRange* decode = geometry != nullptr && geometry->isQuantized() ? geometry : nullptr;
+		if (decode != boundDecode) {
+			Model::uploadUniforms(shader, decode != nullptr ? decode->decodeModel(entry.transform) : entry.transform, entry.normal);
+			boundDecode = decode;
+			this->drawStats.transformUploads++;
+		}
+		GLuint vertexArray = mesh->getDepthVertexArray();
+		if (vertexArray != this->boundVertexArray) {
+			glBindVertexArray(vertexArray);
+			this->boundVertexArray = vertexArray;
+			this->drawStats.vertexArrayBinds++;
+		}
+		mesh->drawGeometry(1, meshLod != nullptr ? meshLod[i] : 0);
+		this->drawStats.drawCalls++;
+	}
+}
+
+void Renderer::drawMesh(const Shader& shader, const RenderEntry& entry, const RenderMesh& mesh, GLuint baseUnit, size_t lod) {
+	const GeometryRange* geometry = mesh.mesh->getGeometry();
+	const GeometryRange* decode = geometry != nullptr && geometry->isQuantized() ? geometry : nullptr;
+	if (&entry != this->boundEntry || decode != this->boundDecode) {
+		Model::uploadUniforms(shader, decode != nullptr ? decode->decodeModel(entry.transform) : entry.transform, entry.normal);
+		this->boundEntry = &entry;
+		this->boundDecode = decode;
+		this->drawStats.transformUploads++;
+	}
+	if (mesh.material != this->boundMaterial) {
+		this->drawStats.textureBinds += MaterialManager::get().bind(shader, mesh.material, baseUnit);
+		this->boundMaterial = mesh.material;
+		this->drawStats.materialBinds++;
+	}
+	GLuint vertexArray = mesh.mesh->getVertexArray();
+	if (vertexArray != this->boundVertexArray) {
+		glBindVertexArray(vertexArray);
+		this->boundVertexArray = vertexArray;
+		this->drawStats.vertexArrayBinds++;
+	}
+	mesh.mesh->drawGeometry(1, lod);
+	this->drawStats.drawCalls++;
+}
+
+void Renderer::resetDrawState() {
+	this->boundProgram = 0;
+	this->boundMaterial = nullptr;
+	this->boundVertexArray = 0;
+	this->boundEntry = nullptr;
+	this->boundDecode = nullptr;
+}
+
+void Renderer::buildDrawItems(const std::vector<RenderEntry>& renderList, bool forward) {
+	this->drawItems.clear();
+	// the culling compute shader decides which arena meshes of the gBuffer pass are drawn
+	bool gpuCulled = !forward && this->indirectDraws && this->gpuCulling && this->frustumCulling;
+	for (size_t i = 0; i < renderList.size(); i++) {
+		const RenderEntry& entry = renderList[i];
+		if (entry.shader.empty() == forward)
+			continue;
+		// the render list can change between preRender and render, draw anything that was not culled
+		bool culled = i < this->entryVisible.size();
+		if (culled && !this->entryVisible[i] && !gpuCulled)
+			continue;
+
+		uint64_t shaderKey = forward ? this->shaders.at(entry.shader).getId() : 0;
+		for (size_t j = 0; j < entry.meshes.size(); j++) {
+			const RenderMesh& mesh = entry.meshes[j];
+			if (culled && (!this->entryVisible[i] || !this->meshVisible[this->meshVisibleOffset[i] + j])
+				&& !(gpuCulled && mesh.mesh->getGeometry() != nullptr))
+				continue;
+			DrawItem item;
+			item.key = (shaderKey & 0xFFFF) << 48
+				| (uint64_t)(mesh.material->id & 0xFFFFFF) << 24
+				| (uint64_t)(mesh.mesh->getVertexArray() & 0xFFFFFF);
+			item.entry = (uint32_t)i;
+			item.mesh = (uint32_t)j;
+			this->drawItems.push_back(item);
+		}
+	}
+
+	if (this->sortDraws) {
+		// ties keep the meshes of an entry together so its transform is uploaded once
+		std::sort(this->drawItems.begin(), this->drawItems.end(), [](const DrawItem& a, const DrawItem& b) {
+			return a.key != b.key ? a.key < b.key : a.entry < b.entry;
+		});
+	}
+}
+
+void Renderer::submitDrawItems(Scene* scene, const Shader* passShader) {
+	const std::vector<RenderEntry>& renderList = scene->getRenderList();
+	const Shader* shader = passShader;
+	const std::string* shaderName = nullptr;
+	GLuint baseUnit = 0;
+	for (const DrawItem& item : this->drawItems) {
+		const RenderEntry& entry = renderList[item.entry];
+		if (passShader == nullptr && (shaderName == nullptr || *shaderName != entry.shader)) {
+			shader = &this->shaders.at(entry.shader);
+			shaderName = &entry.shader;
+			if (shader->getId() != this->boundProgram)
+				baseUnit = this->bindForwardShader(scene, *shader);
+		}
+		const uint8_t* meshLod = this->getEntryLods(this->meshLod, item.entry, entry.meshes.size());
+		this->drawMesh(*shader, entry, entry.meshes[item.mesh], baseUnit, meshLod != nullptr ? meshLod[item.mesh] : 0);
+	}
+	checkGLError("Renderer::submitDrawItems");
+}
+
+void Renderer::updateDrawData(Scene* scene) {
+	if (!this->indirectDraws) {
+		this->drawData.clear();
+		return;
+	}
+	const std::vector<RenderEntry>& renderList = scene->getRenderList();
+	this->drawData.resize(this->meshVisible.size());
+	for (size_t i = 0; i < renderList.size(); i++) {
+		const RenderEntry& entry = renderList[i];
+		glm::mat4 normal = glm::mat4(entry.normal);
+		for (size_t j = 0; j < entry.meshes.size(); j++) {
+			DrawData& data = this->drawData[this->meshVisibleOffset[i] + j];
+			const BoundingSphere& sphere = entry.meshes[j].bounds.sphere;
+			const GeometryRange* geometry = entry.meshes[j].mesh->getGeometry();
+			data.model = geometry != nullptr ? geometry->decodeModel(entry.transform) : entry.transform;
+			data.normal = normal;
+			data.sphere = glm::vec4(sphere.center, sphere.radius);
+		}
+	}
+	if (this->drawData.empty())
+		return;
+
+	if (this->drawDataBuffer == 0)
+		glGenBuffers(1, &this->drawDataBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->drawDataBuffer);
+	if (this->drawData.size() > this->drawDataCapacity) {
+		this->drawDataCapacity = std::max(this->drawData.size(), this->drawDataCapacity * 2);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, this->drawDataCapacity * sizeof(DrawData), NULL, GL_DYNAMIC_DRAW);
+	}
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, this->drawData.size() * sizeof(DrawData), this->drawData.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, IndirectDrawBuffer::DRAW_DATA_BINDING_POINT, this->drawDataBuffer);
+	checkGLError("Renderer::updateDrawData");
+}
+
+void Renderer::queueIndirectDrawItems(const std::vector<RenderEntry>& renderList, IndirectDrawBuffer& draws, MeshletDrawBuffer* meshlets) {
+	draws.clear();
+	if (meshlets != nullptr)
+		meshlets->clear();
+	size_t kept = 0;
+	for (const DrawItem& item : this->drawItems) {
+		const RenderMesh& mesh = renderList[item.entry].meshes[item.mesh];
+		// entries added after preRender have no draw data
+		size_t drawIndex = item.entry < this->meshVisibleOffset.size() ? this->meshVisibleOffset[item.entry] + item.mesh : SIZE_MAX;
+		const GeometryRange* geometry = mesh.mesh->getGeometry(drawIndex < this->meshLod.size() ? this->meshLod[drawIndex] : 0);
+		if (geometry == nullptr || drawIndex >= this->drawData.size()) {
+			this->drawItems[kept++] = item;
+			continue;
+		}
+		// simplified levels are cheap enough to cull as a whole, only the full mesh has meshlets
+		if (meshlets != nullptr && geometry->hasMeshlets())
+			meshlets->add(*geometry, (GLuint)drawIndex, mesh.material);
+		else
+			draws.add(*geometry, (GLuint)drawIndex, mesh.material);
+	}
+	this->drawItems.resize(kept);
+}
+
+bool Renderer::queueIndirectMeshes(IndirectDrawBuffer& draws, size_t entryIndex, const RenderEntry& entry, uint8_t* meshVisible, const uint8_t* meshLod, GLuint flags) {
+	bool hasDrawData = this->indirectDraws && entryIndex < this->meshVisibleOffset.size()
+		&& this->meshVisibleOffset[entryIndex] + entry.meshes.size() <= this->drawData.size();
+	bool direct = false;
+	for (size_t j = 0; j < entry.meshes.size(); j++) {
+		if (!meshVisible[j])
+			continue;
+		const GeometryRange* geometry = hasDrawData ? entry.meshes[j].mesh->getGeometry(meshLod != nullptr ? meshLod[j] : 0) : nullptr;
+		if (geometry == nullptr) {
+			direct = true;
+			continue;
+		}
+		draws.add(*geometry, (GLuint)(this->meshVisibleOffset[entryIndex] + j), nullptr, flags);
+		meshVisible[j] = 0;
+	}
+	return direct;
+}
+
+void Renderer::submitIndirect(const IndirectDrawBuffer& draws, const Shader& shader, GLuint baseUnit, bool bindMaterials) {
+	// depth only passes skip the materials and only need the positions
+	GLuint vertexArray = bindMaterials ? GeometryArena::get().getVertexArray() : GeometryArena::get().getDepthVertexArray();
+	draws.bind(vertexArray);
+	if (vertexArray != this->boundVertexArray) {
+		this->boundVertexArray = vertexArray;
+		this->drawStats.vertexArrayBinds++;
+	}
+	for (const IndirectBatch& batch : draws.getBatches()) {
+		if (bindMaterials && batch.material != nullptr && batch.material != this->boundMaterial) {
+			this->drawStats.textureBinds += MaterialManager::get().bind(shader, batch.material, baseUnit);
+			this->boundMaterial = batch.material;
+			this->drawStats.materialBinds++;
+		}
+		draws.draw(batch);
+		this->drawStats.drawCalls++;
+	}
+	this->drawStats.indirectCommands += (unsigned int)draws.getCommandCount();
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	checkGLError("Renderer::submitIndirect");
+}
+
+void Renderer::submitMeshlets(const MeshletDrawBuffer& meshlets, const Shader& shader, GLuint baseUnit) {
+	GLuint vertexArray = GeometryArena::get().getVertexArray();
+	meshlets.bind(vertexArray);
+	if (vertexArray != this->boundVertexArray) {
+		this->boundVertexArray = vertexArray;
+		this->drawStats.vertexArrayBinds++;
+	}
+	const std::vector<MeshletBatch>& batches = meshlets.getBatches();
+	for (size_t i = 0; i < batches.size(); i++) {
+		if (batches[i].material != nullptr && batches[i].material != this->boundMaterial) {
+			this->drawStats.textureBinds += MaterialManager::get().bind(shader, batches[i].material, baseUnit);
+			this->boundMaterial = batches[i].material;
+			this->drawStats.materialBinds++;
+		}
+		meshlets.draw(i);
+		this->drawStats.drawCalls++;
+	}
+	this->drawStats.meshletsSubmitted += (unsigned int)meshlets.getMeshletCount();
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindBuffer(GL_PARAMETER_BUFFER, 0);
+	checkGLError("Renderer::submitMeshlets");
+}
+
+GLuint Renderer::bindForwardShader(Scene* scene, const Shader& shader) {
+	// the sampler units and model matrix are program state, everything has to be bound again
+	this->resetDrawState();
+
+	// upload shadow uniforms and bind shadow textures
+	std::vector<ShadowMap*> shadowMaps = scene->getLightManager()->getShadowMaps();
+	GLuint textureNum = 0;
+	for (int i = 0; i < shadowMaps.size(); i++) {
+		shadowMaps[i]->uploadUniforms(shader);
+		glActiveTexture(GL_TEXTURE0 + textureNum++);
+		glBindTexture(GL_TEXTURE_2D, shadowMaps[i]->getTexture());
+	}
+
+	std::vector<ShadowCubeMap*> shadowCubeMaps = scene->getLightManager()->getShadowCubeMaps();
+	for (int i = 0; i < shadowCubeMaps.size(); i++) {
+		shadowCubeMaps[i]->uploadUniforms(shader);
+		glActiveTexture(GL_TEXTURE0 + textureNum++);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, shadowCubeMaps[i]->getTexture());
+	}
+
+	shader.Use();
+	this->boundProgram = shader.getId();
+	this->drawStats.shaderBinds++;
+	return textureNum;
+}
+
+const Shader* Renderer::getInstancedShader(const InstancedModel* instancedModel) const {
+	if (instancedModel->getShader().empty())
+		return nullptr;
+	auto it = this->shaders.find(instancedModel->getShader() + "Instanced");
+	return it == this->shaders.end() ? nullptr : &it->second;
+}
+
+void Renderer::drawInstanced(const Shader& shader, InstancedModel* instancedModel, GLuint baseUnit, bool bindMaterials) {
+	static const Uniform positionScaleUniform("positionScale");
+	static const Uniform positionOffsetUniform("positionOffset");
+
+	GLsizei instanceCount = (GLsizei)instancedModel->getInstanceCount();
+	if (instanceCount == 0)
+		return;
+	std::vector<IDrawObj*> meshes = instancedModel->getMeshes();
+	for (size_t i = 0; i < meshes.size(); i++) {
+		IDrawObj* mesh = meshes[i];
+		if (bindMaterials && mesh->getMaterial() != this->boundMaterial) {
+			this->drawStats.textureBinds += MaterialManager::get().bind(shader, mesh->getMaterial(), baseUnit);
+			this->boundMaterial = mesh->getMaterial();
+			this->drawStats.materialBinds++;
+		}
+		// the instance matrices are shared by every mesh, so packed positions are decoded in the shader instead of the transform.
+		// meshes outside the arena reset the decode, the uniforms keep the one of the last packed mesh otherwise
+		static const GeometryRange unpacked;
+		const GeometryRange* geometry = mesh->getGeometry();
+		if (geometry == nullptr)
+			geometry = &unpacked;
+		shader.setVec3(positionScaleUniform, geometry->positionScale);
+		shader.setVec3(positionOffsetUniform, geometry->positionOffset);
+		GLuint vertexArray = instancedModel->getVertexArray(i);
+		if (vertexArray != this->boundVertexArray) {
+			glBindVertexArray(vertexArray);
+			this->boundVertexArray = vertexArray;
+			this->drawStats.vertexArrayBinds++;
+		}
+		mesh->drawGeometry(instanceCount);
+		this->drawStats.drawCalls++;
+		this->drawStats.instancesDrawn += instanceCount;
+	}
+}
+
+void Renderer::renderInstancedModels(Scene* scene, bool forward) {
+	const Shader* boundShader = nullptr;
+	GLuint baseUnit = 0;
+	size_t index = 0;
+	for (auto& instancedModel_it : scene->getInstancedModels()) {
+		InstancedModel* instancedModel = instancedModel_it.second;
+		bool visible = index >= this->instancedVisible.size() || this->instancedVisible[index];
+		index++;
+		// models without an instanced variant of their forward shader are drawn in the gBuffer pass
+		const Shader* shader = this->getInstancedShader(instancedModel);
+		if (!visible || (shader != nullptr) != forward)
+			continue;
+		if (!forward)
+			shader = &this->shaders.at("gBufferGeometryInstanced");
+
+		if (shader != boundShader) {
+			if (forward) {
+				baseUnit = this->bindForwardShader(scene, *shader);
+			}
+			else {
+				this->resetDrawState();
+				shader->Use();
+				this->boundProgram = shader->getId();
+				this->drawStats.shaderBinds++;
+			}
+			boundShader = shader;
+		}
+		this->drawInstanced(*shader, instancedModel, baseUnit, true);
+	}
+}
+
+void Renderer::drawRenderList(Scene* scene, const Shader& shader) {
+	shader.Use();
+	this->resetDrawState();
+	for (const RenderEntry& entry : scene->getRenderList()) {
+		this->drawEntry(shader, entry);
 	}
 }
 
@@ -275,6 +1037,7 @@ void Renderer::setDimensions(int width, int height) {
 	if (this->gBuffer) {
 		this->gBuffer->setDimensions(width, height);
 	}
+	this->hiZBuffer.invalidate();
 	//this->tbm->setDimensions(width, height);
 }
 
@@ -286,39 +1049,22 @@ glm::mat4 Renderer::getProjectionMatrix() const
 // getter and setters
 
 void Renderer::updateUbo() {
-	glm::mat4 projection = this->getProjectionMatrix();
-
-	unsigned int size = 0;
-	glBindBuffer(GL_UNIFORM_BUFFER, this->ubo);
-	glBufferSubData(GL_UNIFORM_BUFFER, size, sizeof(glm::mat4), glm::value_ptr(this->getProjectionMatrix()));
-	size += sizeof(glm::mat4);
-	glBufferSubData(GL_UNIFORM_BUFFER, 64, sizeof(glm::vec2), glm::value_ptr(glm::vec2((float) this->width, (float) this->height)));
-	size += sizeof(glm::vec2);
-	glBufferSubData(GL_UNIFORM_BUFFER, 72, sizeof(float), &this->time);
-	size += sizeof(float);
-	glBufferSubData(GL_UNIFORM_BUFFER, 76, sizeof(int), &this->gammaCorrection);
-	size += sizeof(int);
-	glBufferSubData(GL_UNIFORM_BUFFER, 80, sizeof(float), &this->exposure);
-	size += sizeof(float);
-	glBufferSubData(GL_UNIFORM_BUFFER, 84, sizeof(int), &this->bloom);
-	size += sizeof(int);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	// std140 layout of the Scene block
+	struct {
+		glm::mat4 projection;
+		glm::vec2 windowSize;
+		float time;
+		int gamma;
+		float exposure;
+		int bloom;
+		float padding[2];
+	} block;
+	block.projection = this->getProjectionMatrix();
+	block.windowSize = glm::vec2((float)this->width, (float)this->height);
+	block.time = this->time;
+	block.gamma = this->gammaCorrection;
+	block.exposure = this->exposure;
+	block.bloom = this->bloom;
+	FrameUniformAllocator::get().upload(SCENE_UNIFORM_BLOCK_BINDING_POINT, &block, sizeof(block));
 	checkGLError("Scene::updateUbo");
 }
-
-void Renderer::setupUbo() {
-	int uboSize =
-		64 +// perspective matrix
-		8 +	// window_size
-		4 + // time
-		4 + // gamma
-		4 +	// exposure
-		4 +	// bloom
-		8;	// padding
-	glGenBuffers(1, &this->ubo);
-	glBindBuffer(GL_UNIFORM_BUFFER, this->ubo);
-	glBufferData(GL_UNIFORM_BUFFER, uboSize, NULL, GL_STATIC_DRAW);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
-	glBindBufferRange(GL_UNIFORM_BUFFER, 0, this->ubo, 0, uboSize);
-	checkGLError("Scene::setupUbo");
-}
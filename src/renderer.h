@@ -8,8 +8,68 @@
 #include "glHelper.h"
 #include "scene.h"
 #include "shader.h"
+#include "FrameProfiler.h"
+#include "Frustum.h"
+#include "MaterialManager.h"
+#include "IndirectDrawBuffer.h"
+#include "MeshletDrawBuffer.h"
+#include "HiZBuffer.h"
+#include "LightClusters.h"
+#include "FrameUniformAllocator.h"
 
 #define CUBE_TEXTURE_SIZE 256
+// fraction of the view height a mesh has to cover to be drawn at full detail. Every halving of its size drops one level of detail
+#define MESH_LOD_SCREEN_SIZE 0.5f
+// how far, in levels, the size has to move past a boundary before the level changes, so meshes near a boundary do not flicker between levels
+#define MESH_LOD_HYSTERESIS 0.15f
+// shadow maps are filtered and rarely looked at closely, they take their levels as if the casters were this much smaller
+#define MESH_LOD_SHADOW_SCALE 0.5f
+
+///<summary>Counters for the draws and state changes of a single frame.</summary>
+struct DrawStats {
+	unsigned int drawCalls = 0;
+	unsigned int shaderBinds = 0;
+	unsigned int materialBinds = 0;
+	unsigned int textureBinds = 0;
+	unsigned int vertexArrayBinds = 0;
+	///<summary>Number of times a model matrix was uploaded.</summary>
+	unsigned int transformUploads = 0;
+	///<summary>Model transforms recomputed by the TransformSystem this frame.</summary>
+	unsigned int transformsRecomputed = 0;
+	///<summary>Instances drawn by instanced draw calls, counted once per mesh.</summary>
+	unsigned int instancesDrawn = 0;
+	///<summary>Meshes submitted through multi draw indirect commands. Each multi draw counts as one draw call.</summary>
+	unsigned int indirectCommands = 0;
+	///<summary>Meshlets handed to the meshlet culling shader, before it culls any.</summary>
+	unsigned int meshletsSubmitted = 0;
+
+	void reset() { *this = DrawStats(); }
+};
+
+///<summary>How the deferred pass shades point lights.</summary>
+enum class LightingMode {
+	///<summary>A stencil pass and a lighting pass with a sphere per light.</summary>
+	StencilVolumes,
+	///<summary>The back faces of every light sphere in one instanced draw, depth tested with GL_GREATER.</summary>
+	InstancedVolumes,
+	///<summary>Lights binned into view space clusters and shaded in one full screen pass, spot lights included.</summary>
+	Clustered,
+	Count
+};
+
+///<summary>Name of a lighting mode for the command line, debug window and benchmark reports.</summary>
+inline const char* getLightingModeName(LightingMode mode) {
+	static const char* names[] = { "stencil", "instanced", "clustered" };
+	return names[(int)mode];
+}
+
+///<summary>A single mesh of the render list to draw. Sorting by key makes draws that share a shader, material or vertex array adjacent.</summary>
+struct DrawItem {
+	///<summary>Shader program in the top 16 bits, material id in the next 24 bits and vertex array in the low 24 bits.</summary>
+	uint64_t key;
+	uint32_t entry;
+	uint32_t mesh;
+};
 
 class Renderer
 {
@@ -22,6 +82,8 @@ class Renderer
 		void renderShadowMaps(Scene* scene);
 		void renderLights(Scene* scene);
 		void renderSkybox(Scene* scene);
+		///<summary>Test the render list against the view frustum of the active camera. Called by preRender after the render list is updated.</summary>
+		void cullRenderList(Scene* scene);
 
 		// defered rendering
 		void renderToGBuffer(Scene* scene);
@@ -37,26 +99,35 @@ class Renderer
 		void updateUbo();
 
 		// getter and setters
-		std::unordered_map<std::string, Shader> getShaders() { return this->shaders; }
+		const std::unordered_map<std::string, Shader>& getShaders() const { return this->shaders; }
 		const Shader getShader(std::string name) { return this->shaders.at(name); }
-		std::unordered_map<std::string, std::string> getForwardRenderModels() { return this->modelShaders; }
-		std::string getModelShader(std::string modelName) { return this->modelShaders.count(modelName) ? this->modelShaders.at(modelName) : "Deferred"; }
 		FBOManagerI* getTBM() const { return this->tbm; };
 		GBuffer* getGBuffer() const { return this->gBuffer; };
 		float getNearBound() const { return this->nearBound; }
 		float getFarBound() const { return this->farBound; }
 		float getFieldOfView() const { return this->fieldOfView; }
 		float getTime() const { return this->time; }
+		int getWidth() const { return this->width; }
+		int getHeight() const { return this->height; }
 		bool getDrawLights() const { return this->drawLights; }
 		bool getGammaCorrection() const { return this->gammaCorrection; }
 		float getExposure() const { return this->exposure; }
 		bool getBloom() const { return this->bloom; }
+		bool getRenderShadows() const { return this->renderShadows; }
+		FrameProfiler* getProfiler() const { return this->profiler; }
+		bool getFrustumCulling() const { return this->frustumCulling; }
+		const CullingStats& getCullingStats() const { return this->cullingStats; }
+		bool getSortDraws() const { return this->sortDraws; }
+		const DrawStats& getDrawStats() const { return this->drawStats; }
+		bool getIndirectDraws() const { return this->indirectDraws; }
+		bool getGpuCulling() const { return this->gpuCulling; }
+		bool getOcclusionCulling() const { return this->occlusionCulling; }
+		bool getLodSelection() const { return this->lodSelection; }
+		bool getMeshletCulling() const { return this->meshletCulling; }
+		LightingMode getLightingMode() const { return this->lightingMode; }
 
 		void setShaders(std::unordered_map<std::string, Shader> shaders) { this->shaders = shaders; }
 		void setShader(std::string name, Shader shader) { this->shaders.at(name) = shader; }
-		void setModelShaders(std::unordered_map<std::string, std::string> map) { this->modelShaders = map; }
-		void setModelShader(std::string model, std::string shader) { this->modelShaders.insert_or_assign(model, shader); }
-		void removeModelShader(std::string modelName) { this->modelShaders.erase(modelName); }
 		void setTBM(FBOManagerI* tbm) { this->tbm = tbm; };
 		void setGBuffer(GBuffer* gBuffer) { this->gBuffer = gBuffer; };
 		void setNearBound(float nearBound) { this->nearBound = nearBound; }
@@ -67,21 +138,39 @@ class Renderer
 		void setGammaCorrection(bool gamma) { this->gammaCorrection = gamma; }
 		void setExposure(float exposure) { this->exposure = exposure; }
 		void setBloom(bool bloom) { this->bloom = bloom; }
+		void setRenderShadows(bool renderShadows) { this->renderShadows = renderShadows; }
+		void setFrustumCulling(bool frustumCulling) { this->frustumCulling = frustumCulling; }
+		///<summary>Sort the gBuffer and forward draws by shader, material and vertex array. Otherwise they are drawn in render list order.</summary>
+		void setSortDraws(bool sortDraws) { this->sortDraws = sortDraws; }
+		///<summary>Draw the meshes stored in the geometry arena with glMultiDrawElementsIndirect in the gBuffer and shadow passes.</summary>
+		void setIndirectDraws(bool indirectDraws) { this->indirectDraws = indirectDraws; }
+		///<summary>Cull the indirect gBuffer draws per mesh with a compute shader instead of on the CPU. Needs indirect draws and frustum culling.</summary>
+		void setGpuCulling(bool gpuCulling) { this->gpuCulling = gpuCulling; }
+		///<summary>Skip models and meshes hidden behind the depth of the last frame. Needs frustum culling.</summary>
+		void setOcclusionCulling(bool occlusionCulling) {
+			this->occlusionCulling = occlusionCulling;
+			if (!occlusionCulling)
+				this->hiZBuffer.invalidate();
+		}
+		///<summary>Draw meshes at a simplified level of detail when they cover little of the view. Otherwise every mesh is drawn at full detail.</summary>
+		void setLodSelection(bool lodSelection) { this->lodSelection = lodSelection; }
+		///<summary>Cull the indirect gBuffer draws of meshes with meshlets per meshlet with a compute shader. Needs indirect draws and frustum culling.</summary>
+		void setMeshletCulling(bool meshletCulling) { this->meshletCulling = meshletCulling; }
+		void setLightingMode(LightingMode lightingMode) { this->lightingMode = lightingMode; }
+		///<summary>Set the profiler that times each render pass. Passing nullptr disables profiling.</summary>
+		void setProfiler(FrameProfiler* profiler) { this->profiler = profiler; }
 		void setDimensions(int width, int height);
 
 		glm::mat4 getProjectionMatrix() const;
 
     private:
-		GLuint ubo;
+		static const GLuint SCENE_UNIFORM_BLOCK_BINDING_POINT = 0;
+
 		GLuint debugVAO = 0, debugVBO;
 		FBOManagerI* tbm;
 		GBuffer* gBuffer;
+		FrameProfiler* profiler = nullptr;
 		std::unordered_map<std::string, Shader> shaders;
-
-		///<summary>first: The name of the model in the scene, second: the name of the shader
-		///<para>controls whether or not the model will be ommited from the gBuffer render pass, and then rendered afterwords with the specified shader</para>
-		///</summary>
-		std::unordered_map<std::string, std::string> modelShaders;
 		float nearBound, farBound, fieldOfView;
         int width, height;
 		float time;
@@ -92,6 +181,102 @@ class Renderer
 		bool useFBO;
 		bool gammaCorrection;
 		bool bloom;
+		bool frustumCulling = true;
+		bool sortDraws = true;
+		bool indirectDraws = true;
+		bool gpuCulling = false;
+		bool occlusionCulling = true;
+		bool lodSelection = true;
+		bool meshletCulling = true;
+		LightingMode lightingMode = LightingMode::Clustered;
+
+		// results of cullRenderList, indexed like the render list
+		CullingStats cullingStats;
+		Frustum cameraFrustum;
+		// depth pyramid of the last gBuffer pass
+		HiZBuffer hiZBuffer;
+		// camera and projection the pyramid was built for, it is dropped when either changes
+		const Camera* hiZCamera = nullptr;
+		glm::mat4 hiZProjection = glm::mat4(1.0f);
+		// cluster light lists of the clustered lighting pass
+		LightClusters lightClusters;
+		std::vector<glm::vec4> cullSpheres;
+		std::vector<uint8_t> entryVisible;
+		// per mesh visibility of all entries, entry i starts at meshVisibleOffset[i]
+		std::vector<uint8_t> meshVisible;
+		std::vector<size_t> meshVisibleOffset;
+		// visibility of the scene's instanced models, in map order
+		std::vector<uint8_t> instancedVisible;
+		// scratch per mesh visibility of a single entry in the shadow passes
+		std::vector<uint8_t> shadowMeshVisible;
+		// level of detail of every mesh for the camera and the shadow maps, laid out like meshVisible. Kept between frames for the hysteresis
+		std::vector<uint8_t> meshLod;
+		std::vector<uint8_t> shadowMeshLod;
+
+		// per mesh data of the render list for the indirect draws, laid out like meshVisible
+		std::vector<DrawData> drawData;
+		GLuint drawDataBuffer = 0;
+		size_t drawDataCapacity = 0;
+		IndirectDrawBuffer gBufferDraws;
+		IndirectDrawBuffer shadowDraws;
+		MeshletDrawBuffer gBufferMeshlets;
+
+		// draws of the current pass and the state they left bound, reset by resetDrawState
+		DrawStats drawStats;
+		std::vector<DrawItem> drawItems;
+		GLuint boundProgram = 0;
+		const Material* boundMaterial = nullptr;
+		GLuint boundVertexArray = 0;
+		const RenderEntry* boundEntry = nullptr;
+		///<summary>The quantized geometry whose position decode is folded into the uploaded transform, nullptr if the plain transform is bound.</summary>
+		const GeometryRange* boundDecode = nullptr;
+
+		///<summary>hide the entries and meshes that passed the frustum test but are behind the read back Hi-Z pyramid. Called by cullRenderList.</summary>
+		void occlusionCullRenderList(Scene* scene);
+		///<summary>pick the level of detail of every mesh of the render list by its projected size, once for the camera and once for all shadow maps. Called by preRender after culling.</summary>
+		void selectMeshLods(Scene* scene);
+		///<summary>get the levels of detail of the meshes of an entry from meshLod or shadowMeshLod, nullptr for entries added after preRender.</summary>
+		const uint8_t* getEntryLods(const std::vector<uint8_t>& lods, size_t entryIndex, size_t meshCount) const;
 
-		void setupUbo();
+		///<summary>upload the transform of a render list entry and draw all of its meshes. The shader must already be in use.</summary>
+		///<param name="meshVisible">Optional visibility of each mesh of the entry. Meshes with a 0 are skipped.</param>
+		void drawEntry(const Shader& shader, const RenderEntry& entry, GLuint baseUnit = 0, const uint8_t* meshVisible = nullptr);
+		///<summary>draw the meshes of an entry through their position only vertex arrays without binding their materials, for depth only passes.</summary>
+		///<param name="meshLod">Optional level of detail of each mesh of the entry, full detail if nullptr.</param>
+		void drawEntryDepth(const Shader& shader, const RenderEntry& entry, const uint8_t* meshVisible = nullptr, const uint8_t* meshLod = nullptr);
+		///<summary>draw a single mesh, only binding the transform, material and vertex array if they differ from the last draw.</summary>
+		void drawMesh(const Shader& shader, const RenderEntry& entry, const RenderMesh& mesh, GLuint baseUnit, size_t lod = 0);
+		///<summary>forget the state bound by earlier draws. Must be called at the start of every pass, other code binds vertex arrays and textures in between.</summary>
+		void resetDrawState();
+		///<summary>collect the visible meshes of the deferred or the forward entries into drawItems, sorted if sortDraws is set.</summary>
+		void buildDrawItems(const std::vector<RenderEntry>& renderList, bool forward);
+		///<summary>upload the transform and bounds of every mesh of the render list for the indirect draws. Called by preRender after culling.</summary>
+		void updateDrawData(Scene* scene);
+		///<summary>move the draw items of meshes stored in the geometry arena into an indirect draw buffer, leaving the others in drawItems.</summary>
+		///<param name="meshlets">Optional buffer that takes the meshes drawn at full detail that have meshlets instead.</param>
+		void queueIndirectDrawItems(const std::vector<RenderEntry>& renderList, IndirectDrawBuffer& draws, MeshletDrawBuffer* meshlets = nullptr);
+		///<summary>add the visible arena meshes of an entry to an indirect draw buffer and clear their visibility so only the remaining meshes are drawn directly.</summary>
+		///<param name="flags">Per draw flags passed in the base instance, the culled faces for cube maps.</param>
+		///<param name="meshLod">Optional level of detail of each mesh of the entry.</param>
+		///<returns>Whether any visible mesh is left to draw directly.</returns>
+		bool queueIndirectMeshes(IndirectDrawBuffer& draws, size_t entryIndex, const RenderEntry& entry, uint8_t* meshVisible, const uint8_t* meshLod, GLuint flags);
+		///<summary>issue the batches of an uploaded indirect draw buffer. The shader must already be in use.</summary>
+		///<param name="bindMaterials">Bind the material of each batch. Depth only passes skip them and draw through the position only vertex array.</param>
+		void submitIndirect(const IndirectDrawBuffer& draws, const Shader& shader, GLuint baseUnit, bool bindMaterials);
+		///<summary>issue the batches of a culled meshlet draw buffer with their materials. The shader must already be in use.</summary>
+		void submitMeshlets(const MeshletDrawBuffer& meshlets, const Shader& shader, GLuint baseUnit);
+		///<summary>draw drawItems. The gBuffer pass passes its shader, the forward pass passes nullptr to use the shader of each entry.</summary>
+		void submitDrawItems(Scene* scene, const Shader* passShader);
+		///<summary>use a forward shader and bind the shadow maps to its first texture units.</summary>
+		///<returns>The first texture unit free for materials.</returns>
+		GLuint bindForwardShader(Scene* scene, const Shader& shader);
+		///<summary>get the instanced variant of the forward shader of an instanced model, or nullptr if it is drawn in the gBuffer pass.</summary>
+		const Shader* getInstancedShader(const InstancedModel* instancedModel) const;
+		///<summary>draw every instance of each mesh of an instanced model with one draw call per mesh. The shader must already be in use.</summary>
+		///<param name="bindMaterials">Bind the material of each mesh. Depth only passes skip them.</param>
+		void drawInstanced(const Shader& shader, InstancedModel* instancedModel, GLuint baseUnit, bool bindMaterials);
+		///<summary>draw the visible instanced models of the gBuffer or the forward pass.</summary>
+		void renderInstancedModels(Scene* scene, bool forward);
+		///<summary>draw every entry of the scene's render list with the given shader.</summary>
+		void drawRenderList(Scene* scene, const Shader& shader);
 };
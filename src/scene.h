@@ -2,6 +2,7 @@
 
 #include <glad/glad.h>
 #include <iostream>
+#include <unordered_map>
 #include "model.h"
 #include "light.h"
 #include "shader.h"
@@ -11,6 +12,35 @@
 #include "FBOManager.h"
 #include "camera.h"
 #include "LightManager.h"
+#include "InstancedModel.h"
+
+///<summary>A mesh of a model in the render list along with the material it is drawn with.</summary>
+struct RenderMesh {
+	IDrawObj* mesh;
+	Material* material;
+	///<summary>The bounds of the mesh in world space.</summary>
+	Bounds bounds;
+};
+
+///<summary>A model in the flat render list of the scene.
+///<para>Entries are stored contiguously so the per frame passes can walk them without touching the model map.</para>
+///</summary>
+struct RenderEntry {
+	Model* model;
+	///<summary>The model matrix. Refreshed by Scene::updateRenderList.</summary>
+	glm::mat4 transform;
+	///<summary>The inverse transpose of the upper 3x3 of the model matrix.</summary>
+	glm::mat3 normal;
+	///<summary>TransformSystem version the transform, normal and bounds were copied at.</summary>
+	uint32_t transformVersion = 0;
+	///<summary>Bounds version of the model the bounds were computed from.</summary>
+	uint32_t boundsVersion = 0;
+	///<summary>Name of the shader the model is forward rendered with. Empty if the model is drawn in the gBuffer pass.</summary>
+	std::string shader;
+	std::vector<RenderMesh> meshes;
+	///<summary>The bounds of the whole model in world space.</summary>
+	Bounds bounds;
+};
 
 class Scene {
 public:
@@ -18,9 +48,22 @@ public:
 
 	Scene();
 
-	std::map<std::string, Model*> getModels();
+	const std::map<std::string, Model*>& getModels() const { return this->models; }
 	void setModels(std::map<std::string, Model*> models);
 
+	///<summary>Get the flat list of models to render. The order of entries is not stable across removeModel.</summary>
+	const std::vector<RenderEntry>& getRenderList() const { return this->renderList; }
+	///<summary>Update the TransformSystem, then refresh the materials of every render list entry and the transforms and bounds of the entries whose model moved or was rebuilt.
+	///Should be called once per frame before rendering.</summary>
+	void updateRenderList();
+
+	///<summary>Get the name of the shader a model is forward rendered with, or "Deferred" if it is drawn in the gBuffer pass.</summary>
+	std::string getModelShader(const std::string& modelName) const;
+	///<summary>Forward render a model with the given shader instead of drawing it in the gBuffer pass.</summary>
+	void setModelShader(const std::string& modelName, const std::string& shaderName);
+	///<summary>Draw a model in the gBuffer pass again.</summary>
+	void removeModelShader(const std::string& modelName);
+
 	std::vector<std::string> getTransparentModels();
 	std::vector<std::string> getOpaqueModels();
 
@@ -28,6 +71,13 @@ public:
 	Model* getModel(std::string);
 	Model* removeModel(std::string);
 
+	const std::map<std::string, InstancedModel*>& getInstancedModels() const { return this->instancedModels; }
+	///<summary>Add an instanced model, replacing one with the same name.</summary>
+	void setInstancedModel(InstancedModel* instancedModel) { this->instancedModels[instancedModel->getName()] = instancedModel; }
+	InstancedModel* getInstancedModel(const std::string& name) const;
+	///<summary>Remove an instanced model from the scene without deleting it.</summary>
+	InstancedModel* removeInstancedModel(const std::string& name);
+
 	LightManager* getLightManager() const;
 	void setLightManager(LightManager* lightManager);
 
@@ -52,9 +102,16 @@ private:
 	LightManager* lightManager;
 	//std::vector<Model*> models;
 	std::map<std::string, Model*> models;
+	std::map<std::string, InstancedModel*> instancedModels;
+	std::vector<RenderEntry> renderList;
+	///<summary>first: the name of the model, second: the index of its entry in renderList</summary>
+	std::unordered_map<std::string, size_t> renderListIndex;
 	std::vector<std::string> transparentModels;
 	std::vector<std::string> opaqueModels;
 	std::vector<Camera*> cameras;
 	std::unordered_map<std::string, std::function<void(Scene*)>> updateFunctions;
 	int activeCamera;
+
+	void addRenderEntry(Model* model);
+	void removeRenderEntry(const std::string& name);
 };
@@ -1,7 +1,12 @@
+#include <cmath>
+#include <string>
 #include "scene.h"
 #include "renderer.h"
+#include "Icosphere.h"
+#include "AssetLoader.h"
 
-void setupBasic(Scene* scene, Renderer* renderer) {
+///<summary>Set up the basic test scene. The models are loaded in the background and appear in the scene once the loader has uploaded them.</summary>
+void setupBasic(Scene* scene, Renderer* renderer, AssetLoader* loader) {
 	Camera* camera = new Camera(
 		glm::vec3(0, 0, 0),
 		glm::vec3(0, 1, 0),
@@ -83,7 +88,9 @@ void setupBasic(Scene* scene, Renderer* renderer) {
 
 	scene->setLightManager(lm);
 
-	scene->setModel((new Model("nanosuit", std::string("objects/test/nanosuit/nanosuit.obj"), aiProcess_FlipUVs)));
+	loader->loadModel("nanosuit", "objects/test/nanosuit/nanosuit.obj", aiProcess_FlipUVs, [scene](Model* model) {
+		scene->setModel(model);
+	});
 	//render.setModelShader("nanosuit", "directionalShadows");
 
 	//scene->setModel(("box1", new Model(std::string("objects/test/wood_box/wood_box.obj")))
@@ -113,22 +120,24 @@ void setupBasic(Scene* scene, Renderer* renderer) {
 	//	->setTransparent(true)
 	//);
 
-	scene->setModel(("floor", new Model("floor", std::string("objects/test/wood_floor/wood_floor.obj")))
-		->setScale(glm::vec3(10))
-	);
-	renderer->setModelShader("floor", "directionalShadows");
+	loader->loadModel("floor", "objects/test/wood_floor/wood_floor.obj", 0, [scene](Model* model) {
+		scene->setModel(model->setScale(glm::vec3(10)));
+		scene->setModelShader("floor", "directionalShadows");
+	});
 
-	scene->setModel(("wall", new Model("wall", std::string("objects/test/brick_wall/brick_wall.obj")))
-		->setPosition(glm::vec3(0, 10, -10))
-		->setScale(glm::vec3(10))
-		->setRotation(glm::vec3(90, 0, 0))
-	);
-	//render.setModelShader("wall", "BPLightingNorm");
+	loader->loadModel("wall", "objects/test/brick_wall/brick_wall.obj", 0, [scene](Model* model) {
+		scene->setModel(model
+			->setPosition(glm::vec3(0, 10, -10))
+			->setScale(glm::vec3(10))
+			->setRotation(glm::vec3(90, 0, 0))
+		);
+		//render.setModelShader("wall", "BPLightingNorm");
+	});
 
-	scene->setModel(("backpack", new Model("backpack", std::string("objects/test/Backpack/backpack.obj")))
-		->setPosition(glm::vec3(0.0f, 2.0f, 3.0f))
-	);
-	renderer->setModelShader("backpack", "directionalShadows");
+	loader->loadModel("backpack", "objects/test/Backpack/backpack.obj", 0, [scene](Model* model) {
+		scene->setModel(model->setPosition(glm::vec3(0.0f, 2.0f, 3.0f)));
+		scene->setModelShader("backpack", "directionalShadows");
+	});
 
 	//std::vector<std::unique_ptr<IDrawObj>> sphereMeshes;
 	//sphereMeshes.push_back(std::make_unique<Sphere>(1, 36, 18, false));
@@ -140,5 +149,42 @@ void setupBasic(Scene* scene, Renderer* renderer) {
 	Model* sphere = new Model("sphere", std::make_unique<Icosphere>("sphere", 1.0f, 2, true));
 	sphere->setPosition(glm::vec3(3.0f, 2.0f, 2.0f));
 	scene->setModel(sphere);
-	renderer->setModelShader("sphere", "material");
-}
\ No newline at end of file
+	scene->setModelShader("sphere", "material");
+}
+
+///<summary>The basic scene with a grid of extra icospheres added to increase the number of draw calls.</summary>
+///<param name="count">Number of extra icospheres.</param>
+void setupStress(Scene* scene, Renderer* renderer, AssetLoader* loader, int count) {
+	setupBasic(scene, renderer, loader);
+
+	int side = (int)std::ceil(std::sqrt((float)count));
+	float spacing = 2.0f;
+	for (int i = 0; i < count; i++) {
+		std::string name = "stress" + std::to_string(i);
+		Model* model = new Model(name, std::make_unique<Icosphere>(name, 0.5f, 2, true));
+		model->setPosition(glm::vec3(
+			(i % side - side / 2) * spacing,
+			0.5f,
+			(i / side - side / 2) * spacing
+		));
+		scene->setModel(model);
+	}
+}
+
+///<summary>The basic scene with a grid of extra icospheres drawn as instances of a single instanced model.</summary>
+///<param name="count">Number of instances.</param>
+void setupInstanced(Scene* scene, Renderer* renderer, AssetLoader* loader, int count) {
+	setupBasic(scene, renderer, loader);
+
+	InstancedModel* spheres = new InstancedModel("instanced", new Model("instanced", std::make_unique<Icosphere>("instanced", 0.5f, 2, true)));
+	int side = (int)std::ceil(std::sqrt((float)count));
+	float spacing = 2.0f;
+	for (int i = 0; i < count; i++) {
+		spheres->addInstance(glm::translate(glm::mat4(1.0f), glm::vec3(
+			(i % side - side / 2) * spacing,
+			0.5f,
+			(i / side - side / 2) * spacing
+		)));
+	}
+	scene->setInstancedModel(spheres);
+}
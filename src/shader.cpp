@@ -1,4 +1,50 @@
 #include "shader.h"
+#include "glHelper.h"
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+// names of every uniform that has been interned, the index of a name is its id
+struct UniformRegistry {
+	std::mutex mutex;
+	std::unordered_map<std::string, int> ids;
+	std::deque<std::string> names;
+};
+
+static UniformRegistry& getUniformRegistry() {
+	static UniformRegistry registry;
+	return registry;
+}
+
+Uniform::Uniform(const std::string &name)
+{
+	UniformRegistry& registry = getUniformRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	auto it = registry.ids.find(name);
+	if (it == registry.ids.end()) {
+		it = registry.ids.emplace(name, (int)registry.names.size()).first;
+		registry.names.push_back(name);
+	}
+	this->id = it->second;
+}
+
+const std::string& Uniform::getName() const
+{
+	static const std::string invalid;
+	if (this->id < 0)
+		return invalid;
+	UniformRegistry& registry = getUniformRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	return registry.names[this->id];
+}
+
+int Uniform::find(const std::string &name)
+{
+	UniformRegistry& registry = getUniformRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+	auto it = registry.ids.find(name);
+	return it == registry.ids.end() ? -1 : it->second;
+}
 
 Shader::Shader() {
 }
@@ -91,6 +137,7 @@ Shader::Shader(const GLchar* vertexPath, const GLchar* fragmentPath, const GLcha
 	glLinkProgram(this->Program);
 	// Print linking errors if any
 	checkCompileErrors(this->Program, "PROGRAM");
+	this->loadUniformLocations();
 
 	// Delete the shaders as they're linked into our program now and no longer necessery
 	glDeleteShader(vertex);
@@ -103,6 +150,40 @@ Shader::Shader(const GLchar* vertexPath, const GLchar* fragmentPath, const GLcha
 
 }
 
+Shader Shader::fromCompute(const GLchar* computePath)
+{
+	std::string computeCode;
+	std::ifstream cShaderFile;
+	cShaderFile.exceptions(std::ifstream::badbit);
+	try
+	{
+		cShaderFile.open(computePath);
+		std::stringstream cShaderStream;
+		cShaderStream << cShaderFile.rdbuf();
+		cShaderFile.close();
+		computeCode = cShaderStream.str();
+	}
+	catch (std::ifstream::failure e)
+	{
+		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+	}
+
+	Shader shader;
+	const GLchar* cShaderCode = computeCode.c_str();
+	GLuint compute = glCreateShader(GL_COMPUTE_SHADER);
+	glShaderSource(compute, 1, &cShaderCode, NULL);
+	glCompileShader(compute);
+	shader.checkCompileErrors(compute, "COMPUTE");
+
+	shader.Program = glCreateProgram();
+	glAttachShader(shader.Program, compute);
+	glLinkProgram(shader.Program);
+	shader.checkCompileErrors(shader.Program, "PROGRAM");
+	shader.loadUniformLocations();
+	glDeleteShader(compute);
+	return shader;
+}
+
 // Uses the current shader
 const Shader& Shader::Use() const
 {
@@ -118,72 +199,175 @@ const GLuint Shader::getId() const
 // ------------------------------------------------------------------------
 const Shader& Shader::setBool(const std::string &name, bool value) const
 {
-	glUniform1i(glGetUniformLocation(this->Program, name.c_str()), (int)value);
+	glUniform1i(this->getUniformLocation(name), (int)value);
 	return *this;
 }
 // ------------------------------------------------------------------------
 const Shader& Shader::setInt(const std::string &name, int value) const
 {
-	glUniform1i(glGetUniformLocation(this->Program, name.c_str()), value);
+	glUniform1i(this->getUniformLocation(name), value);
 	return *this;
 }
 // ------------------------------------------------------------------------
 const Shader& Shader::setFloat(const std::string &name, float value) const
 {
-	glUniform1f(glGetUniformLocation(this->Program, name.c_str()), value);
+	glUniform1f(this->getUniformLocation(name), value);
 	return *this;
 }
 // ------------------------------------------------------------------------
 const Shader& Shader::setVec2(const std::string &name, const glm::vec2 &value) const
 {
-	glUniform2fv(glGetUniformLocation(this->Program, name.c_str()), 1, &value[0]);
+	glUniform2fv(this->getUniformLocation(name), 1, &value[0]);
 	return *this;
 }
 const Shader& Shader::setVec2(const std::string &name, float x, float y) const
 {
-	glUniform2f(glGetUniformLocation(this->Program, name.c_str()), x, y);
+	glUniform2f(this->getUniformLocation(name), x, y);
 	return *this;
 }
 // ------------------------------------------------------------------------
 const Shader& Shader::setVec3(const std::string &name, const glm::vec3 &value) const
 {
-	glUniform3fv(glGetUniformLocation(this->Program, name.c_str()), 1, &value[0]);
+	glUniform3fv(this->getUniformLocation(name), 1, &value[0]);
 	return *this;
 }
 const Shader& Shader::setVec3(const std::string &name, float x, float y, float z) const
 {
-	glUniform3f(glGetUniformLocation(this->Program, name.c_str()), x, y, z);
+	glUniform3f(this->getUniformLocation(name), x, y, z);
 	return *this;
 }
 // ------------------------------------------------------------------------
 const Shader& Shader::setVec4(const std::string &name, const glm::vec4 &value) const
 {
-	glUniform4fv(glGetUniformLocation(this->Program, name.c_str()), 1, &value[0]);
+	glUniform4fv(this->getUniformLocation(name), 1, &value[0]);
 	return *this;
 }
 const Shader& Shader::setVec4(const std::string &name, float x, float y, float z, float w) const
 {
-	glUniform4f(glGetUniformLocation(this->Program, name.c_str()), x, y, z, w);
+	glUniform4f(this->getUniformLocation(name), x, y, z, w);
 	return *this;
 }
 // ------------------------------------------------------------------------
 const Shader& Shader::setMat2(const std::string &name, const glm::mat2 &mat) const
 {
-	glUniformMatrix2fv(glGetUniformLocation(this->Program, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	glUniformMatrix2fv(this->getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 	return *this;
 }
 // ------------------------------------------------------------------------
 const Shader& Shader::setMat3(const std::string &name, const glm::mat3 &mat) const
 {
-	glUniformMatrix3fv(glGetUniformLocation(this->Program, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	glUniformMatrix3fv(this->getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
 	return *this;
 }
 // ------------------------------------------------------------------------
 const Shader& Shader::setMat4(const std::string &name, const glm::mat4 &mat) const
 {
-	glUniformMatrix4fv(glGetUniformLocation(this->Program, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	glUniformMatrix4fv(this->getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+	return *this;
+}
+// ------------------------------------------------------------------------
+const Shader& Shader::setBool(const Uniform &uniform, bool value) const
+{
+	glUniform1i(this->getUniformLocation(uniform), (int)value);
+	return *this;
+}
+const Shader& Shader::setInt(const Uniform &uniform, int value) const
+{
+	glUniform1i(this->getUniformLocation(uniform), value);
+	return *this;
+}
+const Shader& Shader::setFloat(const Uniform &uniform, float value) const
+{
+	glUniform1f(this->getUniformLocation(uniform), value);
+	return *this;
+}
+const Shader& Shader::setVec2(const Uniform &uniform, const glm::vec2 &value) const
+{
+	glUniform2fv(this->getUniformLocation(uniform), 1, &value[0]);
+	return *this;
+}
+const Shader& Shader::setVec3(const Uniform &uniform, const glm::vec3 &value) const
+{
+	glUniform3fv(this->getUniformLocation(uniform), 1, &value[0]);
+	return *this;
+}
+const Shader& Shader::setVec4(const Uniform &uniform, const glm::vec4 &value) const
+{
+	glUniform4fv(this->getUniformLocation(uniform), 1, &value[0]);
+	return *this;
+}
+const Shader& Shader::setMat3(const Uniform &uniform, const glm::mat3 &mat) const
+{
+	glUniformMatrix3fv(this->getUniformLocation(uniform), 1, GL_FALSE, &mat[0][0]);
+	return *this;
+}
+const Shader& Shader::setMat4(const Uniform &uniform, const glm::mat4 &mat) const
+{
+	glUniformMatrix4fv(this->getUniformLocation(uniform), 1, GL_FALSE, &mat[0][0]);
 	return *this;
 }
+const Shader& Shader::setMat4(const Uniform &uniform, const glm::mat4 *mats, GLsizei count) const
+{
+	glUniformMatrix4fv(this->getUniformLocation(uniform), count, GL_FALSE, &mats[0][0][0]);
+	return *this;
+}
+// ------------------------------------------------------------------------
+GLint Shader::getUniformLocation(const Uniform &uniform) const
+{
+	int id = uniform.getId();
+	if (!this->uniformLocations || id < 0 || id >= (int)this->uniformLocations->size())
+		return -1;
+	return (*this->uniformLocations)[id];
+}
+GLint Shader::getUniformLocation(const std::string &name) const
+{
+	int id = Uniform::find(name);
+	if (!this->uniformLocations || id < 0 || id >= (int)this->uniformLocations->size())
+		return -1;
+	return (*this->uniformLocations)[id];
+}
+
+void Shader::loadUniformLocations()
+{
+	this->uniformLocations = std::make_shared<std::vector<GLint>>();
+	std::vector<GLint>& locations = *this->uniformLocations;
+	auto addLocation = [&locations](const std::string& name, GLint location) {
+		int id = Uniform(name).getId();
+		if (id >= (int)locations.size())
+			locations.resize(id + 1, -1);
+		locations[id] = location;
+	};
+
+	GLint uniformCount = 0, maxNameLength = 0;
+	glGetProgramiv(this->Program, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(this->Program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+	std::vector<GLchar> nameBuffer(maxNameLength + 1);
+
+	for (GLint i = 0; i < uniformCount; i++) {
+		GLsizei nameLength = 0;
+		GLint arraySize = 0;
+		GLenum type;
+		glGetActiveUniform(this->Program, i, (GLsizei)nameBuffer.size(), &nameLength, &arraySize, &type, nameBuffer.data());
+		std::string name(nameBuffer.data(), nameLength);
+
+		// uniforms that live in a uniform block have no location
+		GLint location = glGetUniformLocation(this->Program, name.c_str());
+		if (location < 0)
+			continue;
+		addLocation(name, location);
+
+		// arrays are reported once as "name[0]". store the bare name and every element so either form can be used.
+		if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+			std::string baseName = name.substr(0, name.size() - 3);
+			addLocation(baseName, location);
+			for (GLint element = 1; element < arraySize; element++) {
+				std::string elementName = baseName + "[" + std::to_string(element) + "]";
+				addLocation(elementName, glGetUniformLocation(this->Program, elementName.c_str()));
+			}
+		}
+	}
+	checkGLError("Shader::loadUniformLocations");
+}
 // ------------------------------------------------------------------------
 const Shader& Shader::setUniformBlock(const std::string &name, const GLuint &binding) const
 {
@@ -5,11 +5,32 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 #include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+///<summary>Handle to an interned uniform name.
+///<para>Every name is given a small id the first time it is seen. Shaders store their uniform locations in a table indexed by that id,
+///so setting a uniform through a handle is an array lookup with no string building and no glGetUniformLocation call.</para>
+///</summary>
+class Uniform
+{
+	public:
+		Uniform() : id(-1) {}
+		explicit Uniform(const std::string &name);
+
+		int getId() const { return this->id; }
+		const std::string& getName() const;
+
+		///<summary>Return the id of a name that was interned before, or -1 if it never was.</summary>
+		static int find(const std::string &name);
+
+	private:
+		int id;
+};
+
 class Shader
 {
     public:
@@ -17,6 +38,8 @@ class Shader
 		Shader();
 		// Constructor generates the shader on the fly
 		Shader(const GLchar* vertexPath, const GLchar* fragmentPath, const GLchar* geometryPath = nullptr);
+		///<summary>Build a program from a single compute shader.</summary>
+		static Shader fromCompute(const GLchar* computePath);
 
         // Uses the current shader
 		const Shader& Use() const;
@@ -45,6 +68,22 @@ class Shader
 		// ------------------------------------------------------------------------
 		const Shader& setMat4(const std::string &name, const glm::mat4 &mat) const;
 		// ------------------------------------------------------------------------
+		// uniform handle versions of the functions above. prefer these on per draw paths.
+		const Shader& setBool(const Uniform &uniform, bool value) const;
+		const Shader& setInt(const Uniform &uniform, int value) const;
+		const Shader& setFloat(const Uniform &uniform, float value) const;
+		const Shader& setVec2(const Uniform &uniform, const glm::vec2 &value) const;
+		const Shader& setVec3(const Uniform &uniform, const glm::vec3 &value) const;
+		const Shader& setVec4(const Uniform &uniform, const glm::vec4 &value) const;
+		const Shader& setMat3(const Uniform &uniform, const glm::mat3 &mat) const;
+		const Shader& setMat4(const Uniform &uniform, const glm::mat4 &mat) const;
+		///<summary>Set count consecutive elements of a mat4 array uniform starting at the element the handle names.</summary>
+		const Shader& setMat4(const Uniform &uniform, const glm::mat4 *mats, GLsizei count) const;
+		// ------------------------------------------------------------------------
+		///<summary>Get the location of an active uniform from the table built after linking. Returns -1 if the uniform is not active.</summary>
+		GLint getUniformLocation(const Uniform &uniform) const;
+		GLint getUniformLocation(const std::string &name) const;
+		// ------------------------------------------------------------------------
 		const Shader& setUniformBlock(const std::string &name, const GLuint &binding) const;
 		const GLuint getUniformBlockSize(const std::string &name) const;
 		//const GLuint Shader::getUniformOffset(const std::string &name) const;
@@ -53,6 +92,12 @@ class Shader
     private:
         GLuint Program;
 
+		///<summary>uniform locations indexed by Uniform id. Shared between copies of this shader since they use the same program.</summary>
+		std::shared_ptr<std::vector<GLint>> uniformLocations;
+
+		///<summary>query every active uniform after linking and store its location, including each element of arrays.</summary>
+		void loadUniformLocations();
+
         // utility function for checking shader compilation/linking errors.
         // ------------------------------------------------------------------------
 		void checkCompileErrors(GLuint shader, std::string type);
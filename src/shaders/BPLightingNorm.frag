@@ -63,6 +63,11 @@ struct Material {
     sampler2D texture_diffuse;
     sampler2D texture_specular;
 	sampler2D texture_normal;
+};
+
+//object data
+uniform Material material;
+layout (std140) uniform MaterialConstants {
 	vec4 ambient;
 	vec4 diffuse;
 	vec4 specular;
@@ -70,10 +75,7 @@ struct Material {
 	float opacity;
 	float reflectivity;
 	float refractionIndex;
-};
-
-//object data
-uniform Material material;
+} materialConstants;
 
 in VS_OUT {
 	vec3 FragPos;
@@ -91,9 +93,11 @@ void main()
 {
 	// obtain normal from normal map in range [0,1]
 	// only normalized this for nanosuit. shouldnt have to but for some reason did.
-    vec3 normalMap = texture(material.texture_normal, fs_in.TexCoords).rgb; 
+    // normal maps may be BC5 compressed which only stores x and y, so z is always rebuilt
+    vec2 normalMap = texture(material.texture_normal, fs_in.TexCoords).rg;
     // transform normal vector to range [-1,1]
-    vec3 normal = normalize(normalMap * 2.0 - 1.0);  // this normal is in tangent space
+    vec2 normalXY = normalMap * 2.0 - 1.0;
+    vec3 normal = normalize(vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0))));  // this normal is in tangent space
    
     // get diffuse color for ambient and diffuse
 	vec3 diffuseMap = texture(material.texture_diffuse, fs_in.TexCoords).rgb;
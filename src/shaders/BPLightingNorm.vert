@@ -61,7 +61,7 @@ layout (std140) uniform Camera
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in vec3 aTangent;
+layout (location = 3) in vec4 aTangent;  //w is the bitangent sign of packed vertices
 layout (location = 4) in vec3 aBitangent;
 
 uniform mat4 Model;  //model matrix
@@ -81,10 +81,13 @@ void main()
     vs_out.FragPos = vec3(Model * vec4(aPos, 1.0));
     vs_out.TexCoords = aTexCoords;
 
-	// 
-	vec3 T = normalize(vec3(Model * vec4(aTangent, 0.0)));
-	vec3 N = normalize(vec3(Model * vec4(aNormal, 0.0)));
-	vec3 B = normalize(vec3(Model * vec4(aBitangent, 0.0)));
+	// packed vertices have no bitangent, rebuild it from the sign stored in the tangent
+	vec3 bitangent = dot(aBitangent, aBitangent) > 0.0 ? aBitangent : cross(aNormal, aTangent.xyz) * aTangent.w;
+
+	// the normal matrix, as Model also holds the position decode of packed meshes
+	vec3 T = normalize(Normal * aTangent.xyz);
+	vec3 N = normalize(Normal * aNormal);
+	vec3 B = normalize(Normal * bitangent);
 
 	//orthogonalize the two vectors by pushing T down away from the direction N is going.
 	T = normalize(T - N * dot(T, N));
@@ -63,6 +63,11 @@ struct Material {
     sampler2D texture_specular;
 	sampler2D texture_normal;
 	sampler2D texture_height;
+};
+
+//object data
+uniform Material material;
+layout (std140) uniform MaterialConstants {
 	vec4 ambient;
 	vec4 diffuse;
 	vec4 specular;
@@ -70,10 +75,7 @@ struct Material {
 	float opacity;
 	float reflectivity;
 	float refractionIndex;
-};
-
-//object data
-uniform Material material;
+} materialConstants;
 
 uniform sampler2D texture_shadow_direction;
 uniform samplerCube texture_shadow_cube;
@@ -128,20 +130,20 @@ void main()
 }
 
 vec3 calculateAmbient(vec3 lightColor, float lightAmbient) {
-    vec3 ambient = lightColor * lightAmbient * material.diffuse.rgb * texture(material.texture_diffuse, fs_in.TexCoords).rgb;
+    vec3 ambient = lightColor * lightAmbient * materialConstants.diffuse.rgb * texture(material.texture_diffuse, fs_in.TexCoords).rgb;
 	return ambient;
 }
 
 vec3 calculateDiffuse(vec3 lightColor, float lightDiffuse, vec3 lightDirection, vec3 normal){
     float diff = max(dot(lightDirection, normal), 0.0);
-    vec3 diffuse =  lightColor * lightDiffuse * diff * material.diffuse.rgb * texture(material.texture_diffuse, fs_in.TexCoords).rgb;
+    vec3 diffuse =  lightColor * lightDiffuse * diff * materialConstants.diffuse.rgb * texture(material.texture_diffuse, fs_in.TexCoords).rgb;
 	return diffuse;
 }
 
 vec3 calculateSpecular(vec3 lightColor, float lightSpecular, vec3 lightDirection, vec3 viewDirection, vec3 normal) {
     vec3 halfwayDir = normalize(lightDirection + viewDirection);
     float spec = pow(max(dot(normal, halfwayDir), 0.0), 64);
-    vec3 specular = lightColor * lightSpecular * spec * material.specular.rgb * texture(material.texture_specular, fs_in.TexCoords).rgb;
+    vec3 specular = lightColor * lightSpecular * spec * materialConstants.specular.rgb * texture(material.texture_specular, fs_in.TexCoords).rgb;
 	return specular;
 }
 
@@ -0,0 +1,48 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 5) in mat4 aInstanceModel;  //model matrix, one per instance
+layout (location = 9) in mat3 aInstanceNormal;  //normal matrix, one per instance
+
+layout (std140) uniform Scene
+{
+	mat4 projection;
+    vec2 window_size;
+	float time;
+	bool gamma;
+	float exposure;
+	bool bloom;
+};
+
+layout (std140) uniform Camera
+{
+	mat4 view;
+	vec3 camPos;
+};
+
+out vec2 TexCoords;
+
+out VS_OUT {
+    vec3 FragPos;
+    vec3 Normal;
+    vec2 TexCoords;
+    vec4 FragPosLightSpace;
+} vs_out;
+
+uniform mat4 shadowTransform;
+
+// maps packed positions back to object space, left at identity for unpacked meshes
+uniform vec3 positionScale = vec3(1.0);
+uniform vec3 positionOffset = vec3(0.0);
+
+void main()
+{
+    vec3 position = aPos * positionScale + positionOffset;
+    vs_out.FragPos = vec3(aInstanceModel * vec4(position, 1.0));
+    vs_out.Normal = aInstanceNormal * aNormal;
+    vs_out.TexCoords = aTexCoords;
+    vs_out.FragPosLightSpace = shadowTransform * vec4(vs_out.FragPos, 1.0);
+    gl_Position = projection * view * aInstanceModel * vec4(position, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,161 @@
+#version 460 core
+out vec4 FragColor;
+  
+in vec2 TexCoords;
+
+uniform sampler2D gDepth;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+uniform mat4 inverseViewProjection;
+// the bounds the clusters were built with
+uniform float nearBound;
+uniform float farBound;
+
+struct PointLight {
+    float ambient;		// 4	//0
+    float diffuse;		// 4	//4
+    float specular;		// 4	//8
+    float constant;		// 4	//12
+    float linear;		// 4	//16
+    float quadratic;	// 4	//20
+    vec3 color;			// 16	//32	//move starting point to divisible
+    vec3 position;		// 16	//48
+};						// 64
+
+struct SpotLight {
+    vec3 color;			// 16	//0
+    vec3 position;		// 16	//16		//move starting point to divisible
+    vec3 direction;		// 16	//32
+    float ambient;		// 4	//34
+    float diffuse;		// 4	//38
+    float specular;		// 4	//62
+    float constant;		// 4	//64
+    float linear;		// 4	//68
+    float quadratic;	// 4	//72
+    float cutOff;		// 4	//76
+    float outerCutOff;	// 4	//80
+};						// 80
+
+struct DirectionLight {
+    float ambient;		// 4	//0
+    float diffuse;		// 4	//4
+    float specular;		// 4	//8
+    vec3 color;			// 16	//16	//move starting point to divisible
+    vec3 direction;		// 16	//32	//move starting point to divisible
+};						// 48
+
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+
+struct PackedLight {
+	vec4 position;     //world space position, radius
+	vec4 color;        //color, ambient
+	vec4 direction;    //spot direction, cosine of the inner cut off
+	vec4 attenuation;  //constant, linear, quadratic, cosine of the outer cut off
+	vec4 factors;      //diffuse, specular
+};
+
+layout (std430, binding = 2) readonly buffer LightBlock
+{
+	uvec4 lightCounts;  //point, spot and total lights
+	PackedLight lights[];
+};
+
+layout (std430, binding = 3) readonly buffer GridBlock
+{
+	uvec2 grid[];  //offset into indices and light count of each cluster
+};
+
+layout (std430, binding = 4) readonly buffer IndexBlock
+{
+	uint indices[];
+};
+
+#define NR_BASIC_LIGHTS 1
+#define NR_POINT_LIGHTS 1
+#define NR_SPOT_LIGHTS 1
+#define NR_DIRECTION_LIGHTS 1
+layout (std140) uniform Lights
+{
+	PointLight plight[NR_POINT_LIGHTS]; // point light
+	SpotLight slight[NR_SPOT_LIGHTS]; // spot light
+	DirectionLight dlight[NR_DIRECTION_LIGHTS]; // directional light
+};
+
+layout (std140) uniform Camera
+{
+	mat4 view;
+	vec3 camPos;
+};
+
+// inverse of the octahedral encoding written by gBuffer.frag
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+// world space position of a gBuffer texel from its depth
+vec3 reconstructPosition(vec2 uv)
+{
+    float depth = texture(gDepth, uv).r;
+    vec4 world = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return world.xyz / world.w;
+}
+
+void main()
+{
+    // retrieve data from G-buffer
+    vec3 FragPos = reconstructPosition(TexCoords);
+    vec3 Normal = octahedralDecode(texture(gNormal, TexCoords).rg);
+    vec3 Albedo = texture(gAlbedoSpec, TexCoords).rgb;
+    float Specular = texture(gAlbedoSpec, TexCoords).a;
+    
+    // then calculate lighting as usual
+    vec3 lighting = vec3(0); // hard-coded ambient component
+    vec3 viewDir = normalize(camPos - FragPos);
+
+    // find the cluster of the fragment, the inverse of the slicing in clusterCull.comp
+    float viewDepth = -(view * vec4(FragPos, 1.0)).z;
+    int slice = clamp(int(log(viewDepth / nearBound) / log(farBound / nearBound) * CLUSTER_GRID_Z), 0, CLUSTER_GRID_Z - 1);
+    ivec2 tile = min(ivec2(TexCoords * vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y)), ivec2(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1));
+    uvec2 cluster = grid[tile.x + tile.y * CLUSTER_GRID_X + slice * CLUSTER_GRID_X * CLUSTER_GRID_Y];
+    for (uint i = 0; i < cluster.y; i++)
+    {
+        PackedLight light = lights[indices[cluster.x + i]];
+        vec3 toLight = light.position.xyz - FragPos;
+        float distance = length(toLight);
+        if (distance > light.position.w)
+            continue;
+        vec3 lightDir = toLight / distance;
+        // point lights have cut offs below -1 and are never dimmed
+        float theta = dot(lightDir, normalize(-light.direction.xyz));
+        float intensity = clamp((theta - light.attenuation.w) / (light.direction.w - light.attenuation.w), 0.0, 1.0);
+        float attenuation = 1.0 / (light.attenuation.x + light.attenuation.y * distance + light.attenuation.z * distance * distance);
+
+        vec3 ambient = light.color.rgb * light.color.a * Albedo;
+        vec3 diffuse = light.color.rgb * light.factors.x * max(dot(Normal, lightDir), 0.0) * Albedo;
+        vec3 halfwayDir = normalize(lightDir + viewDir);
+        float spec = pow(max(dot(Normal, halfwayDir), 0.0), 16.0);
+        vec3 specular = light.color.rgb * light.factors.y * spec * Specular;
+        lighting += (ambient + (diffuse + specular) * intensity) * attenuation;
+    }
+    for(int i = 0; i < NR_DIRECTION_LIGHTS; ++i)
+    {
+		vec3 ambient = dlight[i].color * dlight[i].ambient * Albedo; // hard-coded ambient component
+        // diffuse
+        vec3 lightDir = normalize(-dlight[i].direction);
+        vec3 diffuse = dlight[i].color * dlight[i].diffuse * max(dot(Normal, lightDir), 0.0) * Albedo;
+		// specular
+		vec3 halfwayDir = normalize(lightDir + viewDir);
+		float spec = pow(max(dot(Normal, halfwayDir), 0.0), 16.0);
+		vec3 specular = dlight[i].color * dlight[i].specular * spec * Specular;
+
+		lighting += ambient + diffuse + specular;
+    }
+    
+    FragColor = vec4(lighting, 1.0f);
+}
\ No newline at end of file
@@ -3,9 +3,10 @@ out vec4 FragColor;
   
 in vec2 TexCoords;
 
-uniform sampler2D gPosition;
+uniform sampler2D gDepth;
 uniform sampler2D gNormal;
 uniform sampler2D gAlbedoSpec;
+uniform mat4 inverseViewProjection;
 
 struct PointLight {
     float ambient;		// 4	//0
@@ -57,11 +58,28 @@ layout (std140) uniform Camera
 	vec3 camPos;
 };
 
+// inverse of the octahedral encoding written by gBuffer.frag
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+// world space position of a gBuffer texel from its depth
+vec3 reconstructPosition(vec2 uv)
+{
+    float depth = texture(gDepth, uv).r;
+    vec4 world = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return world.xyz / world.w;
+}
+
 void main()
 {
     // retrieve data from G-buffer
-    vec3 FragPos = texture(gPosition, TexCoords).rgb;
-    vec3 Normal = texture(gNormal, TexCoords).rgb;
+    vec3 FragPos = reconstructPosition(TexCoords);
+    vec3 Normal = octahedralDecode(texture(gNormal, TexCoords).rg);
     vec3 Albedo = texture(gAlbedoSpec, TexCoords).rgb;
     float Specular = texture(gAlbedoSpec, TexCoords).a;
     
@@ -0,0 +1,97 @@
+#version 460 core
+out vec4 FragColor;
+  
+uniform sampler2D gDepth;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+uniform mat4 inverseViewProjection;
+
+struct PackedLight {
+	vec4 position;     //world space position, radius
+	vec4 color;        //color, ambient
+	vec4 direction;    //spot direction, cosine of the inner cut off
+	vec4 attenuation;  //constant, linear, quadratic, cosine of the outer cut off
+	vec4 factors;      //diffuse, specular
+};
+
+layout (std430, binding = 2) readonly buffer LightBlock
+{
+	uvec4 lightCounts;  //point, spot and total lights
+	PackedLight lights[];
+};
+
+flat in int lightIndex;
+
+layout (std140) uniform Scene
+{
+	mat4 projection;
+    vec2 window_size;
+	float time;
+	bool gamma;
+	float exposure;
+    bool bloom;
+};
+
+layout (std140) uniform Camera
+{
+	mat4 view;
+	vec3 camPos;
+};
+
+// inverse of the octahedral encoding written by gBuffer.frag
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+// world space position of a gBuffer texel from its depth
+vec3 reconstructPosition(vec2 uv)
+{
+    float depth = texture(gDepth, uv).r;
+    vec4 world = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return world.xyz / world.w;
+}
+
+vec2 CalcTexCoord()
+{
+	return gl_FragCoord.xy / window_size;
+}
+
+void main()
+{             
+	vec2 tex_coords = CalcTexCoord();
+    // retrieve data from G-buffer
+    vec3 FragPos = reconstructPosition(tex_coords);
+    vec3 Normal = octahedralDecode(texture(gNormal, tex_coords).rg);
+    vec3 Albedo = texture(gAlbedoSpec, tex_coords).rgb;
+    float Specular = texture(gAlbedoSpec, tex_coords).a;
+    
+    // then calculate lighting as usual
+    PackedLight plight = lights[lightIndex];
+    // surfaces in front of the volume pass the depth test as well
+    float distance = length(plight.position.xyz - FragPos);
+    if (distance > plight.position.w)
+        discard;
+    vec3 ambient = Albedo * plight.color.a * plight.color.rgb; // hard-coded ambient component
+    vec3 viewDir = normalize(camPos - FragPos);
+
+	// diffuse
+	vec3 lightDir = normalize(plight.position.xyz - FragPos);
+	vec3 diffuse = plight.color.rgb * plight.factors.x * max(dot(Normal, lightDir), 0.0) * Albedo;
+	// specular
+	vec3 halfwayDir = normalize(lightDir + viewDir);
+	float spec = pow(max(dot(Normal, halfwayDir), 0.0), 16.0);
+	vec3 specular = plight.color.rgb * plight.factors.y * spec * Specular;
+	// attenuation
+	float attenuation = 1.0 / (plight.attenuation.x + plight.attenuation.y * distance + plight.attenuation.z * distance * distance);
+
+	ambient *= attenuation;
+	diffuse *= attenuation;
+	specular *= attenuation;
+	vec3 lighting = ambient + diffuse + specular;
+
+    FragColor = vec4(lighting, 1.0f);
+}
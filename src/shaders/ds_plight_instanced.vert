@@ -0,0 +1,43 @@
+#version 460 core
+
+layout (location = 0) in vec3 aPos;
+
+layout (std140) uniform Scene
+{
+	mat4 projection;
+    vec2 window_size;
+	float time;
+	bool gamma;
+	float exposure;
+	bool bloom;
+};
+
+layout (std140) uniform Camera
+{
+	mat4 view;
+	vec3 camPos;
+};
+
+struct PackedLight {
+	vec4 position;     //world space position, radius
+	vec4 color;        //color, ambient
+	vec4 direction;    //spot direction, cosine of the inner cut off
+	vec4 attenuation;  //constant, linear, quadratic, cosine of the outer cut off
+	vec4 factors;      //diffuse, specular
+};
+
+layout (std430, binding = 2) readonly buffer LightBlock
+{
+	uvec4 lightCounts;  //point, spot and total lights
+	PackedLight lights[];
+};
+
+flat out int lightIndex;
+
+void main()
+{
+	// the unit sphere is scaled to the radius of the light
+	vec4 light = lights[gl_InstanceID].position;
+	lightIndex = gl_InstanceID;
+	gl_Position = projection * view * vec4(light.xyz + aPos * light.w, 1.0);
+}
@@ -1,17 +1,13 @@
 #version 330 core
 
-// could not get the gPosition or gNormal to work as vec3's. only solution was to change to vec4
-// the global position of each frag
-layout (location = 0) out vec3 gPosition;
-// the normal vector of each frag in world space
-layout (location = 1) out vec3 gNormal;
+// the world space normal of each frag, octahedral encoded. world space position is reconstructed from depth
+layout (location = 0) out vec2 gNormal;
 // the combined albedo color and specular intensity
-layout (location = 2) out vec4 gAlbedoSpec;
+layout (location = 1) out vec4 gAlbedoSpec;
 
 
 in VS_OUT {
 	vec3 Normal;
-	vec3 FragPos;
 	vec2 TexCoords;
 } fs_in;
 
@@ -22,12 +18,18 @@ struct Material {
 
 uniform Material material;
 
+// map the unit sphere onto an octahedron and unfold it onto the [-1, 1] square
+vec2 octahedralEncode(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 wrapped = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return n.z >= 0.0 ? n.xy : wrapped;
+}
+
 void main()
 {    
-    // store the fragment position vector in the first gbuffer texture
-    gPosition = fs_in.FragPos;
-    // also store the per-fragment normals into the gbuffer
-    gNormal = normalize(fs_in.Normal);
+    // store the per-fragment normals into the gbuffer
+    gNormal = octahedralEncode(normalize(fs_in.Normal));
     // and the diffuse per-fragment color
     gAlbedoSpec.rgb = texture(material.texture_diffuse, fs_in.TexCoords).rgb;
     // store specular intensity in gAlbedoSpec's alpha component
@@ -25,7 +25,6 @@ uniform mat3 Normal;  //normal matrix
 
 out VS_OUT {
 	vec3 Normal;
-	vec3 FragPos;
 	vec2 TexCoords;
 } vs_out;
 
@@ -33,7 +32,6 @@ out VS_OUT {
 void main()
 {
     vec4 worldPos = Model * vec4(aPos, 1.0);
-    vs_out.FragPos = worldPos.xyz; 
     vs_out.TexCoords = aTexCoords;
     
     vs_out.Normal = Normal * aNormal;
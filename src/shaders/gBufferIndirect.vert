@@ -0,0 +1,49 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+layout (std140) uniform Scene
+{
+	mat4 projection;
+    vec2 window_size;
+	float time;
+	bool gamma;
+	float exposure;
+	bool bloom;
+};
+
+layout (std140) uniform Camera
+{
+	mat4 view;
+	vec3 camPos;
+};
+
+struct DrawData {
+	mat4 model;
+	mat4 normal;  //normal matrix in the upper 3x3
+	vec4 sphere;
+};
+
+// one entry per mesh of the render list, the low 26 bits of the base instance of the draw select it
+layout (std430, binding = 0) readonly buffer DrawDataBlock
+{
+	DrawData draws[];
+};
+
+out VS_OUT {
+	vec3 Normal;
+	vec2 TexCoords;
+} vs_out;
+
+
+void main()
+{
+    DrawData draw = draws[gl_BaseInstance & 0x3FFFFFF];
+    vec4 worldPos = draw.model * vec4(aPos, 1.0);
+    vs_out.TexCoords = aTexCoords;
+    
+    vs_out.Normal = mat3(draw.normal) * aNormal;
+
+    gl_Position = projection * view * worldPos;
+}
@@ -49,17 +49,15 @@ layout (std140) uniform Camera
 	vec3 camPos;
 };
 
-struct Material {
+layout (std140) uniform MaterialConstants {
 	vec4 ambient;
-    vec4 diffuse;
-    vec4 specular;
-    float shininess;
-    float opacity;
+	vec4 diffuse;
+	vec4 specular;
+	float shininess;
+	float opacity;
 	float reflectivity;
 	float refractionIndex;
-};
-
-uniform Material material;
+} materialConstants;
 
 in VS_OUT {
 	vec3 Normal;
@@ -78,22 +76,22 @@ void main()
    
     // get diffuse color for ambient and diffuse
     // final ambient
-    vec3 ambient = dlight[0].color * dlight[0].ambient * material.ambient.rgb;
+    vec3 ambient = dlight[0].color * dlight[0].ambient * materialConstants.ambient.rgb;
 
     // light diffuse
     vec3 lightDir = normalize(-dlight[0].direction);
     float diff = max(dot(lightDir, normal), 0.0);
 	// final diffuse
-    vec3 diffuse = dlight[0].color * dlight[0].diffuse * diff * material.diffuse.rgb;
+    vec3 diffuse = dlight[0].color * dlight[0].diffuse * diff * materialConstants.diffuse.rgb;
 
     // light specular 
     vec3 viewDir = normalize(camPos - fs_in.FragPos);
 	vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), materialConstants.shininess);
 
 	// object specular
 	// final specular
-    vec3 specular = dlight[0].color * dlight[0].specular * spec * material.specular.rgb;
+    vec3 specular = dlight[0].color * dlight[0].specular * spec * materialConstants.specular.rgb;
     //vec3 specular = vec3(0.2) * spec;
 
 	vec3 lighting = ambient + diffuse + specular;
@@ -54,6 +54,11 @@ struct Material {
     sampler2D texture_specular;
 	sampler2D texture_normal;
 	sampler2D texture_height;
+};
+
+//object data
+uniform Material material;
+layout (std140) uniform MaterialConstants {
 	vec4 ambient;
 	vec4 diffuse;
 	vec4 specular;
@@ -61,10 +66,7 @@ struct Material {
 	float opacity;
 	float reflectivity;
 	float refractionIndex;
-};
-
-//object data
-uniform Material material;
+} materialConstants;
 
 uniform samplerCube shadowCubeMap;
 uniform float shadowFar;
@@ -0,0 +1,21 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+
+struct DrawData {
+	mat4 model;
+	mat4 normal;
+	vec4 sphere;
+};
+
+layout (std430, binding = 0) readonly buffer DrawDataBlock
+{
+	DrawData draws[];
+};
+
+flat out int vCulledFaces; // the faces the model does not overlap, stored above the draw index in the base instance
+
+void main()
+{
+    vCulledFaces = int(uint(gl_BaseInstance) >> 26);
+    gl_Position = draws[gl_BaseInstance & 0x3FFFFFF].model * vec4(aPos, 1.0);
+}  
@@ -0,0 +1,20 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+
+struct DrawData {
+	mat4 model;
+	mat4 normal;
+	vec4 sphere;
+};
+
+layout (std430, binding = 0) readonly buffer DrawDataBlock
+{
+	DrawData draws[];
+};
+
+uniform mat4 shadowTransform;
+
+void main()
+{
+    gl_Position = shadowTransform * draws[gl_BaseInstance & 0x3FFFFFF].model * vec4(aPos, 1.0);
+}  
@@ -0,0 +1,15 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 5) in mat4 aInstanceModel;  //model matrix, one per instance
+
+uniform mat4 shadowTransform;
+
+// maps packed positions back to object space, left at identity for unpacked meshes
+uniform vec3 positionScale = vec3(1.0);
+uniform vec3 positionOffset = vec3(0.0);
+
+void main()
+{
+    vec3 position = aPos * positionScale + positionOffset;
+    gl_Position = shadowTransform * aInstanceModel * vec4(position, 1.0);
+}  
\ No newline at end of file
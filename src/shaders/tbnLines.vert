@@ -2,7 +2,7 @@
 
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
-layout (location = 3) in vec3 aTangent;
+layout (location = 3) in vec4 aTangent;  //w is the bitangent sign of packed vertices
 layout (location = 4) in vec3 aBitangent;
 
 layout (std140) uniform Scene
@@ -33,8 +33,11 @@ out VS_OUT {
 void main()
 {
 	gl_Position = projection*view*Model*vec4(aPos, 1.0);
-    mat3 normalMatrix = mat3(transpose(inverse(view*Model)));
+    // packed vertices have no bitangent, rebuild it from the sign stored in the tangent
+    vec3 bitangent = dot(aBitangent, aBitangent) > 0.0 ? aBitangent : cross(aNormal, aTangent.xyz) * aTangent.w;
+    // the view is rigid, and Model also holds the position decode of packed meshes
+    mat3 normalMatrix = mat3(view) * Normal;
     vs_out.normal = normalize(vec3(projection * vec4(normalMatrix * aNormal, 0.0)));
-    vs_out.tangent = normalize(vec3(projection * vec4(normalMatrix * aTangent, 0.0)));
-    vs_out.bitangent = normalize(vec3(projection * vec4(normalMatrix * aBitangent, 0.0)));
+    vs_out.tangent = normalize(vec3(projection * vec4(normalMatrix * aTangent.xyz, 0.0)));
+    vs_out.bitangent = normalize(vec3(projection * vec4(normalMatrix * bitangent, 0.0)));
 }
@@ -20,6 +20,7 @@ layout (std140) uniform Camera
 };
 
 uniform mat4 Model; //model matrix
+uniform mat3 Normal; //normal matrix
 
 out VS_OUT {
     vec3 normal;
@@ -28,6 +29,7 @@ out VS_OUT {
 void main()
 {
 	gl_Position = projection*view*Model*vec4(aPos, 1.0);
-    mat3 normalMatrix = mat3(transpose(inverse(view*Model)));
+    // the view is rigid, and Model also holds the position decode of packed meshes
+    mat3 normalMatrix = mat3(view) * Normal;
     vs_out.normal = normalize(vec3(projection * vec4(normalMatrix * aNormal, 0.0)));
 }
@@ -16,6 +16,7 @@
 #include "shader.h"
 #include "glHelper.h"
 #include "vertexData.h"
+#include "TextureCache.h"
 
 class Skybox 
 {
@@ -37,6 +38,23 @@ class Skybox
 			setup();
         }
 
+		///<summary>Create a skybox from six face images, ordered +x, -x, +y, -y, +z, -z. The cube map is shared through the texture cache.</summary>
+		Skybox(const std::vector<std::string>& faces, const Shader& shader) :
+			shader(shader),
+			rotation(0.0),
+			cached(true)
+		{
+			this->texture.id = TextureCache::get().acquireCubeMap(faces);
+			this->texture.type = "skybox";
+			setup();
+		}
+
+		virtual ~Skybox()
+		{
+			if (this->cached)
+				TextureCache::get().release(this->texture.id);
+		}
+
         virtual void uploadUniforms()
         {
 			this->uploadUniforms(this->shader);
@@ -97,6 +115,10 @@ class Skybox
 
     private:
         GLuint VBO;
+		bool cached = false; // whether the texture was acquired from the texture cache
+
+		Skybox(const Skybox&) = delete;
+		Skybox& operator=(const Skybox&) = delete;
 
         void setup()
         {
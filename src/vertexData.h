@@ -21,6 +21,18 @@ struct VertexData {
     glm::vec3 Bitangent;
 };
 
+// The compact format of the GeometryArena when packed vertices are enabled, 20 bytes instead of 56.
+// Positions are snorm16 inside the bounds of their mesh, the GeometryRange holds the scale and offset back to object space.
+// Normal and tangent are snorm 10-10-10-2, the 2 bit w of the tangent is the sign of the bitangent, which shaders rebuild as cross(normal, tangent) * w.
+struct PackedVertexData {
+    // x, y, z and one short of padding
+    GLshort Position[4];
+    GLuint Normal;
+    GLuint Tangent;
+    // half floats
+    GLushort uv[2];
+};
+
 GLfloat const skyboxVertexData[] = {
     // positions          
     -1.0f,  1.0f, -1.0f,